@@ -0,0 +1,210 @@
+/* DumpStats - dump1090 feed statistical data collector
+ * Copyright (C) 2015 Marcel Kebisek
+ * Contact: marcel.kebisek@gmail.com
+ * 
+ * This file is part of DumpStats.
+ * 
+ * DumpStats is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * DumpStats is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with DumpStats. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "aircraft.H"
+
+#include <cstring>
+
+
+/**
+ * Constructor. Whole table is allocated here.
+ */
+aircraftTable::aircraftTable()
+{
+	tAircraftState empty;
+	memset(&empty, 0, sizeof(empty));
+	slots.assign(AIRCRAFT_SLOTS, empty);
+	used = 0;
+	evictions = 0;
+}
+
+
+
+/**
+ * Function finds slot of aircraft.
+ * @param icao - ICAO address
+ * @return slot holding address, AIRCRAFT_SLOTS if aircraft is not in table
+ */
+size_t aircraftTable::findSlot(uint32_t icao) const
+{
+	size_t home = homeSlot(icao);
+	for (size_t i = 0; i < AIRCRAFT_PROBE; i++)
+	{
+		size_t slot = (home + i) & (AIRCRAFT_SLOTS - 1);
+		if (slots[slot].key == 0)
+		{
+			break;
+		}
+		if ((slots[slot].key & AIRCRAFT_ICAO_MASK) == icao)
+		{
+			return slot;
+		}
+	}
+	return AIRCRAFT_SLOTS;
+}
+
+
+
+/**
+ * Function removes entry of slot. Following entries of the same cluster, which could not be found
+ * with the slot empty (their home slot is not between slot and their position), are shifted back.
+ * @param slot - slot to empty
+ */
+void aircraftTable::remove(size_t slot)
+{
+	const size_t mask = AIRCRAFT_SLOTS - 1;
+	size_t i = slot;
+	size_t j = slot;
+	while (true)
+	{
+		j = (j + 1) & mask;
+		if (slots[j].key == 0)
+		{
+			break;
+		}
+		
+		// entry stays, if its home slot is cyclically within (i, j>
+		size_t home = homeSlot(slots[j].key & AIRCRAFT_ICAO_MASK);
+		bool stays = (i <= j) ? ((i < home) && (home <= j)) : ((i < home) || (home <= j));
+		if (! stays)
+		{
+			slots[i] = slots[j];
+			i = j;
+		}
+	}
+	memset(&slots[i], 0, sizeof(slots[i]));
+	used--;
+}
+
+
+
+/**
+ * Function returns state of aircraft for update, aircraft is added if it is not in table.
+ * @param icao - ICAO address (24 bits)
+ * @param now - unix time of update
+ * @return state of aircraft (lastSeen is set, other fields are left to caller)
+ */
+tAircraftState *aircraftTable::touch(uint32_t icao, uint32_t now)
+{
+	icao &= AIRCRAFT_ICAO_MASK;
+	size_t home = homeSlot(icao);
+	size_t victim = home;
+	size_t slot = AIRCRAFT_SLOTS;
+	for (size_t i = 0; i < AIRCRAFT_PROBE; i++)
+	{
+		size_t j = (home + i) & (AIRCRAFT_SLOTS - 1);
+		if (slots[j].key == 0)
+		{
+			slot = j;
+			used++;
+			break;
+		}
+		if ((slots[j].key & AIRCRAFT_ICAO_MASK) == icao)
+		{
+			slots[j].lastSeen = now;
+			return &slots[j];
+		}
+		if (slots[j].lastSeen < slots[victim].lastSeen)
+		{
+			victim = j;
+		}
+	}
+	
+	// whole probe window is occupied - least recently seen aircraft is replaced
+	if (slot == AIRCRAFT_SLOTS)
+	{
+		slot = victim;
+		evictions++;
+	}
+	
+	tAircraftState &s = slots[slot];
+	s.key = icao | AIRCRAFT_USED;
+	s.lat = 0;
+	s.lon = 0;
+	s.firstSeen = now;
+	s.lastSeen = now;
+	s.alt = 0;
+	s.firstRange = AIRCRAFT_NO_RANGE;
+	memset(s.callsign, 0, sizeof(s.callsign));
+	return &s;
+}
+
+
+
+/**
+ * Function returns state of aircraft.
+ * @param icao - ICAO address (24 bits)
+ * @return state, NULL if aircraft is not in table
+ */
+const tAircraftState *aircraftTable::find(uint32_t icao) const
+{
+	size_t i = findSlot(icao & AIRCRAFT_ICAO_MASK);
+	return (i < AIRCRAFT_SLOTS) ? &slots[i] : NULL;
+}
+
+
+
+/**
+ * Function removes aircraft not heard of for more than idle seconds.
+ * @param now - current unix time
+ * @param idle - maximum idle time in seconds
+ * @return number of removed aircraft
+ */
+size_t aircraftTable::expire(uint32_t now, uint32_t idle)
+{
+	size_t removed = 0;
+	size_t i = 0;
+	while (i < AIRCRAFT_SLOTS)
+	{
+		// slot is examined again after removal, another entry may have been shifted into it
+		if ((slots[i].key != 0) && (now - slots[i].lastSeen > idle))
+		{
+			remove(i);
+			removed++;
+		}
+		else
+		{
+			i++;
+		}
+	}
+	return removed;
+}
+
+
+
+/**
+ * Function returns number of aircraft in table.
+ * @return number of aircraft
+ */
+size_t aircraftTable::size() const
+{
+	return used;
+}
+
+
+
+/**
+ * Function returns number of aircraft evicted to make room for new ones.
+ * @return number of evictions
+ */
+uint64_t aircraftTable::getEvictions() const
+{
+	return evictions;
+}
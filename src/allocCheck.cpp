@@ -0,0 +1,223 @@
+/* DumpStats - dump1090 feed statistical data collector
+ * Copyright (C) 2015 Marcel Kebisek
+ * Contact: marcel.kebisek@gmail.com
+ * 
+ * This file is part of DumpStats.
+ * 
+ * DumpStats is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * DumpStats is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with DumpStats. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "objects.H"
+#include "allocCheck.H"
+
+#include <new>
+#include <zlib.h>
+
+
+// Allocations made by thread
+static thread_local uint64_t allocCalls = 0;
+
+
+void *operator new(std::size_t size)
+{
+	allocCalls++;
+	void *p = malloc((size > 0) ? size : 1);
+	if (p == NULL)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void *operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+	allocCalls++;
+	return malloc((size > 0) ? size : 1);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+	return operator new(size, std::nothrow);
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept
+{
+	free(p);
+}
+
+
+
+/**
+ * Function returns number of heap allocations (operator new) made by calling thread.
+ * @return number of allocations
+ */
+uint64_t allocCount()
+{
+	return allocCalls;
+}
+
+
+
+/**
+ * Function reads whole capture file (plain text or gzip-compressed) and appends it to buffer.
+ * @param path - path to capture file
+ * @param capture - buffer to append to
+ * @return zero if success, nonzero otherwise
+ */
+static int readCapture(const std::string &path, std::vector<char> &capture)
+{
+	gzFile gz = gzopen(path.c_str(), "rb");
+	if (gz == NULL)
+	{
+		fprintf(stderr, "ERROR: Unable to open capture file: [%s]\n", path.c_str());
+		return 1;
+	}
+	
+	int result = 0;
+	while (true)
+	{
+		size_t fill = capture.size();
+		capture.resize(fill + ALLOC_BLOCK_SIZE);
+		int n = gzread(gz, capture.data() + fill, ALLOC_BLOCK_SIZE);
+		capture.resize(fill + ((n > 0) ? n : 0));
+		if (n < 0)
+		{
+			fprintf(stderr, "ERROR: Reading of capture file failed: [%s]\n", path.c_str());
+			result = 1;
+		}
+		if (n <= 0)
+		{
+			break;
+		}
+	}
+	
+	// last line of file is not joined with first line of next file
+	if ((! capture.empty()) && (capture.back() != '\n'))
+	{
+		capture.push_back('\n');
+	}
+	
+	gzclose(gz);
+	return result;
+}
+
+
+
+/**
+ * Function replays capture into stats in blocks of single read of collect mode (see processing loop
+ * of collect mode in dumpStats.cpp), incomplete last line of block is carried into next block.
+ * @param stats - object to be filled
+ * @param capture - captured feed
+ * @param now - current time of all batches
+ * @param lines - vector of line views reused by all batches
+ * @param messages - increased by number of replayed lines
+ * @return number of processed (not discarded) messages
+ */
+static uint64_t replayCapture(data &stats, const std::vector<char> &capture, std::time_t now, std::vector<tLineView> &lines, uint64_t &messages)
+{
+	static char buffer[ALLOC_BLOCK_SIZE];
+	size_t pending = 0;
+	size_t offset = 0;
+	uint64_t processed = 0;
+	
+	while (offset < capture.size())
+	{
+		size_t n = std::min(sizeof(buffer) - pending, capture.size() - offset);
+		memcpy(buffer + pending, capture.data() + offset, n);
+		offset += n;
+		
+		size_t len = pending + n;
+		lines.clear();
+		size_t consumed = frameLines(buffer, len, lines);
+		
+		messages += lines.size();
+		processed += stats.processBatch(lines.data(), lines.size(), now);
+		
+		// keep incomplete line for next block, drop overlong line
+		pending = len - consumed;
+		if (pending == sizeof(buffer))
+		{
+			pending = 0;
+		}
+		memmove(buffer, buffer + consumed, pending);
+	}
+	
+	return processed;
+}
+
+
+
+/**
+ * Function replays capture files twice and counts heap allocations of each pass.
+ * Both passes share single current time, so second pass sees the same flights, aircraft and hours as first one.
+ * @param stats - object to be filled
+ * @param files - capture files of SBS feed
+ * @return zero if second (steady state) pass does not allocate, nonzero otherwise
+ */
+int allocReplay(data &stats, const std::vector<std::string> &files)
+{
+	std::vector<char> capture;
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		if (readCapture(files[i], capture) != 0)
+		{
+			return 1;
+		}
+	}
+	
+	std::time_t now = std::time(nullptr);
+	std::vector<tLineView> lines;
+	uint64_t allocations = 0;
+	
+	for (int pass = 1; pass <= 2; pass++)
+	{
+		uint64_t messages = 0;
+		uint64_t start = allocCount();
+		uint64_t processed = replayCapture(stats, capture, now, lines, messages);
+		allocations = allocCount() - start;
+		
+		printf("Pass %d (%s): %lu messages (%lu processed), %lu allocations (%.4f per message)\n", pass,
+			(pass == 1) ? "warm-up" : "steady state", (unsigned long) messages, (unsigned long) processed,
+			(unsigned long) allocations, (messages > 0) ? (double) allocations / messages : 0.0);
+	}
+	
+	if (allocations > 0)
+	{
+		fprintf(stderr, "ERROR: Processing of messages allocates in steady state!\n");
+		return 1;
+	}
+	
+	printf("Steady state is allocation-free.\n");
+	return 0;
+}
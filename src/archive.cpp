@@ -0,0 +1,939 @@
+/* DumpStats - dump1090 feed statistical data collector
+ * Copyright (C) 2015 Marcel Kebisek
+ * Contact: marcel.kebisek@gmail.com
+ * 
+ * This file is part of DumpStats.
+ * 
+ * DumpStats is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * DumpStats is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with DumpStats. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archive.H"
+
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+/**
+ * Function appends unsigned varint (7 bits per byte, lowest first).
+ * @param out - output buffer
+ * @param v - value
+ */
+static void putVarint(std::vector<unsigned char> &out, uint64_t v)
+{
+	while (v >= 0x80)
+	{
+		out.push_back((unsigned char) (v | 0x80));
+		v >>= 7;
+	}
+	out.push_back((unsigned char) v);
+}
+
+
+
+/**
+ * Function reads unsigned varint.
+ * @param p - position in buffer, moved behind varint
+ * @param end - end of buffer
+ * @param v - read value
+ * @return false if varint is truncated or too long
+ */
+static bool getVarint(const unsigned char *&p, const unsigned char *end, uint64_t &v)
+{
+	v = 0;
+	for (int shift = 0; (p < end) && (shift < 64); shift += 7)
+	{
+		unsigned char b = *p++;
+		v |= (uint64_t) (b & 0x7F) << shift;
+		if (! (b & 0x80))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+
+// Zigzag mapping of signed values to unsigned ones (small magnitudes get small codes)
+static inline uint64_t zigzag(int64_t v)
+{
+	return ((uint64_t) v << 1) ^ (uint64_t) (v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v)
+{
+	return (int64_t) (v >> 1) ^ -(int64_t) (v & 1);
+}
+
+
+
+/**
+ * Function encodes fixed-length column as changes against previous values.
+ * Nonzero change is stored as zigzag varint, run of unchanged values as zero followed by run length.
+ * @param cur - values of encoded period
+ * @param prev - values of previous period
+ * @param n - number of values
+ * @param out - output buffer
+ */
+static void encodeValues(const int32_t *cur, const int32_t *prev, size_t n, std::vector<unsigned char> &out)
+{
+	size_t i = 0;
+	while (i < n)
+	{
+		if (cur[i] == prev[i])
+		{
+			size_t run = 0;
+			while ((i < n) && (cur[i] == prev[i]))
+			{
+				run++;
+				i++;
+			}
+			putVarint(out, 0);
+			putVarint(out, run);
+		}
+		else
+		{
+			putVarint(out, zigzag((int64_t) cur[i] - prev[i]));
+			i++;
+		}
+	}
+}
+
+
+
+/**
+ * Function applies column encoded by encodeValues() to values of previous period.
+ * @param p - start of column
+ * @param end - end of column
+ * @param values - values of previous period, turned into values of decoded period
+ * @param n - number of values
+ * @return false if column is corrupted
+ */
+static bool decodeValues(const unsigned char *p, const unsigned char *end, int32_t *values, size_t n)
+{
+	size_t i = 0;
+	while (i < n)
+	{
+		uint64_t t;
+		if (! getVarint(p, end, t))
+		{
+			return false;
+		}
+		if (t == 0)
+		{
+			uint64_t run;
+			if ((! getVarint(p, end, run)) || (run == 0) || (run > n - i))
+			{
+				return false;
+			}
+			i += run;
+		}
+		else
+		{
+			values[i] += (int32_t) unzigzag(t);
+			i++;
+		}
+	}
+	return (p == end);
+}
+
+
+
+/**
+ * Function encodes heat map cells whose weight changed against previous period
+ * (new cells have previous weight zero, removed cells get weight zero).
+ * Each change is stored as Morton code gap from previous change and zigzag weight change.
+ * @param cur - cells of encoded period (sorted by Morton code)
+ * @param prev - cells of previous period (sorted by Morton code)
+ * @param out - output buffer
+ */
+static void encodeHeat(const std::vector<tHeatCell> &cur, const std::vector<tHeatCell> &prev, std::vector<unsigned char> &out)
+{
+	size_t i = 0;
+	size_t j = 0;
+	uint32_t lastCode = 0;
+	while ((i < cur.size()) || (j < prev.size()))
+	{
+		uint32_t code;
+		int64_t change;
+		if ((j == prev.size()) || ((i < cur.size()) && (cur[i].code < prev[j].code)))
+		{
+			code = cur[i].code;
+			change = cur[i++].weight;
+		}
+		else if ((i == cur.size()) || (prev[j].code < cur[i].code))
+		{
+			code = prev[j].code;
+			change = - (int64_t) prev[j++].weight;
+		}
+		else
+		{
+			code = cur[i].code;
+			change = (int64_t) cur[i++].weight - prev[j++].weight;
+		}
+		
+		if (change != 0)
+		{
+			putVarint(out, code - lastCode);
+			putVarint(out, zigzag(change));
+			lastCode = code;
+		}
+	}
+}
+
+
+
+/**
+ * Function applies column encoded by encodeHeat() to cells of previous period.
+ * @param p - start of column
+ * @param end - end of column
+ * @param heat - cells of previous period, turned into cells of decoded period
+ * @return false if column is corrupted
+ */
+static bool decodeHeat(const unsigned char *p, const unsigned char *end, std::vector<tHeatCell> &heat)
+{
+	if (p == end)
+	{
+		return true;
+	}
+	
+	std::vector<tHeatCell> out;
+	out.reserve(heat.size());
+	size_t j = 0;
+	uint64_t code = 0;
+	bool first = true;
+	while (p < end)
+	{
+		uint64_t gap, change;
+		if ((! getVarint(p, end, gap)) || (! getVarint(p, end, change)) || ((gap == 0) && (! first)))
+		{
+			return false;
+		}
+		code += gap;
+		first = false;
+		if (code > UINT32_MAX)
+		{
+			return false;
+		}
+		
+		// unchanged cells up to changed one
+		while ((j < heat.size()) && (heat[j].code < code))
+		{
+			out.push_back(heat[j++]);
+		}
+		
+		tHeatCell cell;
+		cell.code = (uint32_t) code;
+		cell.weight = unzigzag(change);
+		if ((j < heat.size()) && (heat[j].code == code))
+		{
+			cell.weight += heat[j++].weight;
+		}
+		if (cell.weight != 0)
+		{
+			out.push_back(cell);
+		}
+	}
+	out.insert(out.end(), heat.begin() + j, heat.end());
+	heat.swap(out);
+	return true;
+}
+
+
+
+/**
+ * Function encodes airlines whose count changed against previous period.
+ * Each change is stored as code length, code and zigzag count change.
+ * @param cur - airlines of encoded period
+ * @param prev - airlines of previous period
+ * @param out - output buffer
+ */
+static void encodeCompanies(const std::map<std::string, int> &cur, const std::map<std::string, int> &prev, std::vector<unsigned char> &out)
+{
+	std::map<std::string, int>::const_iterator i = cur.begin();
+	std::map<std::string, int>::const_iterator j = prev.begin();
+	while ((i != cur.end()) || (j != prev.end()))
+	{
+		const std::string *code;
+		int64_t change;
+		if ((j == prev.end()) || ((i != cur.end()) && (i->first < j->first)))
+		{
+			code = &i->first;
+			change = (i++)->second;
+		}
+		else if ((i == cur.end()) || (j->first < i->first))
+		{
+			code = &j->first;
+			change = - (int64_t) (j++)->second;
+		}
+		else
+		{
+			code = &i->first;
+			change = (int64_t) (i++)->second - (j++)->second;
+		}
+		
+		if (change != 0)
+		{
+			putVarint(out, code->size());
+			out.insert(out.end(), code->begin(), code->end());
+			putVarint(out, zigzag(change));
+		}
+	}
+}
+
+
+
+/**
+ * Function applies column encoded by encodeCompanies() to airlines of previous period.
+ * @param p - start of column
+ * @param end - end of column
+ * @param companies - airlines of previous period, turned into airlines of decoded period
+ * @return false if column is corrupted
+ */
+static bool decodeCompanies(const unsigned char *p, const unsigned char *end, std::map<std::string, int> &companies)
+{
+	while (p < end)
+	{
+		uint64_t len, change;
+		if ((! getVarint(p, end, len)) || (len > (uint64_t) (end - p)))
+		{
+			return false;
+		}
+		std::string code((const char *) p, len);
+		p += len;
+		if (! getVarint(p, end, change))
+		{
+			return false;
+		}
+		
+		int &count = companies[code];
+		count += unzigzag(change);
+		if (count == 0)
+		{
+			companies.erase(code);
+		}
+	}
+	return true;
+}
+
+
+
+/**
+ * Function resets period to empty statistics.
+ * @param p - period
+ */
+void archiveClear(tArchivePeriod &p)
+{
+	p.timestamp = 0;
+	p.polar.assign(720, 0);
+	p.alt.assign(501, 0);
+	p.heat.clear();
+	p.companies.clear();
+}
+
+
+
+/**
+ * Function computes change of statistics between two periods. Counters (altitudes, heat map, airlines)
+ * are differences, polar range is not additive, so it is taken from later period.
+ * @param from - earlier period
+ * @param to - later period
+ * @param out - change of statistics (timestamp of later period)
+ */
+void archiveDiff(const tArchivePeriod &from, const tArchivePeriod &to, tArchivePeriod &out)
+{
+	out.timestamp = to.timestamp;
+	out.polar = to.polar;
+	out.alt.resize(to.alt.size());
+	for (size_t i = 0; i < to.alt.size(); i++)
+	{
+		out.alt[i] = to.alt[i] - from.alt[i];
+	}
+	
+	out.heat.clear();
+	size_t j = 0;
+	for (size_t i = 0; i < to.heat.size(); i++)
+	{
+		while ((j < from.heat.size()) && (from.heat[j].code < to.heat[i].code))
+		{
+			j++;
+		}
+		tHeatCell cell = to.heat[i];
+		if ((j < from.heat.size()) && (from.heat[j].code == cell.code))
+		{
+			cell.weight -= from.heat[j].weight;
+		}
+		if (cell.weight > 0)
+		{
+			out.heat.push_back(cell);
+		}
+	}
+	
+	out.companies.clear();
+	std::map<std::string, int>::const_iterator companyIter;
+	for (companyIter = to.companies.begin(); companyIter != to.companies.end(); ++companyIter)
+	{
+		std::map<std::string, int>::const_iterator prev = from.companies.find(companyIter->first);
+		int count = companyIter->second - ((prev != from.companies.end()) ? prev->second : 0);
+		if (count > 0)
+		{
+			out.companies[companyIter->first] = count;
+		}
+	}
+}
+
+
+
+/**
+ * Constructor.
+ */
+archiveWriter::archiveWriter()
+{
+	fd = -1;
+	fileSize = 0;
+	periods = 0;
+	archiveClear(last);
+	archiveClear(empty);
+}
+
+
+
+/**
+ * Destructor.
+ */
+archiveWriter::~archiveWriter()
+{
+	close();
+}
+
+
+
+/**
+ * Function creates archive or opens existing one for appending. Last archived period is decoded,
+ * so next period can be encoded against it. Incomplete trailing record (interrupted append) is cut off.
+ * @param path - path to archive file
+ * @param refLat - reference latitude of archived statistics
+ * @param refLon - reference longitude of archived statistics
+ * @return zero if success, nonzero otherwise
+ */
+int archiveWriter::open(const std::string &path, double refLat, double refLon)
+{
+	close();
+	
+	if (access(path.c_str(), F_OK) == 0)
+	{
+		archiveReader r;
+		if (r.open(path) != 0)
+		{
+			return 1;
+		}
+		if ((r.getHeader().refLat != refLat) || (r.getHeader().refLon != refLon))
+		{
+			fprintf(stderr, "ERROR: Archive %s belongs to another reference position!\n", path.c_str());
+			return 1;
+		}
+		
+		periods = r.count();
+		fileSize = r.validSize();
+		if ((periods > 0) && (r.decode(periods - 1, ARCHIVE_ALL, last) != 0))
+		{
+			return 1;
+		}
+		r.close();
+		
+		fd = ::open(path.c_str(), O_WRONLY);
+		if ((fd == -1) || (ftruncate(fd, fileSize) == -1) || (lseek(fd, fileSize, SEEK_SET) == -1))
+		{
+			fprintf(stderr, "ERROR: Unable to open archive %s for writing!\n", path.c_str());
+			close();
+			return 1;
+		}
+		return 0;
+	}
+	
+	fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+	if (fd == -1)
+	{
+		fprintf(stderr, "ERROR: Unable to create archive %s!\n", path.c_str());
+		return 1;
+	}
+	
+	tArchiveHeader h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, ARCHIVE_MAGIC, sizeof(h.magic));
+	h.version = ARCHIVE_VERSION;
+	h.keyframe = ARCHIVE_KEYFRAME;
+	h.refLat = refLat;
+	h.refLon = refLon;
+	if (write(fd, &h, sizeof(h)) != (ssize_t) sizeof(h))
+	{
+		fprintf(stderr, "ERROR: Unable to write archive %s!\n", path.c_str());
+		close();
+		return 1;
+	}
+	fileSize = sizeof(h);
+	periods = 0;
+	archiveClear(last);
+	
+	return 0;
+}
+
+
+
+/**
+ * Function appends period to archive. Whole record is written by single write, failed write is cut off,
+ * so archive always consists of complete records.
+ * @param p - period statistics
+ * @return zero if success, nonzero otherwise
+ */
+int archiveWriter::append(const tArchivePeriod &p)
+{
+	if (fd == -1)
+	{
+		return 1;
+	}
+	if ((p.polar.size() != 720) || (p.alt.size() != 501))
+	{
+		fprintf(stderr, "ERROR: Invalid period statistics passed to archive!\n");
+		return 1;
+	}
+	if ((periods > 0) && (p.timestamp <= last.timestamp))
+	{
+		fprintf(stderr, "ERROR: Period %ld is not later than last archived period %ld!\n", (long) p.timestamp, (long) last.timestamp);
+		return 1;
+	}
+	
+	tArchiveRecord r;
+	memset(&r, 0, sizeof(r));
+	r.timestamp = p.timestamp;
+	r.keyframe = ((periods % ARCHIVE_KEYFRAME) == 0);
+	const tArchivePeriod &prev = r.keyframe ? empty : last;
+	
+	buf.assign(sizeof(r), 0);
+	size_t start = buf.size();
+	encodeValues(p.polar.data(), prev.polar.data(), 720, buf);
+	r.length[SNAP_POLAR] = buf.size() - start;
+	
+	start = buf.size();
+	encodeValues(p.alt.data(), prev.alt.data(), 501, buf);
+	r.length[SNAP_ALT] = buf.size() - start;
+	
+	start = buf.size();
+	encodeHeat(p.heat, prev.heat, buf);
+	r.length[SNAP_HEAT] = buf.size() - start;
+	
+	start = buf.size();
+	encodeCompanies(p.companies, prev.companies, buf);
+	r.length[SNAP_COMPANY] = buf.size() - start;
+	
+	memcpy(buf.data(), &r, sizeof(r));
+	
+	size_t done = 0;
+	while (done < buf.size())
+	{
+		ssize_t w = write(fd, buf.data() + done, buf.size() - done);
+		if (w <= 0)
+		{
+			if ((w < 0) && (errno == EINTR))
+			{
+				continue;
+			}
+			fprintf(stderr, "ERROR: Unable to write archive record!\n");
+			if ((ftruncate(fd, fileSize) == -1) || (lseek(fd, fileSize, SEEK_SET) == -1))
+			{
+				close();
+			}
+			return 1;
+		}
+		done += w;
+	}
+	
+	fileSize += buf.size();
+	periods++;
+	last = p;
+	return 0;
+}
+
+
+
+/**
+ * Function closes archive.
+ */
+void archiveWriter::close()
+{
+	if (fd != -1)
+	{
+		::close(fd);
+		fd = -1;
+	}
+}
+
+
+
+/**
+ * Constructor.
+ */
+archiveReader::archiveReader()
+{
+	base = NULL;
+	size = 0;
+	valid = 0;
+	memset(&header, 0, sizeof(header));
+}
+
+
+
+/**
+ * Destructor.
+ */
+archiveReader::~archiveReader()
+{
+	close();
+}
+
+
+
+/**
+ * Function maps archive, checks its header and builds list of period records.
+ * @param path - path to archive file
+ * @return zero if success, nonzero otherwise
+ */
+int archiveReader::open(const std::string &path)
+{
+	close();
+	
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd == -1)
+	{
+		fprintf(stderr, "ERROR: Unable to open archive %s!\n", path.c_str());
+		return 1;
+	}
+	
+	struct stat st;
+	if ((fstat(fd, &st) == -1) || ((size_t) st.st_size < sizeof(tArchiveHeader)))
+	{
+		fprintf(stderr, "ERROR: %s is not an archive file!\n", path.c_str());
+		::close(fd);
+		return 1;
+	}
+	
+	size = st.st_size;
+	void *p = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (p == MAP_FAILED)
+	{
+		fprintf(stderr, "ERROR: Unable to map archive %s!\n", path.c_str());
+		size = 0;
+		return 1;
+	}
+	base = (const unsigned char *) p;
+	
+	memcpy(&header, base, sizeof(header));
+	if ((memcmp(header.magic, ARCHIVE_MAGIC, sizeof(header.magic)) != 0) || (header.version != ARCHIVE_VERSION))
+	{
+		fprintf(stderr, "ERROR: %s is not an archive file of supported version!\n", path.c_str());
+		close();
+		return 1;
+	}
+	
+	// walk record headers only, columns are skipped by their lengths
+	size_t offset = sizeof(tArchiveHeader);
+	while (offset + sizeof(tArchiveRecord) <= size)
+	{
+		tArchiveRecord r;
+		memcpy(&r, base + offset, sizeof(r));
+		size_t len = sizeof(r);
+		for (int c = 0; c < SNAP_SECTIONS; c++)
+		{
+			len += r.length[c];
+		}
+		if (((offsets.empty()) && (! r.keyframe)) || (len > size - offset))
+		{
+			break;
+		}
+		offsets.push_back(offset);
+		offset += len;
+	}
+	valid = offset;
+	if (valid != size)
+	{
+		fprintf(stderr, "WARNING: %s: %lu bytes of incomplete record at the end of archive\n", path.c_str(), (unsigned long) (size - valid));
+	}
+	
+	return 0;
+}
+
+
+
+/**
+ * Function unmaps archive.
+ */
+void archiveReader::close()
+{
+	if (base != NULL)
+	{
+		munmap((void *) base, size);
+		base = NULL;
+	}
+	size = 0;
+	valid = 0;
+	offsets.clear();
+}
+
+
+
+/**
+ * Function returns archive header.
+ * @return header
+ */
+const tArchiveHeader &archiveReader::getHeader()
+{
+	return header;
+}
+
+
+
+/**
+ * Function returns number of archived periods.
+ * @return number of periods
+ */
+size_t archiveReader::count()
+{
+	return offsets.size();
+}
+
+
+
+/**
+ * Function returns length of archive without incomplete trailing record.
+ * @return length in bytes
+ */
+size_t archiveReader::validSize()
+{
+	return valid;
+}
+
+
+
+/**
+ * Function returns header of period record.
+ * @param i - index of period
+ * @return record header
+ */
+tArchiveRecord archiveReader::record(size_t i)
+{
+	tArchiveRecord r;
+	memcpy(&r, base + offsets[i], sizeof(r));
+	return r;
+}
+
+
+
+/**
+ * Function finds last period not later than provided time (binary search, periods are sorted by time).
+ * @param t - unix time
+ * @return index of period, -1 if all periods are later
+ */
+long archiveReader::find(int64_t t)
+{
+	size_t lo = 0;
+	size_t hi = offsets.size();
+	while (lo < hi)
+	{
+		size_t mid = (lo + hi) / 2;
+		if (record(mid).timestamp <= t)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+	return (long) lo - 1;
+}
+
+
+
+/**
+ * Function finds nearest keyframe at or before period (first period is always keyframe).
+ * @param i - index of period
+ * @return index of keyframe
+ */
+size_t archiveReader::keyframe(size_t i)
+{
+	while ((i > 0) && (! record(i).keyframe))
+	{
+		i--;
+	}
+	return i;
+}
+
+
+
+/**
+ * Function applies record of period to state of previous period.
+ * @param i - index of period
+ * @param mask - columns to decode (bit 1 << column id), others are left untouched
+ * @param state - state of period i - 1 (anything if i is keyframe), turned into state of period i
+ * @return zero if success, nonzero otherwise
+ */
+int archiveReader::apply(size_t i, unsigned mask, tArchivePeriod &state)
+{
+	tArchiveRecord r = record(i);
+	if (r.keyframe)
+	{
+		archiveClear(state);
+	}
+	state.timestamp = r.timestamp;
+	
+	const unsigned char *p = base + offsets[i] + sizeof(r);
+	bool ok = true;
+	for (int c = 0; c < SNAP_SECTIONS; c++)
+	{
+		const unsigned char *end = p + r.length[c];
+		if (mask & (1u << c))
+		{
+			switch (c)
+			{
+				case SNAP_POLAR:
+					ok = ok && decodeValues(p, end, state.polar.data(), 720);
+					break;
+				
+				case SNAP_ALT:
+					ok = ok && decodeValues(p, end, state.alt.data(), 501);
+					break;
+				
+				case SNAP_HEAT:
+					ok = ok && decodeHeat(p, end, state.heat);
+					break;
+				
+				case SNAP_COMPANY:
+					ok = ok && decodeCompanies(p, end, state.companies);
+					break;
+			}
+		}
+		p = end;
+	}
+	
+	if (! ok)
+	{
+		fprintf(stderr, "ERROR: Archive record of period %ld is corrupted!\n", (long) r.timestamp);
+		return 1;
+	}
+	return 0;
+}
+
+
+
+/**
+ * Function decodes state of period starting at nearest keyframe.
+ * @param i - index of period
+ * @param mask - columns to decode
+ * @param state - decoded state
+ * @return zero if success, nonzero otherwise
+ */
+int archiveReader::decode(size_t i, unsigned mask, tArchivePeriod &state)
+{
+	archiveClear(state);
+	for (size_t k = keyframe(i); k <= i; k++)
+	{
+		if (apply(k, mask, state) != 0)
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+
+
+/**
+ * Function computes change of statistics over time range - state of last period not later than to minus
+ * state of last period before from (empty statistics if range starts before first period).
+ * Both states are decoded in single pass from keyframe.
+ * @param from - start of range (unix time)
+ * @param to - end of range (unix time)
+ * @param mask - columns to decode, others stay empty
+ * @param out - change of statistics
+ * @return zero if success, nonzero otherwise
+ */
+int archiveReader::range(int64_t from, int64_t to, unsigned mask, tArchivePeriod &out)
+{
+	long last = find(to);
+	long first = (from > INT64_MIN) ? find(from - 1) : -1;
+	if ((last < 0) || (last <= first))
+	{
+		fprintf(stderr, "ERROR: No archived period within %ld:%ld!\n", (long) from, (long) to);
+		return 1;
+	}
+	
+	tArchivePeriod before, state;
+	archiveClear(before);
+	if ((first >= 0) && (decode(first, mask, before) != 0))
+	{
+		return 1;
+	}
+	
+	state = before;
+	size_t k = (first >= 0) ? first + 1 : keyframe(last);
+	for (; k <= (size_t) last; k++)
+	{
+		if (apply(k, mask, state) != 0)
+		{
+			return 1;
+		}
+	}
+	
+	archiveDiff(before, state, out);
+	return 0;
+}
+
+
+
+/**
+ * Function prints list of archived periods with encoded sizes of columns.
+ * @param path - path to archive file
+ * @return zero if success, nonzero otherwise
+ */
+int archiveList(const std::string &path)
+{
+	archiveReader r;
+	if (r.open(path) != 0)
+	{
+		return 1;
+	}
+	
+	const tArchiveHeader &h = r.getHeader();
+	printf("reference %.4f %.4f, %lu periods, keyframe every %u periods, %lu bytes\n",
+		h.refLat, h.refLon, (unsigned long) r.count(), h.keyframe, (unsigned long) r.validSize());
+	printf("%-10s  %-19s  %-3s  %8s  %8s  %8s  %8s\n", "timestamp", "time (UTC)", "key", "polar", "alt", "heat", "company");
+	for (size_t i = 0; i < r.count(); i++)
+	{
+		tArchiveRecord rec = r.record(i);
+		std::time_t t = rec.timestamp;
+		char timeBuf[32];
+		strftime(timeBuf, sizeof(timeBuf), "%Y-%m-%d %H:%M:%S", gmtime(&t));
+		printf("%-10ld  %-19s  %-3s  %8u  %8u  %8u  %8u\n", (long) rec.timestamp, timeBuf, rec.keyframe ? "yes" : "",
+			rec.length[SNAP_POLAR], rec.length[SNAP_ALT], rec.length[SNAP_HEAT], rec.length[SNAP_COMPANY]);
+	}
+	
+	return 0;
+}
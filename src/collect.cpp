@@ -0,0 +1,1132 @@
+/* DumpStats - dump1090 feed statistical data collector
+ * Copyright (C) 2015 Marcel Kebisek
+ * Contact: marcel.kebisek@gmail.com
+ * 
+ * This file is part of DumpStats.
+ * 
+ * DumpStats is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * DumpStats is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with DumpStats. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "objects.H"
+#include "collect.H"
+#include "recorder.H"
+#include "httpServer.H"
+#include "archive.H"
+#include "dedup.H"
+#include "hll.H"
+#include "ingestQueue.H"
+#include "uring.H"
+
+
+namespace
+{
+
+volatile sig_atomic_t interrupted = 0;
+
+// SIGINT handler - stops socket reading, socket is closed and program terminated by reading loop
+void f_sigint_handler(int)
+{
+	interrupted = 1;
+	return;
+}
+
+
+// Source feed of collect mode
+typedef struct feed
+{
+	std::string name;			// IP:PORT
+	int fd;						// socket, -1 when closed
+	std::vector<char> buffer;
+	size_t pending;				// bytes of incomplete line kept from previous read (more feeds only)
+	tDedupCounters counters;
+} tFeed;
+
+
+// Connect to feed, returns socket or -1
+int connectFeed(const char *hostname, const char *portStr)
+{
+	struct sockaddr_in sin;
+	struct hostent *hptr;
+	int fd;
+	
+	// Create socket
+	if ((fd = socket (PF_INET, SOCK_STREAM, 0)) < 0)
+	{
+		fprintf(stderr, "ERROR creating socket!\n");
+		return -1;
+	}
+	
+	sin.sin_family = PF_INET;		// Set protocol family to internet
+	sin.sin_port = htons(atoi(portStr));	// Set port number
+	if ((hptr = gethostbyname(hostname)) == NULL)
+	{
+		fprintf(stderr, "ERROR Gethostname error!\n");
+		close(fd);
+		return -1;
+	}
+	
+	memcpy(&sin.sin_addr, hptr->h_addr, hptr->h_length);
+	
+	// Connect
+	if (connect(fd, (struct sockaddr*)&sin, sizeof(sin)) < 0)
+	{
+		fprintf(stderr, "ERROR Connect error (%s:%s)!\n", hostname, portStr);
+		close(fd);
+		return -1;
+	}
+	
+	return fd;
+}
+
+
+// Returns monotonic time in milliseconds
+uint64_t getMonotonicMs()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+
+// Returns formatted exact time
+std::string getNanoTime()
+{
+	timespec ts;
+	
+	char buffer[80];
+	char outBuf[128];
+	
+	clock_gettime(CLOCK_REALTIME, &ts);
+	strftime(buffer, 80, "%Y-%m-%d, %H:%M:%S", gmtime(&(ts.tv_sec)));
+	sprintf(outBuf, "%s.%Ld", buffer, ts.tv_nsec);
+	return std::string(outBuf);
+}
+
+
+
+// Reader and processor of collect mode with state they share - channel between them and debug log
+class collector
+{
+	const tCollectConfig &cfg;
+	bool logging;
+	std::ofstream logf;
+	
+	// Pipe between forked processes, or ingest queue between threads in low-latency mode
+	int fds[2];
+	ingestQueue queue;
+	
+	// Open debug log and channel between reader and processor
+	int open();
+	
+	// Processor - takes feed data from channel into statistics, exports them periodically
+	int processor();
+	
+	// Reader - receives feeds (merges and records them) and hands data to processor
+	int reader();
+	
+	public:
+		collector(const tCollectConfig &c) : cfg(c), logging(! c.logFile.empty())
+		{
+			fds[0] = fds[1] = -1;
+		}
+		
+		// Run reader and processor until feeds end, returns exit status
+		int run();
+};
+
+
+
+/**
+ * Function opens debug log (if configured) and channel between reader and processor.
+ * Reader and processor are forked processes connected by pipe, or threads pinned to their CPUs
+ * connected by ingest queue in low-latency mode (-L).
+ * @return zero if success, nonzero otherwise
+ */
+int collector::open()
+{
+	if (logging)
+	{
+		logf.open(cfg.logFile);
+		if (! logf.is_open())
+		{
+			fprintf(stderr, "ERROR: Unable to open logfile!\n");
+			return 1;
+		}
+		
+		logf << "[ " << getNanoTime() << " ] Arguments successfully parsed: collect mode, ";
+		if (cfg.load)
+		{
+			logf << "loading start from " << cfg.filePath;
+		}
+		else
+		{
+			logf << "scratch start at " << cfg.refLat << ", " << cfg.refLon;
+		}
+		
+		if (cfg.display)
+		{
+			logf << ", display messages";
+		}
+		else
+		{
+			logf << ", no display";
+		}
+		
+		logf << ", listening at";
+		for (size_t i = 0; i < cfg.hosts.size(); i++)
+		{
+			logf << " " << cfg.hosts[i] << ":" << cfg.ports[i];
+		}
+		logf << "\n";
+	}
+	
+	if (cfg.lowLatency)
+	{
+		return queue.open(! cfg.busyPoll);
+	}
+	
+	// Create a pipe - both ends of pipe in fds
+	pipe(fds);
+	
+	if (logging)
+	{
+		logf << "[ " << getNanoTime() << " ] Pipe created.\n";
+	}
+	return 0;
+}
+
+
+
+/**
+ * Processor - reads feed data from pipe (or ingest queue), splits it into messages and processes them into
+ * statistics. Statistics are exported (and archived) periodically, served over HTTP and published into shared
+ * memory, if configured.
+ * @return zero when feed data ended, nonzero if processor could not start
+ */
+int collector::processor()
+{
+	TRACE_THREAD("processor");
+	if (cfg.lowLatency && (ingestPin(cfg.processorCpu) != 0))
+	{
+		fprintf(stderr, "ERROR: Unable to pin processor to CPU %d!\n", cfg.processorCpu);
+		return 1;
+	}
+	
+	// Calling different constructor based on number of provided arguments. Ternary operator used.
+	data stats = cfg.load ? data(cfg.filePath) : data(cfg.refLat, cfg.refLon);
+	if (! stats.isLoaded())
+	{
+		return 1;
+	}
+	stats.setProjection(cfg.projection);
+	stats.setHeatBudget(cfg.heatBudget);
+	
+	// Products enabled by configuration
+	bool publish = ! cfg.liveName.empty();
+	bool archive = ! cfg.archivePath.empty();
+	bool serve = (cfg.httpPort != 0);
+	bool snapshot = ! cfg.snapshotPath.empty();
+	
+	// Live statistics for other local processes
+	liveWriter live;
+	std::time_t lastPublish = 0;
+	if (publish && (live.open(cfg.liveName) != 0))
+	{
+		return 1;
+	}
+	
+	// History archive, state is appended once per ARCHIVE_PERIOD
+	archiveWriter history;
+	tArchivePeriod historyPeriod;
+	std::time_t lastArchive = std::time(nullptr) / ARCHIVE_PERIOD;
+	if (archive && (history.open(cfg.archivePath, stats.getRef().lat, stats.getRef().lon) != 0))
+	{
+		return 1;
+	}
+	
+	// HTTP server of rendered products, bodies are rendered only when requested and data changed
+	httpServer http;
+	if (serve)
+	{
+		if (http.open(cfg.httpPort) != 0)
+		{
+			return 1;
+		}
+		
+		if (stats.loadIcaoIata(cfg.execDir + "/data/iata-icao.db") != 0)
+		{
+			fprintf(stderr, "ERROR: Error while loading iata-icao database!\n");
+		}
+		
+		data *s = &stats;
+		http.addResource("/polarPlot.js", "application/javascript", [s]() { return s->getVersion(SNAP_POLAR); }, [s](std::ostream &f) { s->renderPolarJS(f); });
+		http.addResource("/heatMap.js", "application/javascript", [s]() { return s->getVersion(SNAP_HEAT); }, [s](std::ostream &f) { s->renderHeatJS(f); });
+		http.addResource("/airline.csv", "text/csv", [s]() { return s->getVersion(SNAP_COMPANY); }, [s](std::ostream &f) { s->renderAirlineCSV(f, 0); });
+		http.addResource("/altitude.csv", "text/csv", [s]() { return s->getVersion(SNAP_ALT); }, [s](std::ostream &f) { s->renderAltCSV(f); });
+		http.addResource("/stats.json", "application/json", [s]() { return s->getVersion(SNAP_POLAR) + s->getVersion(SNAP_ALT) + s->getVersion(SNAP_HEAT) + s->getVersion(SNAP_COMPANY) + s->getVersion(VERSION_MOTION); }, [s](std::ostream &f) { s->renderJSON(f); });
+	}
+	
+	if (logging)
+	{
+		logf << "[ " << getNanoTime() << " ] Created stats object.\n";
+	}
+	
+	// Processing loop - messages from reader (pipe of forked reader or ingest queue of pinned thread) into statistics
+	
+	// Periodic disk operations are driven by monotonic timer instead of wall clock,
+	// so no period is missed when feed is quiet or bursty
+	int timerFd = timerfd_create(CLOCK_MONOTONIC, 0);
+	if (timerFd < 0)
+	{
+		fprintf(stderr, "ERROR: Unable to create timer!\n");
+		return 1;
+	}
+	
+	struct itimerspec period;
+	period.it_value.tv_sec = DISK_OP_PERIOD;
+	period.it_value.tv_nsec = 0;
+	period.it_interval.tv_sec = DISK_OP_PERIOD;
+	period.it_interval.tv_nsec = 0;
+	timerfd_settime(timerFd, 0, &period, NULL);
+	
+	// Periodic export is submitted to io_uring with -U, its completions are reaped from poll loop
+	asyncWriter writer;
+	bool asyncExport = false;
+	if (cfg.uring)
+	{
+		int err = writer.open();
+		if (err == 0)
+		{
+			asyncExport = true;
+		}
+		else
+		{
+			fprintf(stderr, "io_uring not available (%s), files are exported by blocking writes.\n", strerror(err));
+		}
+	}
+	
+	struct pollfd pfds[4];
+	pfds[0].fd = cfg.lowLatency ? queue.fd() : fds[0];		// negative for busy queue
+	pfds[0].events = POLLIN;
+	pfds[1].fd = timerFd;
+	pfds[1].events = POLLIN;
+	pfds[2].fd = http.fd();		// negative (ignored by poll) without -w
+	pfds[2].events = POLLIN;
+	pfds[3].fd = asyncExport ? writer.fd() : -1;
+	pfds[3].events = POLLIN;
+	
+	// Read from pipe
+	static char buffer[65536];
+	size_t pending = 0;		// bytes of incomplete line kept from previous read
+	std::vector<tLineView> lines;
+	int result;
+	
+	// Mode S replies of Beast/AVR input and their decoder
+	std::vector<tModeSFrame> frames;
+	modeSDecoder decoder(stats.getRef().lat, stats.getRef().lon);
+	
+	// Load shedding watches backlog of pipe or queue (bytes written by reader and not read yet) against its capacity
+	int pipeSize = cfg.lowLatency ? 0 : fcntl(fds[0], F_GETPIPE_SZ);
+	size_t pipeCapacity = cfg.lowLatency ? queue.capacity() : ((pipeSize > 0) ? pipeSize : sizeof(buffer));
+	unsigned sampling = 1;
+	
+	// Messages read so far, published after each batch for load generator (dumpStatsGen)
+	uint64_t messages = 0;
+	
+	// Latency of blocks (socket read -> statistics updated) in low-latency mode
+	latencyHistogram latency;
+	uint64_t lastPoll = 0;
+	
+	if (logging)
+	{
+		logf << "[ " << getNanoTime() << " ] Starting pipe reading..\n";
+	}
+	
+	while (true)
+	{
+		TRACE_POLL();
+		
+		// Low-latency processor takes data from queue without syscall and looks at timer and HTTP server
+		// once per INGEST_POLL_NS meanwhile, it sleeps only after announcing it to reader (busy one never sleeps)
+		int timeout = -1;
+		bool check = true;
+		if (cfg.lowLatency)
+		{
+			uint64_t now = ingestNow();
+			if ((now - lastPoll < INGEST_POLL_NS) && (cfg.busyPoll || queue.available()))
+			{
+				check = false;
+			}
+			else
+			{
+				lastPoll = now;
+				if (cfg.busyPoll || (! queue.sleep()))
+				{
+					timeout = 0;
+				}
+			}
+		}
+		
+		int ready = check ? poll(pfds, 4, timeout) : 0;
+		if (cfg.lowLatency && check && (timeout < 0))
+		{
+			queue.awake();
+		}
+		if (! check)
+		{
+			pfds[0].revents = pfds[1].revents = pfds[2].revents = pfds[3].revents = 0;
+		}
+		else if (ready < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			fprintf(stderr, "ERROR: Poll error!\n");
+			break;
+		}
+		
+		// every 1 minute:
+		//	* write data to outfile
+		//	* clear old entries from flightBuffer
+		//  * truncate logfile
+		//  * append state to history archive once per hour
+		if (pfds[1].revents & POLLIN)
+		{
+			uint64_t expirations;
+			read(timerFd, &expirations, sizeof(expirations));
+			
+			if (logging)
+			{
+				logf.close();
+				logf.open(cfg.logFile);
+				logf << "[ " << getNanoTime() << " ] Logfile successfully truncuted!\n";
+			}
+			if (asyncExport)
+			{
+				// files are rendered into memory and written by kernel, export still in flight skips this period
+				if (writer.busy())
+				{
+					if (logging)
+					{
+						logf << "[ " << getNanoTime() << " ] Previous export not finished, export skipped.\n";
+					}
+				}
+				else
+				{
+					TRACE_SCOPE("export submit");
+					std::ostringstream file;
+					stats.renderFile(file);
+					std::string content = file.str();
+					result = writer.add(cfg.filePath, content);
+					stats.renderSketches(content);
+					result |= writer.add(cfg.filePath + HLL_EXTENSION, content);
+					if (snapshot)
+					{
+						stats.renderSnapshot(content);
+						result |= writer.add(cfg.snapshotPath, content);
+					}
+					result |= writer.submit();
+					if (logging && (result == 0))
+					{
+						logf << "[ " << getNanoTime() << " ] Export submitted.\n";
+					}
+				}
+			}
+			else
+			{
+				result = stats.exportFile(cfg.filePath);
+				if (logging)
+				{
+					if (result == 0)
+					{
+						logf << "[ " << getNanoTime() << " ] File successfully written.\n";
+					}
+				}
+				
+				if (snapshot)
+				{
+					result = stats.exportSnapshot(cfg.snapshotPath);
+					if (logging && (result == 0))
+					{
+						logf << "[ " << getNanoTime() << " ] Snapshot successfully written.\n";
+					}
+				}
+			}
+			
+			std::time_t now = std::time(nullptr);
+			if (archive && (now / ARCHIVE_PERIOD != lastArchive))
+			{
+				stats.exportPeriod(historyPeriod, now);
+				result = history.append(historyPeriod);
+				lastArchive = now / ARCHIVE_PERIOD;
+				if (logging && (result == 0))
+				{
+					logf << "[ " << getNanoTime() << " ] Period appended to archive.\n";
+				}
+			}
+			
+			result = stats.flushFBuffer();
+			if (logging)
+			{
+				logf << "[ " << getNanoTime() << " ] FlightBuffer flushed ( " << result << " entries deleted ).\n";
+			}
+			
+			result = stats.expireAircraft(now);
+			if (logging)
+			{
+				logf << "[ " << getNanoTime() << " ] Aircraft table expired ( " << result << " aircraft removed ).\n";
+			}
+			
+			if (logging)
+			{
+				uint64_t lookups, hits, skips;
+				stats.getCellMemoStats(lookups, hits, skips);
+				if (lookups > 0)
+				{
+					logf << "[ " << getNanoTime() << " ] Cell memo hit rate " << (100.0 * hits / lookups) << " % ( " << (100.0 * skips / lookups) << " % of positions skipped range calculation ).\n";
+				}
+				
+				if (cfg.shedding)
+				{
+					unsigned factor, peak;
+					uint64_t shed;
+					stats.getSheddingStats(factor, peak, shed);
+					logf << "[ " << getNanoTime() << " ] Sampling 1 of " << factor << " positions ( " << shed << " positions shed, highest sampling 1 of " << peak << " ).\n";
+				}
+				
+				if (cfg.lowLatency)
+				{
+					logf << "[ " << getNanoTime() << " ] Latency of " << latency.count() << " blocks: p50 " << latency.percentile(0.5) / 1000.0 << " us, p99 " << latency.percentile(0.99) / 1000.0 << " us, p99.9 " << latency.percentile(0.999) / 1000.0 << " us, max " << latency.max() / 1000.0 << " us.\n";
+				}
+			}
+		}
+		
+		if (pfds[2].revents & POLLIN)
+		{
+			TRACE_SCOPE("http");
+			http.handle();
+		}
+		
+		if (pfds[3].revents & POLLIN)
+		{
+			int failed;
+			int finished = writer.reap(false, failed);
+			if (logging && (finished > 0))
+			{
+				logf << "[ " << getNanoTime() << " ] " << finished - failed << " files successfully written, " << failed << " failed.\n";
+			}
+		}
+		
+		bool input = cfg.lowLatency ? queue.available() : (pfds[0].revents & (POLLIN | POLLHUP));
+		if (cfg.busyPoll && (! input))
+		{
+			ingestPause();
+		}
+		
+		if (input)
+		{
+			int backlog = -1;
+			if (cfg.shedding && cfg.lowLatency)
+			{
+				backlog = (int) queue.backlog();
+			}
+			else if (cfg.shedding && (ioctl(fds[0], FIONREAD, &backlog) != 0))
+			{
+				backlog = -1;
+			}
+			if (backlog >= 0)
+			{
+				unsigned previous = sampling;
+				sampling = stats.adaptSampling(backlog, pipeCapacity);
+				if ((sampling > 1) != (previous > 1))
+				{
+					unsigned factor, peak;
+					uint64_t shed;
+					stats.getSheddingStats(factor, peak, shed);
+					fprintf(stderr, "Processing %s (backlog %d bytes), %lu positions shed so far.\n",
+						(sampling > 1) ? "overloaded, sampling positions of heat map and altitude plot" : "recovered, all positions processed",
+						backlog, (unsigned long) shed);
+				}
+				if (logging && (sampling != previous))
+				{
+					logf << "[ " << getNanoTime() << " ] Backlog " << backlog << " bytes, sampling 1 of " << sampling << " positions.\n";
+				}
+			}
+			
+			ssize_t n;
+			{
+				TRACE_SCOPE("pipe read");
+				n = cfg.lowLatency ? (ssize_t) queue.read(buffer + pending, sizeof(buffer) - pending) : read(fds[0], buffer + pending, sizeof(buffer) - pending);
+			}
+			if (n <= 0)
+			{
+				break;
+			}
+			
+			// split read data into lines (SBS) or Mode S replies (Beast, AVR)
+			size_t len = pending + n;
+			size_t consumed;
+			{
+				TRACE_SCOPE("frame");
+				lines.clear();
+				frames.clear();
+				switch (cfg.inputFormat)
+				{
+					case INPUT_BEAST: consumed = frameBeast(buffer, len, frames); break;
+					case INPUT_AVR: consumed = frameAvr(buffer, len, frames); break;
+					default: consumed = frameLines(buffer, len, lines); break;
+				}
+			}
+			
+			if (cfg.display)
+			{
+				for (size_t i = 0; i < lines.size(); i++)
+				{
+					std::cout.write(lines[i].ptr, lines[i].len) << '\n';
+				}
+				for (size_t i = 0; i < frames.size(); i++)
+				{
+					std::cout << '*';
+					for (int j = 0; j < frames[i].len; j++)
+					{
+						std::cout << "0123456789ABCDEF"[frames[i].msg[j] >> 4] << "0123456789ABCDEF"[frames[i].msg[j] & 0x0F];
+					}
+					std::cout << ";\n";
+				}
+			}
+			
+			// process whole batch with single clock reading
+			std::time_t now = std::time(nullptr);
+			if (cfg.inputFormat == INPUT_SBS)
+			{
+				result = stats.processBatch(lines.data(), lines.size(), now);
+			}
+			else
+			{
+				result = stats.processFrames(decoder, frames.data(), frames.size(), now);
+			}
+			
+			messages += lines.size() + frames.size();
+			if (publish)
+			{
+				live.progress(messages);
+			}
+			
+			if (publish && (now != lastPublish))
+			{
+				stats.publishLive(live, now);
+				lastPublish = now;
+			}
+			
+			if (cfg.lowLatency)
+			{
+				queue.processed(ingestNow(), latency);
+			}
+			
+			if (logging)
+			{
+				logf << "[ " << getNanoTime() << " ] Logged " << result << " messages, discarded " << (lines.size() + frames.size() - result) << " messages.\n";
+			}
+			
+			// keep incomplete line for next read, drop overlong line
+			pending = len - consumed;
+			if (pending == sizeof(buffer))
+			{
+				pending = 0;
+			}
+			memmove(buffer, buffer + consumed, pending);
+		}
+	}
+	if (cfg.inputFormat != INPUT_SBS)
+	{
+		const tModeSCounters &c = decoder.getCounters();
+		fprintf(stderr, "Mode S: %lu replies, %lu decoded, %lu with bad CRC, %lu of unknown address; positions %lu global, %lu local, %lu not decoded\n",
+			(unsigned long) c.frames, (unsigned long) c.decoded, (unsigned long) c.badCrc, (unsigned long) c.unknown,
+			(unsigned long) c.globalCpr, (unsigned long) c.localCpr, (unsigned long) c.noPosition);
+	}
+	if (cfg.shedding)
+	{
+		unsigned factor, peak;
+		uint64_t shed;
+		stats.getSheddingStats(factor, peak, shed);
+		fprintf(stderr, "Load shedding: %lu positions shed (highest sampling 1 of %u).\n", (unsigned long) shed, peak);
+	}
+	if (cfg.lowLatency)
+	{
+		fprintf(stderr, "Latency (socket read -> statistics updated) of %lu blocks: p50 %.1f us, p90 %.1f us, p99 %.1f us, p99.9 %.1f us, max %.1f us\n",
+			(unsigned long) latency.count(), latency.percentile(0.5) / 1000.0, latency.percentile(0.9) / 1000.0,
+			latency.percentile(0.99) / 1000.0, latency.percentile(0.999) / 1000.0, latency.max() / 1000.0);
+	}
+	if (asyncExport)
+	{
+		// export in flight is finished before exit
+		int failed;
+		writer.reap(true, failed);
+	}
+	if (logging)
+	{
+		logf << "[ " << getNanoTime() << " ] Stream ended.\nProgram is correctly ending.";
+	}
+	close(timerFd);
+	return 0;
+}
+
+
+
+/**
+ * Reader - transceiver. Receives all feeds (by poll() or io_uring), merges more feeds dropping duplicates,
+ * records raw feed and hands data to processor through pipe (or ingest queue).
+ * @return zero when feeds were closed or SIGINT was caught, nonzero on error or when processor ended
+ */
+int collector::reader()
+{
+	TRACE_THREAD("reader");
+	if (cfg.lowLatency && (ingestPin(cfg.readerCpu) != 0))
+	{
+		fprintf(stderr, "ERROR: Unable to pin reader to CPU %d!\n", cfg.readerCpu);
+		return 1;
+	}
+	
+	// Initialization
+	struct sigaction sigIntHandler;
+	sigIntHandler.sa_handler = f_sigint_handler;
+	sigemptyset(&sigIntHandler.sa_mask);
+	sigIntHandler.sa_flags = 0;
+	
+	// Connect all feeds
+	std::vector<tFeed> feeds(cfg.hosts.size());
+	std::vector<struct pollfd> pfds(feeds.size());
+	for (size_t i = 0; i < feeds.size(); i++)
+	{
+		feeds[i].name = cfg.hosts[i] + ":" + cfg.ports[i];
+		feeds[i].fd = connectFeed(cfg.hosts[i].c_str(), cfg.ports[i].c_str());
+		if (feeds[i].fd < 0)
+		{
+			return -1;
+		}
+		feeds[i].buffer.resize(65536);
+		feeds[i].pending = 0;
+		memset(&feeds[i].counters, 0, sizeof(feeds[i].counters));
+		pfds[i].fd = feeds[i].fd;
+		pfds[i].events = POLLIN;
+		
+		// busy reader spins over non-blocking sockets, kernel polls device queue on empty read with SO_BUSY_POLL
+		if (cfg.busyPoll)
+		{
+			fcntl(feeds[i].fd, F_SETFL, fcntl(feeds[i].fd, F_GETFL) | O_NONBLOCK);
+#ifdef SO_BUSY_POLL
+			int busy = INGEST_BUSY_POLL_US;
+			if (setsockopt(feeds[i].fd, SOL_SOCKET, SO_BUSY_POLL, &busy, sizeof(busy)) != 0)
+			{
+				fprintf(stderr, "Feed %s: SO_BUSY_POLL not available (%s), spinning without it.\n", feeds[i].name.c_str(), strerror(errno));
+			}
+#endif
+		}
+	}
+	
+	// Raw feed recorder (writes in its own thread)
+	feedRecorder *recorder = NULL;
+	if (! cfg.recordDir.empty())
+	{
+		recorder = new feedRecorder(cfg.recordDir, cfg.recordRotate, cfg.recordCompress);
+	}
+	
+	// Single feed is forwarded in whole blocks to processor (it splits them into lines). Lines of more feeds
+	// are framed here, so they do not interleave, and positions repeated by overlapping receivers are dropped.
+	bool merge = (feeds.size() > 1);
+	feedDedup *dedup = merge ? new feedDedup() : NULL;
+	std::vector<tLineView> lines;
+	std::string out;
+	size_t active = feeds.size();
+	
+	// Forward block received from feed to processor, false if processor ended. Block read by read() follows
+	// incomplete line kept in feed buffer, received io_uring buffer is appended there (in chunks) when merging.
+	auto deliver = [&](tFeed &f, const char *data, size_t n, uint64_t readTime) -> bool
+	{
+		size_t done = 0;
+		while (done < n)
+		{
+			const char *block = data + done;
+			size_t blockLen = n - done;
+			if (merge)
+			{
+				TRACE_SCOPE("frame");
+				char *tail = f.buffer.data() + f.pending;
+				blockLen = std::min(blockLen, f.buffer.size() - f.pending);
+				if (block != tail)
+				{
+					memcpy(tail, block, blockLen);
+				}
+				done += blockLen;
+				
+				size_t len = f.pending + blockLen;
+				lines.clear();
+				size_t consumed = frameLines(f.buffer.data(), len, lines);
+				
+				uint64_t nowMs = getMonotonicMs();
+				out.clear();
+				for (size_t j = 0; j < lines.size(); j++)
+				{
+					if (dedup->filter(lines[j].ptr, lines[j].len, nowMs, f.counters) != DEDUP_DUPLICATE)
+					{
+						out.append(lines[j].ptr, lines[j].len);
+						out += '\n';
+					}
+				}
+				
+				// keep incomplete line for next read, drop overlong line
+				f.pending = len - consumed;
+				if (f.pending == f.buffer.size())
+				{
+					f.pending = 0;
+				}
+				memmove(f.buffer.data(), f.buffer.data() + consumed, f.pending);
+				
+				block = out.data();
+				blockLen = out.size();
+			}
+			else
+			{
+				done = n;
+			}
+			
+			if (recorder != NULL)
+			{
+				recorder->append(block, blockLen, std::time(nullptr));
+			}
+			
+			if (cfg.lowLatency)
+			{
+				TRACE_SCOPE("queue write");
+				if (! queue.write(block, blockLen, readTime))
+				{
+					return false;
+				}
+				continue;
+			}
+			
+			TRACE_SCOPE("pipe write");
+			size_t written = 0;
+			while (written < blockLen)
+			{
+				ssize_t w = write(fds[1], block + written, blockLen - written);
+				if (w < 0)
+				{
+					if (errno == EINTR)
+					{
+						continue;
+					}
+					// EPIPE - processor closed its end of pipe
+					return false;
+				}
+				written += w;
+			}
+		}
+		return true;
+	};
+	
+	// io_uring backend (-U) - multishot receive armed once per feed, each io_uring_enter() waits for blocks
+	// of all feeds, kernel without multishot receive falls back to poll() below before any data is received
+	ioRing ring;
+	bool useRing = false;
+	if (cfg.uring)
+	{
+		int err = ring.open(URING_ENTRIES);
+		if (err == 0)
+		{
+			err = ring.provideBuffers();
+		}
+		for (size_t i = 0; (err == 0) && (i < feeds.size()); i++)
+		{
+			if (! ring.recvMultishot(feeds[i].fd, i))
+			{
+				err = EBUSY;
+			}
+		}
+		if (err == 0)
+		{
+			useRing = true;
+		}
+		else
+		{
+			fprintf(stderr, "io_uring receive not available (%s), reading feeds by poll().\n", strerror(err));
+		}
+	}
+	
+	sigaction(SIGINT, &sigIntHandler, NULL);
+	int result = 0;
+	size_t armed = useRing ? feeds.size() : 0;
+	bool received = false;
+	bool fallback = false;
+	while (useRing && (! interrupted) && (active > 0) && (! (fallback && (armed == 0))))
+	{
+		TRACE_POLL();
+		
+		int submitted = ring.submit(cfg.busyPoll ? 0 : 1);
+		if ((submitted < 0) && (submitted != -EINTR))
+		{
+			fprintf(stderr, "ERROR: io_uring error (%s)!\n", strerror(-submitted));
+			result = -1;
+			break;
+		}
+		
+		tUringCompletion c;
+		while ((active > 0) && ring.next(c))
+		{
+			tFeed &f = feeds[c.userData];
+			if (c.res > 0)
+			{
+				uint64_t readTime = cfg.lowLatency ? ingestNow() : 0;
+				received = true;
+				bool delivered = deliver(f, ring.buffer(c), c.res, readTime);
+				ring.recycle(c);
+				if (! delivered)
+				{
+					// processor ended (and reported why)
+					result = 1;
+					active = 0;
+					break;
+				}
+			}
+			if (ioRing::more(c))
+			{
+				continue;
+			}
+			
+			// receive ended - it is armed again after running out of buffers (or when kernel ended it with data)
+			if (((c.res > 0) || (c.res == -ENOBUFS)) && ring.recvMultishot(f.fd, c.userData))
+			{
+				continue;
+			}
+			armed--;
+			if ((c.res == -EINVAL) && (! received))
+			{
+				fallback = true;
+				continue;
+			}
+			if (c.res == 0)
+			{
+				fprintf(stderr, "Feed %s closed by remote side.\n", f.name.c_str());
+			}
+			else
+			{
+				fprintf(stderr, "ERROR: Receive error of feed %s (%s)!\n", f.name.c_str(), strerror(-c.res));
+				result = -1;
+			}
+			close(f.fd);
+			f.fd = -1;
+			pfds[c.userData].fd = -1;
+			active--;
+		}
+	}
+	if (fallback)
+	{
+		fprintf(stderr, "io_uring multishot receive not supported by kernel, reading feeds by poll().\n");
+	}
+	
+	while ((! useRing || fallback) && (! interrupted) && (active > 0))
+	{
+		TRACE_POLL();
+		
+		if (cfg.busyPoll)
+		{
+			for (size_t i = 0; i < feeds.size(); i++)
+			{
+				pfds[i].revents = (pfds[i].fd >= 0) ? POLLIN : 0;
+			}
+		}
+		else if (poll(pfds.data(), pfds.size(), -1) < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			printf("ERROR Poll error!\n");
+			result = -1;
+			break;
+		}
+		
+		for (size_t i = 0; i < feeds.size(); i++)
+		{
+			if (! (pfds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+			{
+				continue;
+			}
+			
+			tFeed &f = feeds[i];
+			ssize_t n;
+			{
+				TRACE_SCOPE("socket read");
+				n = read(f.fd, f.buffer.data() + f.pending, f.buffer.size() - f.pending);
+			}
+			uint64_t readTime = cfg.lowLatency ? ingestNow() : 0;
+			if (n < 0)
+			{
+				if ((errno == EINTR) || (errno == EAGAIN) || (errno == EWOULDBLOCK))
+				{
+					continue;
+				}
+				printf("ERROR Read error!\n");
+				result = -1;
+			}
+			if (n <= 0)
+			{
+				if (n == 0)
+				{
+					fprintf(stderr, "Feed %s closed by remote side.\n", f.name.c_str());
+				}
+				close(f.fd);
+				f.fd = -1;
+				pfds[i].fd = -1;
+				active--;
+				continue;
+			}
+			
+			if (! deliver(f, f.buffer.data() + f.pending, n, readTime))
+			{
+				// processor ended (and reported why)
+				result = 1;
+				active = 0;
+				break;
+			}
+		}
+	}
+	
+	if (recorder != NULL)
+	{
+		recorder->close();
+		uint64_t blocks, bytes;
+		recorder->getDropped(blocks, bytes);
+		if (blocks > 0)
+		{
+			fprintf(stderr, "Recorder: %lu blocks (%.1f MB) dropped while disk fell behind\n", (unsigned long) blocks, bytes / (1024.0 * 1024.0));
+		}
+		delete recorder;
+	}
+	
+	if (merge)
+	{
+		for (size_t i = 0; i < feeds.size(); i++)
+		{
+			tDedupCounters &c = feeds[i].counters;
+			fprintf(stderr, "Feed %s: %lu lines, %lu positions, %lu duplicates dropped (%.1f %%)\n", feeds[i].name.c_str(),
+				(unsigned long) c.lines, (unsigned long) c.positions, (unsigned long) c.duplicates,
+				(c.positions > 0) ? 100.0 * c.duplicates / c.positions : 0.0);
+		}
+		delete dedup;
+	}
+	
+	for (size_t i = 0; i < feeds.size(); i++)
+	{
+		if (feeds[i].fd >= 0)
+		{
+			close(feeds[i].fd);
+		}
+	}
+	return result;
+}
+
+
+
+/**
+ * Function runs reader and processor - forked processor with reader in parent, or processor thread
+ * with reader in calling thread in low-latency mode.
+ * @return exit status (in both processes when forked)
+ */
+int collector::run()
+{
+	if (open() != 0)
+	{
+		return 1;
+	}
+	
+	int result;
+	if (cfg.lowLatency)
+	{
+		// SIGINT is handled by reader (main thread), processor thread is started with it blocked
+		sigset_t sigInt, previous;
+		sigemptyset(&sigInt);
+		sigaddset(&sigInt, SIGINT);
+		pthread_sigmask(SIG_BLOCK, &sigInt, &previous);
+		int processorResult = 0;
+		std::thread processorThread([&]()
+		{
+			processorResult = processor();
+			queue.abandon();
+		});
+		pthread_sigmask(SIG_SETMASK, &previous, NULL);
+		
+		result = reader();
+		
+		// processor ends after processing rest of queue
+		queue.close();
+		processorThread.join();
+		if (result == 0)
+		{
+			result = processorResult;
+		}
+	}
+	else
+	{
+		pid_t pid = fork();
+		if (pid == (pid_t) 0)
+		{
+			// Child - processor
+			TRACE_RESET();
+			
+			// Close write end of pipe
+			close(fds[1]);
+			
+			// SIGINT is handled by parent, child ends when parent closes pipe (so shared memory segment is removed)
+			signal(SIGINT, SIG_IGN);
+			
+			result = processor();
+			close(fds[0]);
+			return result;
+		}
+		
+		// Parent - reader, close read end of pipe
+		close(fds[0]);
+		
+		// Write to pipe of ended processor fails with EPIPE (reader ends then) instead of killing reader
+		signal(SIGPIPE, SIG_IGN);
+		result = reader();
+		close(fds[1]);
+		
+		// processor ends after processing rest of pipe, collector ends with it (and accounts its CPU time)
+		waitpid(pid, NULL, 0);
+	}
+	
+	if (interrupted)
+	{
+		std::cout << "SIGINT caught!\nExiting...\n";
+	}
+	return result;
+}
+
+}
+
+
+
+/**
+ * Function runs collect mode.
+ * @param cfg - configuration of collect mode
+ * @return exit status of program
+ */
+int collectFeeds(const tCollectConfig &cfg)
+{
+	collector c(cfg);
+	return c.run();
+}
@@ -0,0 +1,172 @@
+/* DumpStats - dump1090 feed statistical data collector
+ * Copyright (C) 2015 Marcel Kebisek
+ * Contact: marcel.kebisek@gmail.com
+ * 
+ * This file is part of DumpStats.
+ * 
+ * DumpStats is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * DumpStats is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with DumpStats. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dedup.H"
+
+#include <cstring>
+
+// SBS fields making up fingerprint (ICAO24, altitude, latitude, longitude)
+#define DEDUP_FIELD_HEX 4
+#define DEDUP_FIELD_ALT 11
+#define DEDUP_FIELD_LAT 14
+#define DEDUP_FIELD_LON 15
+
+
+/**
+ * Constructor.
+ */
+feedDedup::feedDedup()
+{
+	memset(slots, 0, sizeof(slots));
+	current = 0;
+	bucketStart = 0;
+}
+
+
+
+/**
+ * Function computes fingerprint of airborne position message - FNV-1a hash of text of ICAO24, altitude,
+ * latitude and longitude fields (receivers decode the same position into the same text) with final mixing.
+ * @param line - message (not null-terminated)
+ * @param len - length of message
+ * @return fingerprint, zero if line is not airborne position message with position
+ */
+uint64_t feedDedup::fingerprint(const char *line, size_t len)
+{
+	if ((len < 6) || (memcmp(line, "MSG,3,", 6) != 0))
+	{
+		return 0;
+	}
+	
+	uint64_t h = 14695981039346656037ull;
+	const char *p = line;
+	const char *end = line + len;
+	bool position = false;
+	for (int field = 0; (field <= DEDUP_FIELD_LON) && (p <= end); field++)
+	{
+		const char *comma = (const char *) memchr(p, ',', end - p);
+		const char *e = (comma != NULL) ? comma : end;
+		if ((field == DEDUP_FIELD_HEX) || (field == DEDUP_FIELD_ALT) || (field == DEDUP_FIELD_LAT) || (field == DEDUP_FIELD_LON))
+		{
+			for (const char *c = p; c < e; c++)
+			{
+				h = (h ^ (unsigned char) *c) * 1099511628211ull;
+			}
+			h = (h ^ '|') * 1099511628211ull;
+			position = (field == DEDUP_FIELD_LON) && (e > p);
+		}
+		p = e + 1;
+	}
+	if (! position)
+	{
+		return 0;
+	}
+	
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDull;
+	h ^= h >> 33;
+	return (h != 0) ? h : 1;
+}
+
+
+
+/**
+ * Function moves buckets to provided time - current bucket becomes previous one, when it is
+ * DEDUP_BUCKET_MS old, both are cleared after longer pause.
+ * @param nowMs - monotonic time in milliseconds
+ */
+void feedDedup::advance(uint64_t nowMs)
+{
+	if (nowMs < bucketStart + DEDUP_BUCKET_MS)
+	{
+		return;
+	}
+	
+	if (nowMs < bucketStart + 2 * DEDUP_BUCKET_MS)
+	{
+		current ^= 1;
+		memset(slots[current], 0, sizeof(slots[current]));
+		bucketStart += DEDUP_BUCKET_MS;
+	}
+	else
+	{
+		memset(slots, 0, sizeof(slots));
+		bucketStart = nowMs;
+	}
+}
+
+
+
+/**
+ * Function decides whether line is repeated position.
+ * @param line - message (not null-terminated)
+ * @param len - length of message
+ * @param nowMs - monotonic time of reception in milliseconds
+ * @param c - counters of source of line
+ * @return DEDUP_OTHER, DEDUP_NEW or DEDUP_DUPLICATE
+ */
+int feedDedup::filter(const char *line, size_t len, uint64_t nowMs, tDedupCounters &c)
+{
+	c.lines++;
+	uint64_t fp = fingerprint(line, len);
+	if (fp == 0)
+	{
+		return DEDUP_OTHER;
+	}
+	c.positions++;
+	
+	advance(nowMs);
+	
+	const uint64_t mask = DEDUP_SLOTS - 1;
+	const uint64_t *prev = slots[current ^ 1];
+	for (uint64_t i = 0; i < DEDUP_PROBE; i++)
+	{
+		uint64_t v = prev[(fp + i) & mask];
+		if (v == fp)
+		{
+			c.duplicates++;
+			return DEDUP_DUPLICATE;
+		}
+		if (v == 0)
+		{
+			break;
+		}
+	}
+	
+	uint64_t *cur = slots[current];
+	for (uint64_t i = 0; i < DEDUP_PROBE; i++)
+	{
+		uint64_t &v = cur[(fp + i) & mask];
+		if (v == fp)
+		{
+			c.duplicates++;
+			return DEDUP_DUPLICATE;
+		}
+		if (v == 0)
+		{
+			v = fp;
+			return DEDUP_NEW;
+		}
+	}
+	
+	// probe sequence is full - replace its first fingerprint
+	cur[fp & mask] = fp;
+	return DEDUP_NEW;
+}
@@ -19,27 +19,39 @@
  */
 
 #include "objects.H"
-
-int bsSocket;
-
-// SIGINT handler - closes basestation socket and terminates 
-void f_sigint_handler(int s)
-{
-	close(bsSocket);
-	std::cout << "SIGINT caught!\nExiting...\n";
-	exit(0);
-	return;
-}
+#include "import.H"
+#include "collect.H"
+#include "snapshot.H"
+#include "archive.H"
+#include "hll.H"
+#include "allocCheck.H"
 
 
 // Print help message
 void printHelp()
 {
-	std::cout << "\ncollect mode usage: dumpStats [-d] [-l LOGFILE] [-p LAT] [-m LON] [-f FILE] IP PORT\n\n";
+	std::cout << "\ncollect mode usage: dumpStats [-d] [-e] [-l LOGFILE] [-p LAT] [-m LON] [-f FILE] [-r DIR [-z] [-R SECONDS]] [-b SNAPSHOT] [-M NAME] [-w PORT] [-a ARCHIVE] [-s] [-F FORMAT] [-H CELLS] [-L CPU,CPU [-P]] [-U] IP PORT [IP PORT...]\n\n";
 	std::cout << "optional arguments:\n -h    show this message and exit\n -d    display incoming messages (verbose)\n -p/-m specify initial receiver position at scratch start\n";
-	std::cout << " -f    specify input/output file path in load mode and output file path in scratch mode\n -l    enable logging debug information into specified logfile (logfile contains last 1 minute of debug info. Useful for debug crashes.)\n\n\n";
-	std::cout << "convert mode usage: dumpStats -c [OUT_DIR] [-t TRESHOLD] FILE_PATH\n\n";
-	std::cout << "OUT_DIR   is a directory where JS files will be stored (current directory by default)\n -t       specify number of counts per company, below which (TRESHOLD included) company will not show in chart (useful for crowded chart)\nFILE_PATH is path to load file\n";
+	std::cout << " -f    specify input/output file path in load mode and output file path in scratch mode\n -l    enable logging debug information into specified logfile (logfile contains last 1 minute of debug info. Useful for debug crashes.)\n";
+	std::cout << " -e    compute range and bearing in local tangent plane of receiver (faster, range error below 0.15% within 450 km up to latitude 65)\n";
+	std::cout << " -r    record raw feed into segment files in directory DIR\n -z    compress recorded segments with gzip\n -R    period of segment rotation in seconds (3600 by default)\n -b    write binary snapshot for query mode to SNAPSHOT along with each file export\n -M    publish live statistics into shared memory segment NAME every second (read by dumpStatsShm)\n -w    serve JS/CSV products of convert mode and /stats.json over HTTP on localhost PORT\n -a    append hourly state of statistics to history archive ARCHIVE\n -s    shed load when processing falls behind feed - sample positions of heat map and altitude plot (polar range and airlines stay exact)\n -F    format of feed - sbs (SBS text, port 30003, default), beast (Beast binary, port 30005) or avr (AVR text, port 30002)\n -H    budget of heat map cells, sparse areas are merged into coarser blocks above it (" << HEAT_BUDGET_DEFAULT << " by default, 0 for unlimited)\n -L    low-latency mode - reader and processor run as threads pinned to CPUs READER,PROCESSOR instead of forked processes\n       (latency from socket read to statistics update is reported at exit)\n -P    busy polling in low-latency mode - spin over non-blocking sockets (with SO_BUSY_POLL) and queue instead of sleeping\n -U    io_uring backend - multishot receive of all feeds and asynchronous file export (write, fsync, rename),\n       poll() and blocking writes are used where kernel does not support it\n\nMore IP PORT pairs merge feeds of overlapping receivers - positions repeated by more feeds within 0.5-1 s are dropped.\n\n\n";
+	std::cout << "convert mode usage: dumpStats -c [OUT_DIR] [-t TRESHOLD] [-b SNAPSHOT] FILE_PATH\n\n";
+	std::cout << "OUT_DIR   is a directory where JS files will be stored (current directory by default)\n -t       specify number of counts per company, below which (TRESHOLD included) company will not show in chart (useful for crowded chart)\nFILE_PATH is path to load file\n -b       write binary snapshot of loaded file to SNAPSHOT instead of JS files\n\n\n";
+	std::cout << "import mode usage: dumpStats -i [-j THREADS] [-T FROM:TO] [-e] [-p LAT] [-m LON] [-f FILE] [-b SNAPSHOT] [-H CELLS] LOG_FILE...\n\n";
+	std::cout << "LOG_FILE  is archived SBS log (plain text, or gzip-compressed if name ends with .gz)\n -j       number of worker threads (number of CPU cores by default)\n -f       file to be extended by imported data (or output file path when starting from scratch with -p/-m)\n -T       import only data received between unix timestamps FROM and TO (recorded segments with index only)\n -b       write binary snapshot of result to SNAPSHOT\n -H       budget of heat map cells (as in collect mode)\n\n\n";
+	std::cout << "archive mode usage: dumpStats -x ARCHIVE [STATS_FILE... | -f FILE [-T FROM:TO] [-k COLUMNS]]\n\n";
+	std::cout << "ARCHIVE     is history archive of periodic statistics (created by first append)\nSTATS_FILE  is stats file to be appended as period (stamped by its export time), in time order\n";
+	std::cout << " -f         write statistics of archived periods into FILE (change of counters within range, polar range at its end)\n";
+	std::cout << " -T         range of unix timestamps FROM:TO (whole archive by default)\n -k         comma-separated columns to decode - polar, alt, heat, company (all by default, others stay empty)\n";
+	std::cout << "Without STATS_FILE and -f, archived periods are listed.\n\n\n";
+	std::cout << "distinct mode usage: dumpStats -u [-f OUT_SKETCH] SKETCH...\n\n";
+	std::cout << "SKETCH      is distinct aircraft sketch file written along with stats file (FILE.hll), sketches of more files\n            (e.g. of more stations) are merged\n -f         write merged sketches into OUT_SKETCH\n\n\n";
+	std::cout << "allocation check usage: dumpStats -A [-e] [-p LAT -m LON | -f FILE] CAPTURE...\n\n";
+	std::cout << "CAPTURE   is capture of SBS feed (plain text or gzip-compressed, e.g. recorded segment), replayed twice as in collect mode\n -f       file loaded before replay (it is not written)\nExit status is nonzero if processing of messages allocates memory in second (steady state) pass.\n\n\n";
+	std::cout << "query mode usage: dumpStats -q QUERY SNAPSHOT\n\n";
+	std::cout << "SNAPSHOT  is binary snapshot written with -b (mapped, not loaded)\nQUERY     is one of:\n";
+	std::cout << "  info                        snapshot summary\n  airlines[:N]                top N airlines with share of flights (20 by default)\n";
+	std::cout << "  range:BEARING               farthest position on bearing (0-359)\n  cells:LAT1,LON1,LAT2,LON2[:LEVEL]  heat map cells inside bounding box (merged into blocks of 2^LEVEL x 2^LEVEL cells)\n";
 	return;
 }
 
@@ -57,40 +69,52 @@ std::string get_selfpath()
 }
 
 
-// Returns formatted exact time
-std::string getNanoTime()
-{
-	timespec ts;
-	
-	char buffer[80];
-	char outBuf[128];
-	
-	clock_gettime(CLOCK_REALTIME, &ts);
-	strftime(buffer, 80, "%Y-%m-%d, %H:%M:%S", gmtime(&(ts.tv_sec)));
-	sprintf(outBuf, "%s.%Ld", buffer, ts.tv_nsec);
-	return std::string(outBuf);
-}
 
 
 
 
 int main(int argc, char **argv)
 {
+	TRACE_INIT();
+	TRACE_THREAD("main");
+	
 	// Argument parsing
-	bool scratch = false;
 	bool load = false;
 	bool convert = false;
-	bool logging = false;
+	bool import = false;
+	bool query = false;
 	int comp_treshold = 0;
-	double refLat;
-	double refLon;
+	double refLat = 0.0;
+	double refLon = 0.0;
 	std::string filePath;
-	char *hostname;
-	char *portStr;
+	std::vector<char*> hostnames;
+	std::vector<char*> portStrs;
 	std::string jsDir;
 	std::string logFile;
+	std::vector<std::string> importFiles;
+	int importThreads = std::thread::hardware_concurrency();
+	long importFrom = 0;
+	long importTo = 0;
+	std::string recordDir;
+	int recordRotate = 3600;
+	std::string snapshotPath;
+	std::string liveName;
+	int httpPort = 0;
+	int inputFormat = INPUT_SBS;
+	std::string archivePath;
+	bool archive = false;
+	unsigned archiveMask = ARCHIVE_ALL;
+	bool distinct = false;
+	bool allocTest = false;
+	size_t heatBudget = HEAT_BUDGET_DEFAULT;
+	bool lowLatency = false;
+	bool busyPoll = false;
+	bool uring = false;
+	int readerCpu = -1;
+	int processorCpu = -1;
 	
 	bool dFlag = false;
+	bool eFlag = false;
 	bool pFlag = false;
 	char *pVal = nullptr;    /* handle error condition */
 	bool mFlag = false;
@@ -102,11 +126,46 @@ int main(int argc, char **argv)
 	char *lVal = nullptr;
 	bool tFlag = false;
 	char *tVal = nullptr;
+	bool iFlag = false;
+	bool jFlag = false;
+	char *jVal = nullptr;
+	bool rFlag = false;
+	char *rVal = nullptr;
+	bool zFlag = false;
+	bool RFlag = false;
+	char *RVal = nullptr;
+	bool TFlag = false;
+	char *TVal = nullptr;
+	bool qFlag = false;
+	char *qVal = nullptr;
+	bool bFlag = false;
+	char *bVal = nullptr;
+	bool MFlag = false;
+	char *MVal = nullptr;
+	bool wFlag = false;
+	char *wVal = nullptr;
+	bool aFlag = false;
+	char *aVal = nullptr;
+	bool xFlag = false;
+	char *xVal = nullptr;
+	bool kFlag = false;
+	char *kVal = nullptr;
+	bool uFlag = false;
+	bool AFlag = false;
+	bool sFlag = false;
+	bool FFlag = false;
+	char *FVal = nullptr;
+	bool HFlag = false;
+	char *HVal = nullptr;
+	bool LFlag = false;
+	char *LVal = nullptr;
+	bool PFlag = false;
+	bool UFlag = false;
 	
 	int optIndex;
 	int c;
 	
-	while ((c = getopt(argc, argv, "hl:cdp:m:f:t:")) != -1)
+	while ((c = getopt(argc, argv, "hl:cdep:m:f:t:ij:r:zR:T:q:b:M:w:a:x:k:uAsF:H:L:PU")) != -1)
 	{
 		switch(c)
 		{
@@ -127,6 +186,10 @@ int main(int argc, char **argv)
 				dFlag = true;
 				break;
 			
+			case 'e':
+				eFlag = true;
+				break;
+			
 			case 'p':
 				pFlag = true;
 				pVal = optarg;
@@ -146,6 +209,104 @@ int main(int argc, char **argv)
 				tFlag = true;
 				tVal = optarg;
 				break;
+			
+			case 'i':
+				iFlag = true;
+				break;
+			
+			case 'j':
+				jFlag = true;
+				jVal = optarg;
+				break;
+			
+			case 'r':
+				rFlag = true;
+				rVal = optarg;
+				break;
+			
+			case 'z':
+				zFlag = true;
+				break;
+			
+			case 'R':
+				RFlag = true;
+				RVal = optarg;
+				break;
+			
+			case 'T':
+				TFlag = true;
+				TVal = optarg;
+				break;
+			
+			case 'q':
+				qFlag = true;
+				qVal = optarg;
+				break;
+			
+			case 'b':
+				bFlag = true;
+				bVal = optarg;
+				break;
+			
+			case 'M':
+				MFlag = true;
+				MVal = optarg;
+				break;
+			
+			case 'w':
+				wFlag = true;
+				wVal = optarg;
+				break;
+			
+			case 'a':
+				aFlag = true;
+				aVal = optarg;
+				break;
+			
+			case 'x':
+				xFlag = true;
+				xVal = optarg;
+				break;
+			
+			case 'k':
+				kFlag = true;
+				kVal = optarg;
+				break;
+			
+			case 'u':
+				uFlag = true;
+				break;
+			
+			case 'A':
+				AFlag = true;
+				break;
+			
+			case 's':
+				sFlag = true;
+				break;
+			
+			case 'F':
+				FFlag = true;
+				FVal = optarg;
+				break;
+			
+			case 'H':
+				HFlag = true;
+				HVal = optarg;
+				break;
+			
+			case 'L':
+				LFlag = true;
+				LVal = optarg;
+				break;
+			
+			case 'P':
+				PFlag = true;
+				break;
+			
+			case 'U':
+				UFlag = true;
+				break;
 				
 			case '?':
 				if (optopt == 'c')
@@ -170,11 +331,177 @@ int main(int argc, char **argv)
 		nonOptions.push_back(argv[optIndex]);
 	}
 	
-	if (cFlag)
+	if (bFlag)
+	{
+		snapshotPath = std::string(bVal);
+	}
+	
+	if (HFlag)
+	{
+		char *end;
+		heatBudget = strtoul(HVal, &end, 10);
+		if ((*HVal < '0') || (*HVal > '9') || (*end != '\0') || ((heatBudget > 0) && (heatBudget < HEAT_BUDGET_MIN)))
+		{
+			fprintf(stderr, "Invalid value of -H CELLS parameter! (0 for unlimited, at least %d otherwise).\n", HEAT_BUDGET_MIN);
+			exit(1);
+		}
+	}
+	
+	if (qFlag)
 	{
-		if (pFlag || mFlag || fFlag || dFlag || lFlag)
+		if (cFlag || pFlag || mFlag || fFlag || dFlag || lFlag || eFlag || tFlag || iFlag || jFlag || rFlag || zFlag || RFlag || TFlag || bFlag || MFlag || wFlag || aFlag || xFlag || kFlag || uFlag || AFlag || sFlag || FFlag || HFlag || LFlag || PFlag || UFlag)
 		{
-			fprintf(stderr, "Invalid argument usage! Convert mode does not accept other options.\n");
+			fprintf(stderr, "Invalid argument usage! Query mode does not accept other options.\n");
+			exit(1);
+		}
+		
+		if (nonOptions.size() != 1)
+		{
+			fprintf(stderr, "Invalid number of values for query mode! Snapshot file is required.\n");
+			exit(1);
+		}
+		filePath = std::string(nonOptions[0]);
+		query = true;
+	}
+	else if (uFlag)
+	{
+		if (cFlag || pFlag || mFlag || dFlag || lFlag || eFlag || tFlag || iFlag || jFlag || rFlag || zFlag || RFlag || TFlag || bFlag || MFlag || wFlag || aFlag || xFlag || kFlag || AFlag || sFlag || FFlag || HFlag || LFlag || PFlag || UFlag)
+		{
+			fprintf(stderr, "Invalid argument usage! Distinct mode accepts only -f option.\n");
+			exit(1);
+		}
+		
+		if (nonOptions.size() == 0)
+		{
+			fprintf(stderr, "Invalid number of values for distinct mode! At least one sketch file is required.\n");
+			exit(1);
+		}
+		if (fFlag)
+		{
+			filePath = std::string(fVal);
+		}
+		for (size_t i = 0; i < nonOptions.size(); i++)
+		{
+			importFiles.push_back(std::string(nonOptions[i]));
+		}
+		distinct = true;
+	}
+	else if (AFlag)
+	{
+		if (cFlag || dFlag || lFlag || tFlag || iFlag || jFlag || rFlag || zFlag || RFlag || TFlag || bFlag || MFlag || wFlag || aFlag || xFlag || kFlag || sFlag || FFlag || HFlag || LFlag || PFlag || UFlag)
+		{
+			fprintf(stderr, "Invalid argument usage! Allocation check accepts only -e, -p, -m and -f options.\n");
+			exit(1);
+		}
+		
+		if ((pFlag && !mFlag) || (!pFlag && mFlag))
+		{
+			fprintf(stderr, "Invalid argument usage! Another position coordinate is required, if starting from scratch.\n");
+			exit(1);
+		}
+		
+		if (pFlag && mFlag)
+		{
+			refLat = atof(pVal);
+			refLon = atof(mVal);
+		}
+		else if (fFlag)
+		{
+			load = true;
+			filePath = std::string(fVal);
+		}
+		else
+		{
+			fprintf(stderr, "Invalid argument usage! Load file or initial position is required.\n");
+			exit(1);
+		}
+		
+		if (nonOptions.size() < 1)
+		{
+			fprintf(stderr, "Missing arguments! At least one capture file is required!\n");
+			exit(1);
+		}
+		for (size_t i = 0; i < nonOptions.size(); i++)
+		{
+			importFiles.push_back(std::string(nonOptions[i]));
+		}
+		allocTest = true;
+	}
+	else if (xFlag)
+	{
+		if (cFlag || pFlag || mFlag || dFlag || lFlag || eFlag || tFlag || iFlag || jFlag || rFlag || zFlag || RFlag || bFlag || MFlag || wFlag || aFlag || sFlag || FFlag || HFlag || LFlag || PFlag || UFlag)
+		{
+			fprintf(stderr, "Invalid argument usage! Archive mode accepts only -f, -T and -k options.\n");
+			exit(1);
+		}
+		
+		if ((TFlag || kFlag) && !fFlag)
+		{
+			fprintf(stderr, "Invalid argument usage! Options -T and -k require output file (-f FILE).\n");
+			exit(1);
+		}
+		
+		if (fFlag && (nonOptions.size() > 0))
+		{
+			fprintf(stderr, "Invalid argument usage! Archive mode either appends stats files or writes output file.\n");
+			exit(1);
+		}
+		
+		importFrom = LONG_MIN;
+		importTo = LONG_MAX;
+		if (TFlag && (sscanf(TVal, "%ld:%ld", &importFrom, &importTo) != 2))
+		{
+			fprintf(stderr, "Invalid value of -T FROM:TO parameter!\n");
+			exit(1);
+		}
+		
+		if (kFlag)
+		{
+			archiveMask = 0;
+			std::stringstream columns(kVal);
+			std::string column;
+			while (std::getline(columns, column, ','))
+			{
+				if (column == "polar")
+				{
+					archiveMask |= 1u << SNAP_POLAR;
+				}
+				else if (column == "alt")
+				{
+					archiveMask |= 1u << SNAP_ALT;
+				}
+				else if (column == "heat")
+				{
+					archiveMask |= 1u << SNAP_HEAT;
+				}
+				else if (column == "company")
+				{
+					archiveMask |= 1u << SNAP_COMPANY;
+				}
+				else
+				{
+					fprintf(stderr, "Invalid value of -k COLUMNS parameter! Unknown column %s.\n", column.c_str());
+					exit(1);
+				}
+			}
+		}
+		
+		archivePath = std::string(xVal);
+		if (fFlag)
+		{
+			filePath = std::string(fVal);
+		}
+		for (size_t i = 0; i < nonOptions.size(); i++)
+		{
+			importFiles.push_back(std::string(nonOptions[i]));
+		}
+		archive = true;
+	}
+	else if (cFlag)
+	{
+		if (pFlag || mFlag || fFlag || dFlag || lFlag || eFlag || iFlag || jFlag || rFlag || zFlag || RFlag || TFlag || MFlag || wFlag || aFlag || kFlag || sFlag || FFlag || HFlag || LFlag || PFlag || UFlag)
+		{
+			fprintf(stderr, "Invalid argument usage! Convert mode accepts only -t and -b options.\n");
 			exit(1);
 		}
 		
@@ -205,8 +532,118 @@ int main(int argc, char **argv)
 			exit(1);
 		}
 	}
+	else if (iFlag)
+	{
+		if (dFlag || lFlag || tFlag || rFlag || zFlag || RFlag || MFlag || wFlag || aFlag || kFlag || sFlag || FFlag || LFlag || PFlag || UFlag)
+		{
+			fprintf(stderr, "Invalid argument usage! Import mode accepts only -j, -T, -e, -p, -m, -f, -b and -H options.\n");
+			exit(1);
+		}
+		
+		if (TFlag && (sscanf(TVal, "%ld:%ld", &importFrom, &importTo) != 2))
+		{
+			fprintf(stderr, "Invalid value of -T FROM:TO parameter!\n");
+			exit(1);
+		}
+		
+		if ((pFlag && !mFlag) || (!pFlag && mFlag))
+		{
+			fprintf(stderr, "Invalid argument usage! Another position coordinate is required, if starting from scratch.\n");
+			exit(1);
+		}
+		
+		if (pFlag && mFlag)
+		{
+			refLat = atof(pVal);
+			refLon = atof(mVal);
+			filePath = fFlag ? std::string(fVal) : std::string("./stats.out");
+		}
+		else if (fFlag)
+		{
+			load = true;
+			filePath = std::string(fVal);
+		}
+		else
+		{
+			fprintf(stderr, "Invalid argument usage! Load file or initial position is required.\n");
+			exit(1);
+		}
+		
+		if (jFlag)
+		{
+			importThreads = atoi(jVal);
+			if (importThreads < 1)
+			{
+				fprintf(stderr, "Invalid value of -j THREADS parameter!\n");
+				exit(1);
+			}
+		}
+		
+		if (nonOptions.size() < 1)
+		{
+			fprintf(stderr, "Missing arguments! At least one log file is required!\n");
+			exit(1);
+		}
+		for (size_t i = 0; i < nonOptions.size(); i++)
+		{
+			importFiles.push_back(std::string(nonOptions[i]));
+		}
+		import = true;
+	}
 	else
 	{
+		if (jFlag || TFlag)
+		{
+			fprintf(stderr, "Invalid argument usage! Options -j and -T are accepted only in import mode.\n");
+			exit(1);
+		}
+		
+		if (kFlag)
+		{
+			fprintf(stderr, "Invalid argument usage! Option -k is accepted only in archive mode.\n");
+			exit(1);
+		}
+		
+		if (aFlag)
+		{
+			archivePath = std::string(aVal);
+		}
+		
+		if ((zFlag || RFlag) && !rFlag)
+		{
+			fprintf(stderr, "Invalid argument usage! Options -z and -R require recording (-r DIR).\n");
+			exit(1);
+		}
+		
+		if (MFlag)
+		{
+			liveName = std::string(MVal);
+		}
+		
+		if (wFlag)
+		{
+			httpPort = atoi(wVal);
+			if ((httpPort < 1) || (httpPort > 65535))
+			{
+				fprintf(stderr, "Invalid value of -w PORT parameter!\n");
+				exit(1);
+			}
+		}
+		
+		if (rFlag)
+		{
+			recordDir = std::string(rVal);
+			if (RFlag)
+			{
+				recordRotate = atoi(RVal);
+				if (recordRotate < 1)
+				{
+					fprintf(stderr, "Invalid value of -R SECONDS parameter!\n");
+					exit(1);
+				}
+			}
+		}
+		
 		if (pFlag || mFlag)
 		{
 			if ((pFlag && !mFlag) || (!pFlag && mFlag))
@@ -217,7 +654,6 @@ int main(int argc, char **argv)
 			
 			if (pFlag && mFlag)
 			{
-				scratch = true;
 				refLat = atof(pVal);
 				refLon = atof(mVal);
 			}
@@ -233,7 +669,6 @@ int main(int argc, char **argv)
 			
 			if (lFlag)
 			{
-				logging = true;
 				logFile = std::string(lVal);
 			}
 		}
@@ -252,276 +687,228 @@ int main(int argc, char **argv)
 			
 			if (lFlag)
 			{
-				logging = true;
 				logFile = std::string(lVal);
 			}
 		}
 		
-		if (nonOptions.size() < 2)
+		if ((nonOptions.size() < 2) || (nonOptions.size() % 2 != 0))
 		{
-			fprintf(stderr, "Missing arguments! Source IP (127.0.0.1 if on localhost) and port are required!\n");
+			fprintf(stderr, "Missing arguments! Source IP (127.0.0.1 if on localhost) and port are required for each feed!\n");
 			exit(1);
 		}
 		else
 		{
-			hostname = nonOptions[0];
-			portStr = nonOptions[1];
+			for (size_t i = 0; i < nonOptions.size(); i += 2)
+			{
+				hostnames.push_back(nonOptions[i]);
+				portStrs.push_back(nonOptions[i + 1]);
+			}
 		}
-	}
-	
-	std::string execDir = get_selfpath();
 		
-	execDir = execDir.substr(0, execDir.size() - 10);
-	
-	// Convert mode
-	if (convert)
-	{
-		data stats = data(filePath);
-		
-		if (stats.createJS(jsDir, execDir, comp_treshold) == 0)
+		if (LFlag)
 		{
-			std::cout << "Converting successfull.\n";
+			if ((sscanf(LVal, "%d,%d", &readerCpu, &processorCpu) != 2) || (readerCpu < 0) || (processorCpu < 0))
+			{
+				fprintf(stderr, "Invalid value of -L READER_CPU,PROCESSOR_CPU parameter!\n");
+				exit(1);
+			}
+			lowLatency = true;
 		}
 		
-		return 0;
-	}		
-	
-	std::ofstream logf;
-	if (logging)
-	{				
-		logf.open(logFile);
-		if (! logf.is_open())
+		if (PFlag)
 		{
-			fprintf(stderr, "ERROR: Unable to open logfile!\n");
-			exit(1);
+			if (! LFlag)
+			{
+				fprintf(stderr, "Invalid argument usage! Busy polling (-P) requires low-latency mode (-L).\n");
+				exit(1);
+			}
+			busyPoll = true;
 		}
 		
-		logf << "[ " << getNanoTime() << " ] Arguments successfully parsed: ";
-		if (convert)
+		if (UFlag)
 		{
-			logf << "convert mode, ";
-			if (jsDir != "")
-			{
-				logf << "script dir is " << jsDir;
-			}
-			
-			logf << ", loading from " << filePath;
+			uring = true;
 		}
-		else
+		
+		if (FFlag)
 		{
-			logf << "collect mode, ";
-			if (load)
+			if (strcmp(FVal, "beast") == 0)
 			{
-				logf << "loading start from " << filePath;
+				inputFormat = INPUT_BEAST;
 			}
-			else
+			else if (strcmp(FVal, "avr") == 0)
 			{
-				logf << "scratch start at " << refLat << ", " << refLon;
+				inputFormat = INPUT_AVR;
 			}
-			
-			if (dFlag)
+			else if (strcmp(FVal, "sbs") != 0)
 			{
-				logf << ", display messages";
+				fprintf(stderr, "Invalid value of -F FORMAT parameter! Use sbs, beast or avr.\n");
+				exit(1);
 			}
-			else
+			
+			// merging drops duplicates of SBS lines and recorded segments are SBS logs
+			if ((inputFormat != INPUT_SBS) && ((hostnames.size() > 1) || rFlag))
 			{
-				logf << ", no display";
+				fprintf(stderr, "Invalid argument usage! Beast and AVR input accept single feed without recording (-r).\n");
+				exit(1);
 			}
-			
-			logf << ", listening at " << hostname << ":" << portStr << "\n";
 		}
 	}
-
 	
-	// array of file descriptors
-	int fds[2];
-	// Create a pipe - both ends of pipe in fds
-	pipe(fds);
-	
-	if (logging)
+	// Query mode
+	if (query)
 	{
-		logf << "[ " << getNanoTime() << " ] Pipe created.\n";
+		return runQuery(filePath, std::string(qVal));
 	}
 	
+	// Distinct mode
+	if (distinct)
+	{
+		return hllReport(importFiles, filePath);
+	}
 	
-	// Forking
-	pid_t pid;
-	pid = fork();
-	if (pid == (pid_t) 0)
+	// Allocation check
+	if (allocTest)
 	{
-		// Child - processor
-		
-		
-		// Calling different constructor based on number of provided arguments. Ternary operator used.
-
-		
 		data stats = load ? data(filePath) : data(refLat, refLon);
-		
-		if (logging)
+		if (! stats.isLoaded())
 		{
-			logf << "[ " << getNanoTime() << " ] Created stats object.\n";
+			return 1;
 		}
+		stats.setProjection(eFlag);
+		stats.setHeatBudget(heatBudget);
 		
-		// Child - data processing
-		FILE* stream;
-		
-		// Close write end of pipe
-		close (fds[1]);
-		
-		// Convert read-end-of-pipe file descriptor to FILE object
-		stream = fdopen (fds[0], "r");
-		
-		
-		// Read from pipe
-		char buffer[128];
-		int result;
-		if (logging)
+		return allocReplay(stats, importFiles);
+	}
+	
+	// Archive mode
+	if (archive)
+	{
+		if (fFlag)
 		{
-			logf << "[ " << getNanoTime() << " ] Starting pipe reading..\n";
+			archiveReader reader;
+			tArchivePeriod period;
+			if ((reader.open(archivePath) != 0) || (reader.range(importFrom, importTo, archiveMask, period) != 0))
+			{
+				return 1;
+			}
+			
+			data stats = data(reader.getHeader().refLat, reader.getHeader().refLon);
+			stats.importPeriod(period, archiveMask);
+			return stats.exportFile(filePath);
 		}
 		
-		int lastDiskOp;		// last disk operation in minutes (file write)
+		if (importFiles.empty())
+		{
+			return archiveList(archivePath);
+		}
 		
-		while (!feof(stream))
-		{			
-			// get line from pipe
-			fgets(buffer, sizeof(buffer), stream);
-			
-			// convert line to std::string
-			std::string message = buffer;
-			if (dFlag)
+		archiveWriter writer;
+		for (size_t i = 0; i < importFiles.size(); i++)
+		{
+			data stats = data(importFiles[i]);
+			if (! stats.isLoaded())
 			{
-				std::cout << message;
+				return 1;
 			}
 			
-			// process line
-			result = stats.processMessage(message);
-			
-			if (logging)
+			if ((i == 0) && (writer.open(archivePath, stats.getRef().lat, stats.getRef().lon) != 0))
 			{
-				if (result != 0)
-				{
-					logf << "[ " << getNanoTime() << " ] Logged type " << result << " message.\n";
-				}
-				else
-				{
-					logf << "[ " << getNanoTime() << " ] Discarded message.\n";
-				}
+				return 1;
 			}
 			
-			// every 1 minute:
-			//	* write data to outfile
-			//	* clear old entries from flightBuffer
-			//  * truncate logfile
-			if (((std::time(nullptr) - stats.getUptime()) % 60 == 0) && ((std::time(nullptr) / 60) != lastDiskOp))
+			tArchivePeriod period;
+			stats.exportPeriod(period, stats.getTimestamp());
+			if (writer.append(period) != 0)
 			{
-				if (logging)
-				{
-					logf.close();
-					logf.open(logFile);
-					logf << "[ " << getNanoTime() << " ] Logfile successfully truncuted!\n";
-				}
-				lastDiskOp = std::time(nullptr) / 60;
-				result = stats.exportFile(filePath);
-				if (logging)
-				{
-					if (result == 0)
-					{
-						logf << "[ " << getNanoTime() << " ] File successfully written.\n";
-					}
-				}
-	
-				result = stats.flushFBuffer();
-				if (logging)
-				{
-					logf << "[ " << getNanoTime() << " ] FlightBuffer flushed ( " << result << " entries deleted ).\n";
-				}
+				return 1;
 			}
-			
-		}
-		if (logging)
-		{
-			logf << "[ " << getNanoTime() << " ] Stream ended.\nProgram is correctly ending.";
 		}
-		fclose(stream);
+		
 		return 0;
 	}
 	
+	std::string execDir = get_selfpath();
+		
+	execDir = execDir.substr(0, execDir.size() - 10);
 	
-	
-	else
+	// Convert mode
+	if (convert)
 	{
-		// Parent - transceiver
-		FILE* stream;
-		
-		//Close read end of pipe
-		close (fds[0]);
-		
-		// Convert write-end-of-pipe file descriptor to FILE object
-		stream = fdopen (fds[1], "w");
-		
-		// Initialization
-		int n;
-		struct sockaddr_in sin;
-		struct hostent *hptr;
-		
-		struct sigaction sigIntHandler;
-		sigIntHandler.sa_handler = f_sigint_handler;
-		sigemptyset(&sigIntHandler.sa_mask);
-		sigIntHandler.sa_flags = 0;
-		
-		
-		char buffer[1];
+		data stats = data(filePath);
+		if (! stats.isLoaded())
+		{
+			return 1;
+		}
 		
+		if (bFlag)
+		{
+			return stats.exportSnapshot(snapshotPath);
+		}
 		
-		// Create socket
-		if ((bsSocket = socket (PF_INET, SOCK_STREAM, 0)) < 0)
+		if (stats.createJS(jsDir, execDir, comp_treshold) == 0)
 		{
-			fprintf(stderr, "ERROR creating socket!\n");
-			return -1;
+			std::cout << "Converting successfull.\n";
 		}
-
-		sin.sin_family = PF_INET;		// Set protocol family to internet
-		sin.sin_port = htons(atoi(portStr));	// Set port number
-		if ((hptr = gethostbyname(hostname)) == NULL)
+		
+		return 0;
+	}
+	
+	// Import mode
+	if (import)
+	{
+		data stats = load ? data(filePath) : data(refLat, refLon);
+		if (! stats.isLoaded())
 		{
-			fprintf(stderr, "ERROR Gethostname error!\n");
-			return -1;
+			return 1;
 		}
-
-		memcpy(&sin.sin_addr, hptr->h_addr, hptr->h_length);
+		stats.setHeatBudget(heatBudget);
+		
+		int result = importLogs(stats, importFiles, importThreads, eFlag, importFrom, importTo);
 		
-		// Connect
-		if (connect(bsSocket, (struct sockaddr*)&sin, sizeof(sin)) < 0)
+		if (stats.exportFile(filePath) != 0)
 		{
-			fprintf(stderr, "ERROR Connect error!\n");
-			return -1;
+			return 1;
 		}
 		
-		// Read periodically
-		sigaction(SIGINT, &sigIntHandler, NULL);
-		int counter = 1;
-		std::string message ("");
-		while (true)
+		if (bFlag && (stats.exportSnapshot(snapshotPath) != 0))
 		{
-			if ((n = read(bsSocket, buffer, sizeof(buffer))) < 0)
-			{
-				printf("ERROR Read error!\n");
-				return -1;
-			}
-			
-			if (buffer[0] == '\n')
-			{			
-				fprintf(stream, "%s\n", message.c_str());
-				fflush(stream);
-				message = "";
-			}
-			else
-			{
-				message += buffer[0];
-			}
+			return 1;
 		}
-		fclose(stream);
-		return 0;
+		
+		return result;
 	}
+	
+	// Collect mode
+	tCollectConfig cfg;
+	for (size_t i = 0; i < hostnames.size(); i++)
+	{
+		cfg.hosts.push_back(hostnames[i]);
+		cfg.ports.push_back(portStrs[i]);
+	}
+	cfg.inputFormat = inputFormat;
+	cfg.load = load;
+	cfg.filePath = filePath;
+	cfg.refLat = refLat;
+	cfg.refLon = refLon;
+	cfg.projection = eFlag;
+	cfg.heatBudget = heatBudget;
+	cfg.shedding = sFlag;
+	cfg.display = dFlag;
+	cfg.execDir = execDir;
+	cfg.logFile = logFile;
+	cfg.snapshotPath = snapshotPath;
+	cfg.liveName = liveName;
+	cfg.httpPort = httpPort;
+	cfg.archivePath = archivePath;
+	cfg.recordDir = recordDir;
+	cfg.recordRotate = recordRotate;
+	cfg.recordCompress = zFlag;
+	cfg.lowLatency = lowLatency;
+	cfg.busyPoll = busyPoll;
+	cfg.readerCpu = readerCpu;
+	cfg.processorCpu = processorCpu;
+	cfg.uring = uring;
+	
+	return collectFeeds(cfg);
 }
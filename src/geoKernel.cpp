@@ -0,0 +1,308 @@
+/* DumpStats - dump1090 feed statistical data collector
+ * Copyright (C) 2015 Marcel Kebisek
+ * Contact: marcel.kebisek@gmail.com
+ * 
+ * This file is part of DumpStats.
+ * 
+ * DumpStats is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * DumpStats is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with DumpStats. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "geoMath.H"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#define GEO_X86
+#endif
+
+
+namespace
+{
+
+// Plain float "vector" of single lane
+struct vScalar
+{
+	typedef float F;
+	typedef bool M;
+	static const size_t W = 1;
+
+	static inline F set(float a) { return a; }
+	static inline F add(F a, F b) { return a + b; }
+	static inline F sub(F a, F b) { return a - b; }
+	static inline F mul(F a, F b) { return a * b; }
+	static inline F div(F a, F b) { return a / b; }
+	static inline F sqrt(F a) { return std::sqrt(a); }
+	static inline F abs(F a) { return std::fabs(a); }
+	static inline F min(F a, F b) { return (a < b) ? a : b; }
+	static inline F max(F a, F b) { return (a > b) ? a : b; }
+	static inline M lt(F a, F b) { return a < b; }
+	static inline M gt(F a, F b) { return a > b; }
+	static inline F sel(M m, F a, F b) { return m ? a : b; }
+
+	static inline F loadDelta(const double *p, double ref, bool wrap)
+	{
+		double d = p[0] - ref;
+		if (wrap)
+		{
+			if (d > 180.0)
+			{
+				d -= 360.0;
+			}
+			else if (d < -180.0)
+			{
+				d += 360.0;
+			}
+		}
+		return (float) (d * (M_PI / 180.0));
+	}
+
+	static inline F loadRad(const double *p)
+	{
+		return (float) (p[0] * (M_PI / 180.0));
+	}
+
+	static inline void storeBins(int *out, F deg)
+	{
+		int bin = (int) (deg + 0.5f);
+		out[0] = (bin >= 360) ? 0 : bin;
+	}
+
+	static inline void storeDist(double *out, F km)
+	{
+		out[0] = km;
+	}
+};
+
+
+#ifdef GEO_X86
+// SSE2 - 4 float lanes (baseline of every x86-64 CPU)
+struct vSse2
+{
+	typedef __m128 F;
+	typedef __m128 M;
+	static const size_t W = 4;
+
+	static inline F set(float a) { return _mm_set1_ps(a); }
+	static inline F add(F a, F b) { return _mm_add_ps(a, b); }
+	static inline F sub(F a, F b) { return _mm_sub_ps(a, b); }
+	static inline F mul(F a, F b) { return _mm_mul_ps(a, b); }
+	static inline F div(F a, F b) { return _mm_div_ps(a, b); }
+	static inline F sqrt(F a) { return _mm_sqrt_ps(a); }
+	static inline F abs(F a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+	static inline F min(F a, F b) { return _mm_min_ps(a, b); }
+	static inline F max(F a, F b) { return _mm_max_ps(a, b); }
+	static inline M lt(F a, F b) { return _mm_cmplt_ps(a, b); }
+	static inline M gt(F a, F b) { return _mm_cmpgt_ps(a, b); }
+	static inline F sel(M m, F a, F b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+
+	static inline __m128d delta2(const double *p, __m128d ref, bool wrap)
+	{
+		__m128d d = _mm_sub_pd(_mm_loadu_pd(p), ref);
+		if (wrap)
+		{
+			__m128d full = _mm_set1_pd(360.0);
+			d = _mm_sub_pd(d, _mm_and_pd(_mm_cmpgt_pd(d, _mm_set1_pd(180.0)), full));
+			d = _mm_add_pd(d, _mm_and_pd(_mm_cmplt_pd(d, _mm_set1_pd(-180.0)), full));
+		}
+		return _mm_mul_pd(d, _mm_set1_pd(M_PI / 180.0));
+	}
+
+	static inline F loadDelta(const double *p, double ref, bool wrap)
+	{
+		__m128d r = _mm_set1_pd(ref);
+		return _mm_movelh_ps(_mm_cvtpd_ps(delta2(p, r, wrap)), _mm_cvtpd_ps(delta2(p + 2, r, wrap)));
+	}
+
+	static inline F loadRad(const double *p)
+	{
+		return loadDelta(p, 0.0, false);
+	}
+
+	static inline void storeBins(int *out, F deg)
+	{
+		__m128i bin = _mm_cvttps_epi32(_mm_add_ps(deg, _mm_set1_ps(0.5f)));
+		bin = _mm_andnot_si128(_mm_cmpeq_epi32(bin, _mm_set1_epi32(360)), bin);
+		_mm_storeu_si128((__m128i *) out, bin);
+	}
+
+	static inline void storeDist(double *out, F km)
+	{
+		_mm_storeu_pd(out, _mm_cvtps_pd(km));
+		_mm_storeu_pd(out + 2, _mm_cvtps_pd(_mm_movehl_ps(km, km)));
+	}
+};
+#endif
+
+
+typedef void (*tGeoBatchFn)(const tGeoRef &, const double *, const double *, size_t, int *, double *);
+
+tGeoBatchFn selectedKernel = NULL;
+const char *selectedName = "";
+
+
+// Select widest kernel supported by running CPU
+void geoSelectKernel()
+{
+#ifdef GEO_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	{
+		selectedKernel = geoBatchAvx2;
+		selectedName = "avx2";
+		return;
+	}
+	selectedKernel = geoKernel<vSse2>;
+	selectedName = "sse2";
+#else
+	selectedKernel = geoKernel<vScalar>;
+	selectedName = "scalar";
+#endif
+}
+
+}
+
+
+
+/**
+ * Function precomputes reference terms used by batched kernel.
+ * @param g - structure to be filled
+ * @param lat - reference latitude in decimal degrees
+ * @param lon - reference longitude in decimal degrees
+ */
+void geoRefInit(tGeoRef &g, double lat, double lon)
+{
+	g.lat = lat;
+	g.lon = lon;
+	g.latRad = lat * (M_PI / 180.0);
+	g.sinLat = std::sin(g.latRad);
+	g.cosLat = std::cos(g.latRad);
+	g.kmPerDeg = GEO_EARTH_RADIUS * (M_PI / 180.0);
+}
+
+
+
+/**
+ * Function computes bearing bins and distances from reference for array of positions.
+ * Kernel variant (AVX2, SSE2 or scalar) is selected on first call.
+ * @param g - precomputed reference
+ * @param lat - array of latitudes in decimal degrees
+ * @param lon - array of longitudes in decimal degrees
+ * @param n - number of positions
+ * @param bins - output array of bearing bins (0-359)
+ * @param dist - output array of distances in km
+ */
+void geoBatch(const tGeoRef &g, const double *lat, const double *lon, size_t n, int *bins, double *dist)
+{
+	if (selectedKernel == NULL)
+	{
+		geoSelectKernel();
+	}
+	selectedKernel(g, lat, lon, n, bins, dist);
+}
+
+
+
+/**
+ * Function computes bearing bins and distances using scalar fallback of kernel.
+ * Parameters are the same as for geoBatch().
+ */
+void geoBatchScalar(const tGeoRef &g, const double *lat, const double *lon, size_t n, int *bins, double *dist)
+{
+	geoKernel<vScalar>(g, lat, lon, n, bins, dist);
+}
+
+
+
+#ifdef GEO_X86
+/**
+ * Function computes bearing bins and distances using SSE2 variant of kernel.
+ * Parameters are the same as for geoBatch().
+ */
+void geoBatchSse2(const tGeoRef &g, const double *lat, const double *lon, size_t n, int *bins, double *dist)
+{
+	geoKernel<vSse2>(g, lat, lon, n, bins, dist);
+}
+#endif
+
+
+
+/**
+ * Function computes bearing bins and distances in local tangent plane of reference.
+ * Position is projected to east/north kilometers (equirectangular projection scaled by cosine
+ * of mid latitude, which is taken from second order expansion around reference latitude),
+ * so each position costs a few multiplications, one sqrt and one atan2.
+ * Within GEO_PROJ_MAX_RANGE of reference, maximum error against getDistance()/getBearing() is:
+ *   reference latitude   0 deg: 0.03 km (0.007 %), 0.004 deg
+ *   reference latitude  45 deg: 0.14 km (0.03 %),  0.013 deg
+ *   reference latitude  55 deg: 0.26 km (0.06 %),  0.022 deg
+ *   reference latitude  65 deg: 0.56 km (0.12 %),  0.046 deg
+ *   reference latitude  75 deg: 1.76 km (0.39 %),  0.145 deg
+ * (bounds are checked by make test). Positions projected farther than GEO_PROJ_MAX_RANGE are recomputed
+ * by scalar geodesic kernel.
+ * Parameters are the same as for geoBatch().
+ */
+void geoBatchProjected(const tGeoRef &g, const double *lat, const double *lon, size_t n, int *bins, double *dist)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		double dLat = lat[i] - g.lat;
+		double dLon = lon[i] - g.lon;
+		if (dLon > 180.0)
+		{
+			dLon -= 360.0;
+		}
+		else if (dLon < -180.0)
+		{
+			dLon += 360.0;
+		}
+		
+		// cos(refLat + dLat / 2)
+		double h = dLat * (M_PI / 360.0);
+		double cosMid = g.cosLat * (1.0 - 0.5 * h * h) - g.sinLat * h;
+		
+		double east = g.kmPerDeg * dLon * cosMid;
+		double north = g.kmPerDeg * dLat;
+		double d = std::sqrt(east * east + north * north);
+		
+		if (d > GEO_PROJ_MAX_RANGE)
+		{
+			geoKernel<vScalar>(g, lat + i, lon + i, 1, bins + i, dist + i);
+			continue;
+		}
+		
+		double brg = std::atan2(east, north) * (180.0 / M_PI);
+		if (brg < 0.0)
+		{
+			brg += 360.0;
+		}
+		
+		int bin = (int) (brg + 0.5);
+		bins[i] = (bin >= 360) ? 0 : bin;
+		dist[i] = d;
+	}
+}
+
+
+
+/**
+ * Function returns name of kernel variant used by geoBatch().
+ * @return "avx2", "sse2" or "scalar"
+ */
+const char *geoKernelName()
+{
+	if (selectedKernel == NULL)
+	{
+		geoSelectKernel();
+	}
+	return selectedName;
+}
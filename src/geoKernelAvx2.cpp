@@ -0,0 +1,100 @@
+/* DumpStats - dump1090 feed statistical data collector
+ * Copyright (C) 2015 Marcel Kebisek
+ * Contact: marcel.kebisek@gmail.com
+ * 
+ * This file is part of DumpStats.
+ * 
+ * DumpStats is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * DumpStats is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with DumpStats. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file is compiled with AVX2 enabled. It is only called after runtime check in geoKernel.cpp.
+
+#include "geoMath.H"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+namespace
+{
+
+// AVX2 - 8 float lanes
+struct vAvx2
+{
+	typedef __m256 F;
+	typedef __m256 M;
+	static const size_t W = 8;
+
+	static inline F set(float a) { return _mm256_set1_ps(a); }
+	static inline F add(F a, F b) { return _mm256_add_ps(a, b); }
+	static inline F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+	static inline F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+	static inline F div(F a, F b) { return _mm256_div_ps(a, b); }
+	static inline F sqrt(F a) { return _mm256_sqrt_ps(a); }
+	static inline F abs(F a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+	static inline F min(F a, F b) { return _mm256_min_ps(a, b); }
+	static inline F max(F a, F b) { return _mm256_max_ps(a, b); }
+	static inline M lt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	static inline M gt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+	static inline F sel(M m, F a, F b) { return _mm256_blendv_ps(b, a, m); }
+
+	static inline __m128 delta4(const double *p, __m256d ref, bool wrap)
+	{
+		__m256d d = _mm256_sub_pd(_mm256_loadu_pd(p), ref);
+		if (wrap)
+		{
+			__m256d full = _mm256_set1_pd(360.0);
+			d = _mm256_sub_pd(d, _mm256_and_pd(_mm256_cmp_pd(d, _mm256_set1_pd(180.0), _CMP_GT_OQ), full));
+			d = _mm256_add_pd(d, _mm256_and_pd(_mm256_cmp_pd(d, _mm256_set1_pd(-180.0), _CMP_LT_OQ), full));
+		}
+		return _mm256_cvtpd_ps(_mm256_mul_pd(d, _mm256_set1_pd(M_PI / 180.0)));
+	}
+
+	static inline F loadDelta(const double *p, double ref, bool wrap)
+	{
+		__m256d r = _mm256_set1_pd(ref);
+		return _mm256_insertf128_ps(_mm256_castps128_ps256(delta4(p, r, wrap)), delta4(p + 4, r, wrap), 1);
+	}
+
+	static inline F loadRad(const double *p)
+	{
+		return loadDelta(p, 0.0, false);
+	}
+
+	static inline void storeBins(int *out, F deg)
+	{
+		__m256i bin = _mm256_cvttps_epi32(_mm256_add_ps(deg, _mm256_set1_ps(0.5f)));
+		bin = _mm256_andnot_si256(_mm256_cmpeq_epi32(bin, _mm256_set1_epi32(360)), bin);
+		_mm256_storeu_si256((__m256i *) out, bin);
+	}
+
+	static inline void storeDist(double *out, F km)
+	{
+		_mm256_storeu_pd(out, _mm256_cvtps_pd(_mm256_castps256_ps128(km)));
+		_mm256_storeu_pd(out + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(km, 1)));
+	}
+};
+
+}
+
+
+/**
+ * Function computes bearing bins and distances using AVX2 variant of kernel.
+ * Parameters are the same as for geoBatch().
+ */
+void geoBatchAvx2(const tGeoRef &g, const double *lat, const double *lon, size_t n, int *bins, double *dist)
+{
+	geoKernel<vAvx2>(g, lat, lon, n, bins, dist);
+}
+
+#endif
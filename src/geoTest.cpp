@@ -0,0 +1,242 @@
+/* DumpStats - dump1090 feed statistical data collector
+ * Copyright (C) 2015 Marcel Kebisek
+ * Contact: marcel.kebisek@gmail.com
+ * 
+ * This file is part of DumpStats.
+ * 
+ * DumpStats is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * DumpStats is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with DumpStats. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// geoTest - checks batched geodesic kernels and local projection against getBearing()/getDistance() (run by make test)
+
+#include "objects.H"
+#include "geoKernel.H"
+
+#include <cstdio>
+#include <cmath>
+#include <vector>
+
+
+// Bounds of batched kernel within polarRange domain
+#define TEST_MAX_RANGE 1000.0
+#define TEST_MAX_LAT 75.0
+#define TEST_BEARING_TOL 0.1
+#define TEST_DIST_TOL 0.01
+
+// Positions tested per reference position
+#define TEST_POSITIONS 4001
+
+
+typedef void (*tKernelFn)(const tGeoRef &, const double *, const double *, size_t, int *, double *);
+
+// Maximum errors of kernel
+typedef struct testError
+{
+	double bearing;				// bearing beyond rounding of bin, degrees
+	double dist;				// km
+	size_t failed;
+} tTestError;
+
+
+// Small deterministic generator, so failures are reproducible
+static uint64_t testState = 0x9E3779B97F4A7C15ull;
+
+static double testRandom()
+{
+	testState ^= testState << 13;
+	testState ^= testState >> 7;
+	testState ^= testState << 17;
+	return (testState >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+/**
+ * Function computes position at great circle distance and initial bearing from reference.
+ * @param ref - reference position
+ * @param brg - initial bearing in degrees
+ * @param km - distance in km
+ * @return destination position
+ */
+static tCoords testDestination(tCoords ref, double brg, double km)
+{
+	double d = km / EARTH_RADIUS;
+	double p1 = toRadians(ref.lat);
+	double b = toRadians(brg);
+	double p2 = asin(sin(p1) * cos(d) + cos(p1) * sin(d) * cos(b));
+	double l2 = toRadians(ref.lon) + atan2(sin(b) * sin(d) * cos(p1), cos(d) - sin(p1) * sin(p2));
+	
+	tCoords c;
+	c.lat = toDegrees(p2);
+	c.lon = fmod(toDegrees(l2) + 540.0, 360.0) - 180.0;
+	return c;
+}
+
+
+/**
+ * Function returns error of bearing bin against exact bearing (part exceeding rounding to whole degree).
+ * @param bin - bearing bin (0-359)
+ * @param brg - exact bearing in degrees
+ * @return error in degrees, zero if bin is the nearest whole degree
+ */
+static double testBinError(int bin, double brg)
+{
+	double diff = fabs(bin - brg);
+	diff = std::min(diff, 360.0 - diff);
+	return std::max(0.0, diff - 0.5);
+}
+
+
+/**
+ * Function runs kernel over random positions around reference and records its largest errors.
+ * @param fn - kernel
+ * @param refLat - reference latitude
+ * @param refLon - reference longitude
+ * @param maxRange - largest distance of positions (km)
+ * @param bearingTol - allowed bearing error (degrees)
+ * @param distTol - allowed distance error (km)
+ * @param e - errors are accumulated here
+ */
+static void testKernel(tKernelFn fn, double refLat, double refLon, double maxRange, double bearingTol, double distTol, tTestError &e)
+{
+	tGeoRef g;
+	geoRefInit(g, refLat, refLon);
+	tCoords ref;
+	ref.lat = refLat;
+	ref.lon = refLon;
+	
+	// odd count, so vector kernels run their padded tail too
+	std::vector<double> lat(TEST_POSITIONS), lon(TEST_POSITIONS), dist(TEST_POSITIONS);
+	std::vector<int> bins(TEST_POSITIONS);
+	for (size_t i = 0; i < TEST_POSITIONS; i++)
+	{
+		tCoords p = testDestination(ref, 360.0 * testRandom(), 0.5 + (maxRange - 0.5) * sqrt(testRandom()));
+		lat[i] = p.lat;
+		lon[i] = p.lon;
+	}
+	
+	fn(g, lat.data(), lon.data(), TEST_POSITIONS, bins.data(), dist.data());
+	
+	for (size_t i = 0; i < TEST_POSITIONS; i++)
+	{
+		// longitude is unwrapped next to reference, getBearing() does not wrap difference across antimeridian correctly
+		tCoords p;
+		p.lat = lat[i];
+		p.lon = lon[i];
+		if (p.lon - refLon > 180.0)
+		{
+			p.lon -= 360.0;
+		}
+		else if (p.lon - refLon < -180.0)
+		{
+			p.lon += 360.0;
+		}
+		double bearingErr = testBinError(bins[i], getBearing(ref, p));
+		double distErr = fabs(dist[i] - getDistance(ref, p));
+		e.bearing = std::max(e.bearing, bearingErr);
+		e.dist = std::max(e.dist, distErr);
+		if ((bearingErr > bearingTol) || (distErr > distTol) || (bins[i] < 0) || (bins[i] > 359))
+		{
+			if (e.failed++ < 5)
+			{
+				fprintf(stderr, "ERROR: reference %.2f,%.2f position %.5f,%.5f: bin %d (bearing %.4f), distance %.4f km (expected %.4f)\n",
+					refLat, refLon, p.lat, p.lon, bins[i], getBearing(ref, p), dist[i], getDistance(ref, p));
+			}
+		}
+	}
+}
+
+
+/**
+ * Function checks vector and scalar variants of batched kernel within polarRange domain.
+ * @param name - variant name
+ * @param fn - kernel
+ * @return number of failed positions
+ */
+static size_t testBatch(const char *name, tKernelFn fn)
+{
+	tTestError e = {0.0, 0.0, 0};
+	for (double refLat = -TEST_MAX_LAT; refLat <= TEST_MAX_LAT; refLat += 5.0)
+	{
+		// ordinary longitude and reference next to antimeridian
+		testKernel(fn, refLat, 17.1, TEST_MAX_RANGE, TEST_BEARING_TOL, TEST_DIST_TOL, e);
+		testKernel(fn, refLat, 179.5, TEST_MAX_RANGE, TEST_BEARING_TOL, TEST_DIST_TOL, e);
+	}
+	printf("%-10s bearing error %.4f deg, distance error %.4f km, %s\n", name, e.bearing, e.dist, (e.failed == 0) ? "ok" : "FAILED");
+	return e.failed;
+}
+
+
+// Error bounds of local tangent plane projection documented at geoBatchProjected() (geoKernel.cpp)
+typedef struct projBound
+{
+	double refLat;
+	double dist;				// km
+	double bearing;				// degrees
+} tProjBound;
+
+static const tProjBound projBounds[] =
+{
+	{0.0, 0.03, 0.004},
+	{45.0, 0.14, 0.013},
+	{55.0, 0.26, 0.022},
+	{65.0, 0.56, 0.046},
+	{75.0, 1.76, 0.145}
+};
+
+
+/**
+ * Function checks projected kernel against error table of its documentation within GEO_PROJ_MAX_RANGE,
+ * on both hemispheres.
+ * @return number of failed positions
+ */
+static size_t testProjected()
+{
+	size_t failed = 0;
+	for (size_t i = 0; i < sizeof(projBounds) / sizeof(projBounds[0]); i++)
+	{
+		const tProjBound &b = projBounds[i];
+		tTestError e = {0.0, 0.0, 0};
+		testKernel(geoBatchProjected, b.refLat, 17.1, GEO_PROJ_MAX_RANGE, b.bearing, b.dist, e);
+		testKernel(geoBatchProjected, -b.refLat, 17.1, GEO_PROJ_MAX_RANGE, b.bearing, b.dist, e);
+		testKernel(geoBatchProjected, b.refLat, 179.5, GEO_PROJ_MAX_RANGE, b.bearing, b.dist, e);
+		printf("projected  latitude %2.0f: bearing error %.4f deg (bound %.3f), distance error %.4f km (bound %.2f), %s\n",
+			b.refLat, e.bearing, b.bearing, e.dist, b.dist, (e.failed == 0) ? "ok" : "FAILED");
+		failed += e.failed;
+	}
+	return failed;
+}
+
+
+int main()
+{
+	size_t failed = 0;
+	
+	failed += testBatch("scalar", geoBatchScalar);
+#if defined(__x86_64__) || defined(__i386__)
+	failed += testBatch("sse2", geoBatchSse2);
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	{
+		failed += testBatch("avx2", geoBatchAvx2);
+	}
+	else
+	{
+		printf("avx2       not supported by CPU, skipped\n");
+	}
+#endif
+	failed += testBatch("geoBatch", geoBatch);
+	failed += testProjected();
+	
+	return (failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,850 @@
+/* DumpStats - dump1090 feed statistical data collector
+ * Copyright (C) 2015 Marcel Kebisek
+ * Contact: marcel.kebisek@gmail.com
+ * 
+ * This file is part of DumpStats.
+ * 
+ * DumpStats is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * DumpStats is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with DumpStats. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "heatGrid.H"
+
+#include <algorithm>
+
+
+// Initial size of hash table
+#define HEAT_INITIAL_SLOTS 1024
+
+// Distance of prefetch ahead of current cell in addBatch()
+#define HEAT_PREFETCH_AHEAD 16
+
+
+/**
+ * Comparator of cells by Morton code.
+ */
+static bool heatLess(const tHeatCell &a, const tHeatCell &b)
+{
+	return a.code < b.code;
+}
+
+
+
+/**
+ * Function sets bit of one dimension in Morton code and clears all lower bits of the same dimension
+ * (smallest code of upper half of split).
+ * @param z - Morton code
+ * @param bit - bit position
+ * @return modified code
+ */
+static uint32_t heatLoadUpper(uint32_t z, int bit)
+{
+	uint32_t lower = ((bit & 1) ? 0xAAAAAAAAu : 0x55555555u) & ((1u << bit) - 1);
+	return (z & ~lower) | (1u << bit);
+}
+
+/**
+ * Function clears bit of one dimension in Morton code and sets all lower bits of the same dimension
+ * (largest code of lower half of split).
+ * @param z - Morton code
+ * @param bit - bit position
+ * @return modified code
+ */
+static uint32_t heatLoadLower(uint32_t z, int bit)
+{
+	uint32_t lower = ((bit & 1) ? 0xAAAAAAAAu : 0x55555555u) & ((1u << bit) - 1);
+	return (z & ~(1u << bit)) | lower;
+}
+
+
+
+/**
+ * Function finds smallest Morton code inside box greater than code outside box
+ * (BIGMIN of Tropf and Herzog). Box is given by codes of its minimal and maximal corner.
+ * @param code - code between zmin and zmax lying outside box
+ * @param zmin - code of minimal corner
+ * @param zmax - code of maximal corner
+ * @return next code inside box
+ */
+static uint32_t heatBigMin(uint32_t code, uint32_t zmin, uint32_t zmax)
+{
+	uint32_t bigmin = zmax;
+	for (int bit = 31; bit >= 0; bit--)
+	{
+		int v = (code >> bit) & 1;
+		int lo = (zmin >> bit) & 1;
+		int hi = (zmax >> bit) & 1;
+		
+		if ((v == 0) && (lo == 0) && (hi == 1))
+		{
+			bigmin = heatLoadUpper(zmin, bit);
+			zmax = heatLoadLower(zmax, bit);
+		}
+		else if ((v == 0) && (lo == 1) && (hi == 1))
+		{
+			return zmin;
+		}
+		else if ((v == 1) && (lo == 0) && (hi == 0))
+		{
+			return bigmin;
+		}
+		else if ((v == 1) && (lo == 0) && (hi == 1))
+		{
+			zmin = heatLoadUpper(zmin, bit);
+		}
+	}
+	return bigmin;
+}
+
+
+
+/**
+ * Function collects cells of Morton-sorted array inside bounding box.
+ * @param cells - cells sorted by code
+ * @param n - number of cells
+ * @param latQ1, lonQ1, latQ2, lonQ2 - corners of box in 1/100 degree (inclusive)
+ * @param out - cells inside box are appended here (in Morton order)
+ * @return number of appended cells
+ */
+size_t heatRange(const tHeatCell *cells, size_t n, int latQ1, int lonQ1, int latQ2, int lonQ2, std::vector<tHeatCell> &out)
+{
+	int latLo = std::max(std::min(latQ1, latQ2), -HEAT_LAT_OFFSET);
+	int latHi = std::min(std::max(latQ1, latQ2), HEAT_LAT_OFFSET);
+	int lonLo = std::max(std::min(lonQ1, lonQ2), -HEAT_LON_OFFSET);
+	int lonHi = std::min(std::max(lonQ1, lonQ2), HEAT_LON_OFFSET);
+	if ((latLo > latHi) || (lonLo > lonHi))
+	{
+		return 0;
+	}
+	
+	uint32_t zmin = heatMorton(latLo, lonLo);
+	uint32_t zmax = heatMorton(latHi, lonHi);
+	size_t found = 0;
+	
+	tHeatCell key;
+	key.code = zmin;
+	const tHeatCell *end = cells + n;
+	const tHeatCell *c = std::lower_bound(cells, end, key, heatLess);
+	while ((c < end) && (c->code <= zmax))
+	{
+		int latQ, lonQ;
+		heatDemorton(c->code, latQ, lonQ);
+		if ((latQ >= latLo) && (latQ <= latHi) && (lonQ >= lonLo) && (lonQ <= lonHi))
+		{
+			out.push_back(*c);
+			found++;
+			c++;
+		}
+		else
+		{
+			key.code = heatBigMin(c->code, zmin, zmax);
+			if (key.code <= c->code)
+			{
+				break;
+			}
+			c = std::lower_bound(c, end, key, heatLess);
+		}
+	}
+	
+	return found;
+}
+
+
+
+/**
+ * Function merges Morton-sorted cells into square blocks, each block is contiguous run of array.
+ * @param cells - cells sorted by code
+ * @param n - number of cells
+ * @param level - block side is 2^level cells
+ * @param out - blocks are appended here (in Morton order)
+ */
+void heatDownsample(const tHeatCell *cells, size_t n, int level, std::vector<tHeatCell> &out)
+{
+	uint32_t mask = (level >= 16) ? 0 : ~((1u << (2 * level)) - 1);
+	for (size_t i = 0; i < n; i++)
+	{
+		uint32_t block = cells[i].code & mask;
+		if ((! out.empty()) && (out.back().code == block))
+		{
+			out.back().weight += cells[i].weight;
+		}
+		else
+		{
+			tHeatCell c;
+			c.code = block;
+			c.weight = cells[i].weight;
+			out.push_back(c);
+		}
+	}
+}
+
+
+
+/**
+ * Constructor.
+ */
+heatGrid::heatGrid()
+{
+	tHeatCell empty;
+	empty.code = HEAT_EMPTY;
+	empty.weight = 0;
+	slots.assign(HEAT_INITIAL_SLOTS, empty);
+	used = 0;
+	sortedValid = true;
+}
+
+
+
+/**
+ * Function finds slot of cell by linear probing.
+ * @param code - Morton code of cell
+ * @return index of slot holding cell, or of empty slot where cell belongs
+ */
+size_t heatGrid::findSlot(uint32_t code) const
+{
+	size_t mask = slots.size() - 1;
+	size_t i = homeSlot(code);
+	while ((slots[i].code != code) && (slots[i].code != HEAT_EMPTY))
+	{
+		i = (i + 1) & mask;
+	}
+	return i;
+}
+
+
+
+/**
+ * Function doubles size of hash table and reinserts all cells.
+ */
+void heatGrid::grow()
+{
+	reserve(slots.size());
+}
+
+
+
+/**
+ * Function sizes hash table, so n cells can be added without growing.
+ * @param n - expected number of cells
+ */
+void heatGrid::reserve(size_t n)
+{
+	size_t size = slots.size();
+	while (size < 2 * n)
+	{
+		size *= 2;
+	}
+	if (size == slots.size())
+	{
+		return;
+	}
+	
+	std::vector<tHeatCell> old;
+	old.swap(slots);
+	
+	tHeatCell empty;
+	empty.code = HEAT_EMPTY;
+	empty.weight = 0;
+	slots.assign(size, empty);
+	
+	for (size_t i = 0; i < old.size(); i++)
+	{
+		if (old[i].code != HEAT_EMPTY)
+		{
+			slots[findSlot(old[i].code)] = old[i];
+		}
+	}
+}
+
+
+
+/**
+ * Function adds weight to cell.
+ * @param code - Morton code of cell
+ * @param weight - weight to add
+ */
+void heatGrid::add(uint32_t code, int weight)
+{
+	size_t i = findSlot(code);
+	if (slots[i].code == HEAT_EMPTY)
+	{
+		if (2 * (used + 1) > slots.size())
+		{
+			grow();
+			i = findSlot(code);
+		}
+		slots[i].code = code;
+		slots[i].weight = 0;
+		used++;
+	}
+	slots[i].weight += weight;
+	sortedValid = false;
+}
+
+
+
+/**
+ * Function adds weight to cell only if it exists.
+ * @param code - Morton code of cell
+ * @param weight - weight to add
+ * @return true if cell exists
+ */
+bool heatGrid::addExisting(uint32_t code, int weight)
+{
+	size_t i = findSlot(code);
+	if (slots[i].code == HEAT_EMPTY)
+	{
+		return false;
+	}
+	slots[i].weight += weight;
+	sortedValid = false;
+	return true;
+}
+
+
+
+/**
+ * Function adds weights of many cells. Table is grown in advance and home slots
+ * of following cells are prefetched while current cell is added.
+ * @param cells - cells to add
+ * @param n - number of cells
+ */
+void heatGrid::addBatch(const tHeatCell *cells, size_t n)
+{
+	reserve(used + n);
+	
+	for (size_t i = 0; (i < n) && (i < HEAT_PREFETCH_AHEAD); i++)
+	{
+		__builtin_prefetch(&slots[homeSlot(cells[i].code)], 1);
+	}
+	for (size_t i = 0; i < n; i++)
+	{
+		if (i + HEAT_PREFETCH_AHEAD < n)
+		{
+			__builtin_prefetch(&slots[homeSlot(cells[i + HEAT_PREFETCH_AHEAD].code)], 1);
+		}
+		add(cells[i].code, cells[i].weight);
+	}
+}
+
+
+
+/**
+ * Function returns weight of cell.
+ * @param code - Morton code of cell
+ * @return weight, zero if cell does not exist
+ */
+int heatGrid::get(uint32_t code) const
+{
+	return slots[findSlot(code)].weight;
+}
+
+
+
+/**
+ * Function returns number of cells.
+ * @return number of cells
+ */
+size_t heatGrid::size() const
+{
+	return used;
+}
+
+
+
+/**
+ * Function returns all cells sorted by Morton code, array is rebuilt only after cells changed.
+ * @return sorted cells
+ */
+const std::vector<tHeatCell> &heatGrid::cells() const
+{
+	if (! sortedValid)
+	{
+		sorted.clear();
+		sorted.reserve(used);
+		for (size_t i = 0; i < slots.size(); i++)
+		{
+			if (slots[i].code != HEAT_EMPTY)
+			{
+				sorted.push_back(slots[i]);
+			}
+		}
+		std::sort(sorted.begin(), sorted.end(), heatLess);
+		sortedValid = true;
+	}
+	return sorted;
+}
+
+
+
+/**
+ * Function appends all cells in order of hash table.
+ * @param out - cells are appended here
+ */
+void heatGrid::append(std::vector<tHeatCell> &out) const
+{
+	for (size_t i = 0; i < slots.size(); i++)
+	{
+		if (slots[i].code != HEAT_EMPTY)
+		{
+			out.push_back(slots[i]);
+		}
+	}
+}
+
+
+
+/**
+ * Comparator of adaptive heat map entries by code, coarser level first for equal codes.
+ */
+static bool heatEntryLess(const tHeatEntry &a, const tHeatEntry &b)
+{
+	return (a.code < b.code) || ((a.code == b.code) && (a.level > b.level));
+}
+
+
+
+/**
+ * Function merges sparse blocks of sorted entries bottom-up - for each level, run of entries of the same
+ * block is replaced by single block entry, if it has more entries and their total weight does not exceed
+ * threshold. Entries of coarser levels form runs of their own and are kept.
+ * @param list - entries sorted by code, merged in place
+ * @param threshold - maximum weight of merged block
+ */
+static void heatMergeSparse(std::vector<tHeatEntry> &list, int64_t threshold)
+{
+	for (int level = 1; level <= HEAT_MAX_LEVEL; level++)
+	{
+		uint32_t mask = heatBlockMask(level);
+		size_t n = list.size();
+		size_t out = 0;
+		size_t i = 0;
+		while (i < n)
+		{
+			uint32_t block = list[i].code & mask;
+			int64_t weight = 0;
+			size_t j = i;
+			while ((j < n) && ((list[j].code & mask) == block))
+			{
+				weight += list[j].weight;
+				j++;
+			}
+			
+			if ((j - i >= 2) && (weight <= threshold))
+			{
+				list[out].code = block;
+				list[out].weight = (int32_t) weight;
+				list[out].level = level;
+				out++;
+			}
+			else
+			{
+				for (size_t k = i; k < j; k++)
+				{
+					list[out++] = list[k];
+				}
+			}
+			i = j;
+		}
+		list.resize(out);
+	}
+}
+
+
+
+/**
+ * Constructor.
+ */
+heatQuadtree::heatQuadtree()
+{
+	usedLevels = 0;
+	budget = 0;
+	compactions = 0;
+	sortedValid = true;
+}
+
+
+
+/**
+ * Function sets budget of entries, map exceeding it is compacted at once.
+ * @param entries - maximum number of entries, zero for unlimited
+ */
+void heatQuadtree::setBudget(size_t entries)
+{
+	budget = entries;
+	if ((budget > 0) && (size() > budget))
+	{
+		compact();
+	}
+}
+
+
+
+/**
+ * Function returns budget of entries.
+ * @return maximum number of entries, zero for unlimited
+ */
+size_t heatQuadtree::getBudget() const
+{
+	return budget;
+}
+
+
+
+/**
+ * Function removes all entries, budget is kept.
+ */
+void heatQuadtree::clear()
+{
+	for (int l = 0; l <= HEAT_MAX_LEVEL; l++)
+	{
+		grids[l] = heatGrid();
+	}
+	usedLevels = 0;
+	sorted.clear();
+	sortedLevels.clear();
+	sortedValid = true;
+}
+
+
+
+/**
+ * Function sizes table of full resolution cells, so n cells can be added without growing
+ * (limited by budget).
+ * @param n - expected number of cells
+ */
+void heatQuadtree::reserve(size_t n)
+{
+	grids[0].reserve(((budget > 0) && (n > budget)) ? budget : n);
+}
+
+
+
+/**
+ * Function adds weight to cell of full resolution, or to block of coarser level containing it.
+ * New cell is created at full resolution and map is compacted, if it exceeds budget.
+ * @param code - Morton code of cell
+ * @param weight - weight to add
+ */
+void heatQuadtree::add(uint32_t code, int weight)
+{
+	sortedValid = false;
+	if (grids[0].addExisting(code, weight))
+	{
+		return;
+	}
+	for (unsigned used = usedLevels, l = 1; used != 0; l++)
+	{
+		if ((used & (1u << l)) && grids[l].addExisting(code & heatBlockMask(l), weight))
+		{
+			return;
+		}
+		used &= ~(1u << l);
+	}
+	
+	grids[0].add(code, weight);
+	if ((budget > 0) && (size() > budget))
+	{
+		compact();
+	}
+}
+
+
+
+/**
+ * Function adds weights of many cells of full resolution. Without coarser entries cells are added
+ * in bulk by table of full resolution and map is compacted once at end.
+ * @param cells - cells to add
+ * @param n - number of cells
+ */
+void heatQuadtree::addBatch(const tHeatCell *cells, size_t n)
+{
+	if (usedLevels != 0)
+	{
+		for (size_t i = 0; i < n; i++)
+		{
+			add(cells[i].code, cells[i].weight);
+		}
+		return;
+	}
+	
+	grids[0].addBatch(cells, n);
+	sortedValid = false;
+	if ((budget > 0) && (size() > budget))
+	{
+		compact();
+	}
+}
+
+
+
+/**
+ * Function adds entries of any level. Entries are added to table of their level, then
+ * entries nested in coarser blocks are folded into them.
+ * @param entries - entries to add
+ * @param n - number of entries
+ */
+void heatQuadtree::addEntries(const tHeatEntry *entries, size_t n)
+{
+	bool coarse = false;
+	for (size_t i = 0; i < n; i++)
+	{
+		int level = entries[i].level;
+		if ((level < 0) || (level > HEAT_MAX_LEVEL))
+		{
+			continue;
+		}
+		if (level == 0)
+		{
+			add(entries[i].code, entries[i].weight);
+			continue;
+		}
+		grids[level].add(entries[i].code & heatBlockMask(level), entries[i].weight);
+		usedLevels |= 1u << level;
+		coarse = true;
+	}
+	sortedValid = false;
+	
+	if (coarse)
+	{
+		std::vector<tHeatEntry> list;
+		collect(list);
+		rebuild(list);
+	}
+	if ((budget > 0) && (size() > budget))
+	{
+		compact();
+	}
+}
+
+
+
+/**
+ * Function adds all entries of other map.
+ * @param other - map to add
+ */
+void heatQuadtree::merge(const heatQuadtree &other)
+{
+	if (other.usedLevels == 0)
+	{
+		const std::vector<tHeatCell> &cells = other.cells();
+		addBatch(cells.data(), cells.size());
+		return;
+	}
+	
+	std::vector<tHeatEntry> list;
+	other.collect(list);
+	addEntries(list.data(), list.size());
+}
+
+
+
+/**
+ * Function collects entries of all levels sorted by code.
+ * @param out - entries are stored here
+ */
+void heatQuadtree::collect(std::vector<tHeatEntry> &out) const
+{
+	std::vector<tHeatCell> cells;
+	out.clear();
+	out.reserve(size());
+	for (int l = 0; l <= HEAT_MAX_LEVEL; l++)
+	{
+		cells.clear();
+		grids[l].append(cells);
+		for (size_t i = 0; i < cells.size(); i++)
+		{
+			tHeatEntry e;
+			e.code = cells[i].code;
+			e.weight = cells[i].weight;
+			e.level = l;
+			out.push_back(e);
+		}
+	}
+	std::sort(out.begin(), out.end(), heatEntryLess);
+}
+
+
+
+/**
+ * Function replaces content of map by sorted entries. Entry lying inside preceding block
+ * (possible after adding entries of other map) is added to that block. Tables are allocated
+ * anew for their number of entries, so memory of compacted map is released.
+ * @param list - entries sorted by heatEntryLess()
+ */
+void heatQuadtree::rebuild(const std::vector<tHeatEntry> &list)
+{
+	std::vector<tHeatEntry> folded;
+	folded.reserve(list.size());
+	size_t counts[HEAT_MAX_LEVEL + 1] = {0};
+	for (size_t i = 0; i < list.size(); i++)
+	{
+		if (! folded.empty())
+		{
+			const tHeatEntry &block = folded.back();
+			if ((list[i].code & heatBlockMask(block.level)) == block.code)
+			{
+				folded.back().weight += list[i].weight;
+				continue;
+			}
+		}
+		folded.push_back(list[i]);
+		counts[list[i].level]++;
+	}
+	
+	usedLevels = 0;
+	for (int l = 0; l <= HEAT_MAX_LEVEL; l++)
+	{
+		grids[l] = heatGrid();
+		grids[l].reserve(counts[l]);
+		if ((l > 0) && (counts[l] > 0))
+		{
+			usedLevels |= 1u << l;
+		}
+	}
+	for (size_t i = 0; i < folded.size(); i++)
+	{
+		grids[folded[i].level].add(folded[i].code, folded[i].weight);
+	}
+	sortedValid = false;
+}
+
+
+
+/**
+ * Function compacts map - finds smallest weight threshold (by bisection), for which merging of sparse
+ * blocks leaves at most 3/4 of budget entries, and rebuilds map of merged entries.
+ */
+void heatQuadtree::compact()
+{
+	std::vector<tHeatEntry> list;
+	collect(list);
+	
+	size_t target = budget - budget / 4;
+	int64_t total = 0;
+	for (size_t i = 0; i < list.size(); i++)
+	{
+		total += list[i].weight;
+	}
+	
+	// count of entries does not grow with threshold
+	std::vector<tHeatEntry> work;
+	int64_t lo = 0;
+	int64_t hi = std::min(total, (int64_t) INT32_MAX);
+	while (lo < hi)
+	{
+		int64_t mid = lo + (hi - lo) / 2;
+		work = list;
+		heatMergeSparse(work, mid);
+		if (work.size() <= target)
+		{
+			hi = mid;
+		}
+		else
+		{
+			lo = mid + 1;
+		}
+	}
+	
+	heatMergeSparse(list, lo);
+	rebuild(list);
+	compactions++;
+}
+
+
+
+/**
+ * Function returns number of entries.
+ * @return number of entries of all levels
+ */
+size_t heatQuadtree::size() const
+{
+	size_t n = 0;
+	for (int l = 0; l <= HEAT_MAX_LEVEL; l++)
+	{
+		n += grids[l].size();
+	}
+	return n;
+}
+
+
+
+/**
+ * Function returns number of entries of one level.
+ * @param level - quadtree level (0 for full resolution cells)
+ * @return number of entries
+ */
+size_t heatQuadtree::levelSize(int level) const
+{
+	return grids[level].size();
+}
+
+
+
+/**
+ * Function returns number of compactions since start.
+ * @return number of compactions
+ */
+uint64_t heatQuadtree::getCompactions() const
+{
+	return compactions;
+}
+
+
+
+/**
+ * Function returns all entries sorted by Morton code of their first cell, array is rebuilt
+ * only after map changed. Levels of entries are in levels().
+ * @return sorted entries
+ */
+const std::vector<tHeatCell> &heatQuadtree::cells() const
+{
+	if (! sortedValid)
+	{
+		if (usedLevels == 0)
+		{
+			sorted.clear();
+			sorted.reserve(grids[0].size());
+			grids[0].append(sorted);
+			std::sort(sorted.begin(), sorted.end(), heatLess);
+			sortedLevels.assign(sorted.size(), 0);
+		}
+		else
+		{
+			std::vector<tHeatEntry> list;
+			collect(list);
+			sorted.resize(list.size());
+			sortedLevels.resize(list.size());
+			for (size_t i = 0; i < list.size(); i++)
+			{
+				sorted[i].code = list[i].code;
+				sorted[i].weight = list[i].weight;
+				sortedLevels[i] = (uint8_t) list[i].level;
+			}
+		}
+		sortedValid = true;
+	}
+	return sorted;
+}
+
+
+
+/**
+ * Function returns levels of entries of cells().
+ * @return level of each entry
+ */
+const std::vector<uint8_t> &heatQuadtree::levels() const
+{
+	cells();
+	return sortedLevels;
+}
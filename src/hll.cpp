@@ -0,0 +1,476 @@
+/* DumpStats - dump1090 feed statistical data collector
+ * Copyright (C) 2015 Marcel Kebisek
+ * Contact: marcel.kebisek@gmail.com
+ * 
+ * This file is part of DumpStats.
+ * 
+ * DumpStats is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * DumpStats is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with DumpStats. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hll.H"
+
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+
+/**
+ * Constructor of empty sketch.
+ * @param precision - number of bits selecting register (4-16)
+ */
+hyperLogLog::hyperLogLog(int precision)
+{
+	this->precision = precision;
+	registers.assign((size_t) 1 << precision, 0);
+}
+
+
+
+/**
+ * Function merges another sketch into this one (register-wise maximum).
+ * @param other - sketch of the same precision
+ * @return zero if success, nonzero if precisions differ
+ */
+int hyperLogLog::merge(const hyperLogLog &other)
+{
+	if (other.precision != precision)
+	{
+		fprintf(stderr, "ERROR: Unable to merge sketches of different precision!\n");
+		return 1;
+	}
+	
+	for (size_t i = 0; i < registers.size(); i++)
+	{
+		registers[i] = std::max(registers[i], other.registers[i]);
+	}
+	return 0;
+}
+
+
+
+/**
+ * Function estimates number of distinct items - harmonic mean of register values with linear counting
+ * of empty registers for small cardinalities (no large range correction is needed with 64-bit hash).
+ * @return estimated number of distinct items
+ */
+double hyperLogLog::estimate() const
+{
+	double m = registers.size();
+	double sum = 0;
+	size_t zeros = 0;
+	for (size_t i = 0; i < registers.size(); i++)
+	{
+		sum += ldexp(1.0, -registers[i]);
+		zeros += (registers[i] == 0);
+	}
+	
+	double alpha = 0.7213 / (1 + 1.079 / m);
+	double e = alpha * m * m / sum;
+	if ((e <= 2.5 * m) && (zeros > 0))
+	{
+		e = m * log(m / zeros);
+	}
+	return e;
+}
+
+
+
+/**
+ * Function returns precision of sketch.
+ * @return number of bits selecting register
+ */
+int hyperLogLog::getPrecision() const
+{
+	return precision;
+}
+
+
+
+/**
+ * Functions return registers of sketch and their number.
+ */
+const uint8_t *hyperLogLog::data() const
+{
+	return registers.data();
+}
+
+uint8_t *hyperLogLog::data()
+{
+	return registers.data();
+}
+
+size_t hyperLogLog::size() const
+{
+	return registers.size();
+}
+
+
+
+/**
+ * Constructor of empty set of sketches.
+ */
+distinctAircraft::distinctAircraft() : total(HLL_PRECISION)
+{
+	currentHour = -1;
+	current = NULL;
+}
+
+
+
+/**
+ * Copy constructor (cached hourly sketch belongs to copied object, so it is not copied).
+ * @param other - copied set
+ */
+distinctAircraft::distinctAircraft(const distinctAircraft &other) : total(other.total), hours(other.hours), airlines(other.airlines)
+{
+	currentHour = -1;
+	current = NULL;
+}
+
+
+
+/**
+ * Assignment operator (cached hourly sketch belongs to assigned object, so it is not copied).
+ * @param other - assigned set
+ * @return this set
+ */
+distinctAircraft &distinctAircraft::operator=(const distinctAircraft &other)
+{
+	total = other.total;
+	hours = other.hours;
+	airlines = other.airlines;
+	currentHour = -1;
+	current = NULL;
+	return *this;
+}
+
+
+
+/**
+ * Function returns sketch of hour, sketch is created if needed. Only HLL_HOURS latest hours are kept,
+ * older sketches are dropped when sketch of new hour is created.
+ * @param hour - unix time / 3600
+ * @return sketch of hour, NULL if hour is older than kept hours
+ */
+hyperLogLog *distinctAircraft::hourSketch(int64_t hour)
+{
+	std::map<int64_t, hyperLogLog>::iterator it = hours.find(hour);
+	if (it != hours.end())
+	{
+		return &it->second;
+	}
+	
+	if ((! hours.empty()) && (hour <= hours.rbegin()->first - HLL_HOURS))
+	{
+		return NULL;
+	}
+	
+	it = hours.insert(std::make_pair(hour, hyperLogLog(HLL_PRECISION))).first;
+	while (hours.begin()->first <= hours.rbegin()->first - HLL_HOURS)
+	{
+		hours.erase(hours.begin());
+	}
+	return &it->second;
+}
+
+
+
+/**
+ * Function counts aircraft flying for airline.
+ * @param code - ICAO code of airline
+ * @param h - hash of ICAO address of aircraft (see hyperLogLog::hash())
+ */
+void distinctAircraft::addAirline(const std::string &code, uint64_t h)
+{
+	std::map<std::string, hyperLogLog>::iterator it = airlines.find(code);
+	if (it == airlines.end())
+	{
+		it = airlines.insert(std::make_pair(code, hyperLogLog(HLL_AIRLINE_PRECISION))).first;
+	}
+	it->second.add(h);
+}
+
+
+
+/**
+ * Function merges sketches of another set into this one, kept hours are limited by HLL_HOURS again.
+ * @param other - merged set
+ */
+void distinctAircraft::merge(const distinctAircraft &other)
+{
+	total.merge(other.total);
+	
+	std::map<int64_t, hyperLogLog>::const_iterator hourIter;
+	for (hourIter = other.hours.begin(); hourIter != other.hours.end(); ++hourIter)
+	{
+		hyperLogLog *s = hourSketch(hourIter->first);
+		if (s != NULL)
+		{
+			s->merge(hourIter->second);
+		}
+	}
+	
+	std::map<std::string, hyperLogLog>::const_iterator airlineIter;
+	for (airlineIter = other.airlines.begin(); airlineIter != other.airlines.end(); ++airlineIter)
+	{
+		std::map<std::string, hyperLogLog>::iterator it = airlines.find(airlineIter->first);
+		if (it == airlines.end())
+		{
+			airlines.insert(*airlineIter);
+		}
+		else
+		{
+			it->second.merge(airlineIter->second);
+		}
+	}
+	
+	// hours may have been dropped
+	currentHour = -1;
+	current = NULL;
+}
+
+
+
+/**
+ * Function returns estimated number of distinct aircraft.
+ * @return estimate
+ */
+double distinctAircraft::getTotal() const
+{
+	return total.estimate();
+}
+
+
+
+/**
+ * Function returns estimated number of distinct aircraft of hour.
+ * @param hour - unix time / 3600
+ * @return estimate, zero if hour is not kept
+ */
+double distinctAircraft::getHour(int64_t hour) const
+{
+	std::map<int64_t, hyperLogLog>::const_iterator it = hours.find(hour);
+	return (it != hours.end()) ? it->second.estimate() : 0;
+}
+
+
+
+/**
+ * Functions return hourly and airline sketches.
+ */
+const std::map<int64_t, hyperLogLog> &distinctAircraft::getHours() const
+{
+	return hours;
+}
+
+const std::map<std::string, hyperLogLog> &distinctAircraft::getAirlines() const
+{
+	return airlines;
+}
+
+
+
+/**
+ * Function serializes sketches in format of sketch file (described in hll.H).
+ * @param out - serialized sketches are appended here
+ */
+void distinctAircraft::serialize(std::string &out) const
+{
+	tHllHeader h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, HLL_MAGIC, sizeof(h.magic));
+	h.version = HLL_VERSION;
+	h.precision = HLL_PRECISION;
+	h.airlinePrecision = HLL_AIRLINE_PRECISION;
+	h.hours = hours.size();
+	h.airlines = airlines.size();
+	
+	out.append((const char *) &h, sizeof(h));
+	out.append((const char *) total.data(), total.size());
+	
+	std::map<int64_t, hyperLogLog>::const_iterator hourIter;
+	for (hourIter = hours.begin(); hourIter != hours.end(); ++hourIter)
+	{
+		int64_t hour = hourIter->first;
+		out.append((const char *) &hour, sizeof(hour));
+		out.append((const char *) hourIter->second.data(), hourIter->second.size());
+	}
+	
+	std::map<std::string, hyperLogLog>::const_iterator airlineIter;
+	for (airlineIter = airlines.begin(); airlineIter != airlines.end(); ++airlineIter)
+	{
+		char code[4];
+		memset(code, 0, sizeof(code));
+		strncpy(code, airlineIter->first.c_str(), sizeof(code));
+		out.append(code, sizeof(code));
+		out.append((const char *) airlineIter->second.data(), airlineIter->second.size());
+	}
+}
+
+
+
+/**
+ * Function writes sketches into file (format is described in hll.H). File is written into temporary file
+ * and renamed, so it is never left partially written.
+ * @param path - path to file
+ * @return zero if success, nonzero otherwise
+ */
+int distinctAircraft::save(const std::string &path) const
+{
+	std::string content;
+	serialize(content);
+	
+	std::string tmpPath = path + ".tmp";
+	FILE *f = fopen(tmpPath.c_str(), "wb");
+	if (f == NULL)
+	{
+		fprintf(stderr, "ERROR: Unable to open sketch file %s!\n", tmpPath.c_str());
+		return 1;
+	}
+	
+	fwrite(content.data(), 1, content.size(), f);
+	
+	bool failed = (ferror(f) != 0);
+	if ((fclose(f) != 0) || failed || (rename(tmpPath.c_str(), path.c_str()) != 0))
+	{
+		fprintf(stderr, "ERROR: Unable to write sketch file %s!\n", path.c_str());
+		return 1;
+	}
+	
+	return 0;
+}
+
+
+
+/**
+ * Function reads sketches from file written by save(), current sketches are replaced.
+ * @param path - path to file
+ * @return zero if success (including missing file, which leaves set empty), nonzero for unreadable file
+ */
+int distinctAircraft::load(const std::string &path)
+{
+	*this = distinctAircraft();
+	
+	FILE *f = fopen(path.c_str(), "rb");
+	if (f == NULL)
+	{
+		return 0;
+	}
+	
+	tHllHeader h;
+	if ((fread(&h, sizeof(h), 1, f) != 1) || (memcmp(h.magic, HLL_MAGIC, sizeof(h.magic)) != 0) || (h.version != HLL_VERSION))
+	{
+		fprintf(stderr, "ERROR: %s is not sketch file!\n", path.c_str());
+		fclose(f);
+		return 1;
+	}
+	if ((h.precision != HLL_PRECISION) || (h.airlinePrecision != HLL_AIRLINE_PRECISION))
+	{
+		fprintf(stderr, "ERROR: Sketches of %s have different precision!\n", path.c_str());
+		fclose(f);
+		return 1;
+	}
+	
+	bool ok = (fread(total.data(), 1, total.size(), f) == total.size());
+	for (uint32_t i = 0; ok && (i < h.hours); i++)
+	{
+		int64_t hour;
+		hyperLogLog s(HLL_PRECISION);
+		ok = (fread(&hour, sizeof(hour), 1, f) == 1) && (fread(s.data(), 1, s.size(), f) == s.size());
+		if (ok)
+		{
+			hours.insert(std::make_pair(hour, s));
+		}
+	}
+	for (uint32_t i = 0; ok && (i < h.airlines); i++)
+	{
+		char code[5];
+		hyperLogLog s(HLL_AIRLINE_PRECISION);
+		ok = (fread(code, 1, 4, f) == 4) && (fread(s.data(), 1, s.size(), f) == s.size());
+		if (ok)
+		{
+			code[4] = '\0';
+			airlines.insert(std::make_pair(std::string(code), s));
+		}
+	}
+	fclose(f);
+	
+	if (! ok)
+	{
+		fprintf(stderr, "ERROR: Sketch file %s is truncated!\n", path.c_str());
+		*this = distinctAircraft();
+		return 1;
+	}
+	return 0;
+}
+
+
+
+/**
+ * Function merges sketch files (e.g. of more stations) and prints estimated number of distinct aircraft
+ * in total, in each kept hour and of each airline (sorted by estimate).
+ * @param paths - sketch files
+ * @param output - path of file for merged sketches, empty for none
+ * @return zero if success, nonzero otherwise
+ */
+int hllReport(const std::vector<std::string> &paths, const std::string &output)
+{
+	distinctAircraft all;
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		distinctAircraft d;
+		FILE *f = fopen(paths[i].c_str(), "rb");
+		if (f == NULL)
+		{
+			fprintf(stderr, "ERROR: Unable to open sketch file %s!\n", paths[i].c_str());
+			return 1;
+		}
+		fclose(f);
+		if (d.load(paths[i]) != 0)
+		{
+			return 1;
+		}
+		all.merge(d);
+	}
+	
+	printf("Distinct aircraft: %.0f\n\nHour (UTC)           Aircraft\n", all.getTotal());
+	std::map<int64_t, hyperLogLog>::const_iterator hourIter;
+	for (hourIter = all.getHours().begin(); hourIter != all.getHours().end(); ++hourIter)
+	{
+		char buf[32];
+		std::time_t t = hourIter->first * 3600;
+		strftime(buf, sizeof(buf), "%Y-%m-%d %H:00", gmtime(&t));
+		printf("%-20s %8.0f\n", buf, hourIter->second.estimate());
+	}
+	
+	std::vector<std::pair<double, std::string> > airlines;
+	std::map<std::string, hyperLogLog>::const_iterator airlineIter;
+	for (airlineIter = all.getAirlines().begin(); airlineIter != all.getAirlines().end(); ++airlineIter)
+	{
+		airlines.push_back(std::make_pair(-airlineIter->second.estimate(), airlineIter->first));
+	}
+	std::sort(airlines.begin(), airlines.end());
+	printf("\nAirline  Aircraft\n");
+	for (size_t i = 0; i < airlines.size(); i++)
+	{
+		printf("%-8s %8.0f\n", airlines[i].second.c_str(), -airlines[i].first);
+	}
+	
+	if ((! output.empty()) && (all.save(output) != 0))
+	{
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,571 @@
+/* DumpStats - dump1090 feed statistical data collector
+ * Copyright (C) 2015 Marcel Kebisek
+ * Contact: marcel.kebisek@gmail.com
+ * 
+ * This file is part of DumpStats.
+ * 
+ * DumpStats is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * DumpStats is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with DumpStats. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "httpServer.H"
+
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <strings.h>
+#include <sstream>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <zlib.h>
+
+
+/**
+ * Function returns monotonic time in seconds.
+ * @return seconds
+ */
+static std::time_t httpMonotonic()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec;
+}
+
+
+
+/**
+ * Function formats time as HTTP date.
+ * @param t - unix time
+ * @return date in RFC 7231 format
+ */
+static std::string httpDate(std::time_t t)
+{
+	char buf[64];
+	strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", gmtime(&t));
+	return std::string(buf);
+}
+
+
+
+/**
+ * Function finds value of request header (name is case-insensitive).
+ * @param head - request head
+ * @param name - header name
+ * @return header value, empty if header is not present
+ */
+static std::string httpHeader(const std::string &head, const char *name)
+{
+	size_t len = strlen(name);
+	size_t pos = head.find("\r\n");
+	while (pos != std::string::npos)
+	{
+		pos += 2;
+		if ((strncasecmp(head.c_str() + pos, name, len) == 0) && (head[pos + len] == ':'))
+		{
+			size_t begin = head.find_first_not_of(" \t", pos + len + 1);
+			size_t end = head.find("\r\n", pos);
+			if ((begin == std::string::npos) || (begin >= end))
+			{
+				return "";
+			}
+			return head.substr(begin, end - begin);
+		}
+		pos = head.find("\r\n", pos);
+	}
+	return "";
+}
+
+
+
+/**
+ * Function compresses data into gzip format.
+ * @param in - data
+ * @param out - compressed data
+ * @return zero if success, nonzero otherwise
+ */
+static int httpGzip(const std::string &in, std::string &out)
+{
+	z_stream z;
+	memset(&z, 0, sizeof(z));
+	if (deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+	{
+		return 1;
+	}
+	
+	out.resize(deflateBound(&z, in.size()));
+	z.next_in = (Bytef *) in.data();
+	z.avail_in = in.size();
+	z.next_out = (Bytef *) &out[0];
+	z.avail_out = out.size();
+	
+	int result = deflate(&z, Z_FINISH);
+	out.resize(z.total_out);
+	deflateEnd(&z);
+	
+	return (result == Z_STREAM_END) ? 0 : 1;
+}
+
+
+
+/**
+ * Constructor.
+ */
+httpServer::httpServer()
+{
+	listenFd = -1;
+	epollFd = -1;
+}
+
+
+
+/**
+ * Destructor.
+ */
+httpServer::~httpServer()
+{
+	close();
+}
+
+
+
+/**
+ * Function starts listening on localhost port.
+ * @param port - TCP port
+ * @return zero if success, nonzero otherwise
+ */
+int httpServer::open(int port)
+{
+	listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	if (listenFd < 0)
+	{
+		fprintf(stderr, "ERROR: Unable to create HTTP socket!\n");
+		return 1;
+	}
+	
+	int on = 1;
+	setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	
+	struct sockaddr_in sin;
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_port = htons(port);
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	
+	if ((bind(listenFd, (struct sockaddr *) &sin, sizeof(sin)) < 0) || (listen(listenFd, 64) < 0))
+	{
+		fprintf(stderr, "ERROR: Unable to listen on HTTP port %d!\n", port);
+		close();
+		return 1;
+	}
+	
+	epollFd = epoll_create1(0);
+	struct epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.fd = listenFd;
+	if ((epollFd < 0) || (epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev) < 0))
+	{
+		fprintf(stderr, "ERROR: Unable to create HTTP event queue!\n");
+		close();
+		return 1;
+	}
+	
+	char buf[32];
+	sprintf(buf, "%lx", (unsigned long) std::time(nullptr));
+	startTag = buf;
+	
+	return 0;
+}
+
+
+
+/**
+ * Function returns descriptor to be polled.
+ * @return epoll descriptor, -1 if server is not open
+ */
+int httpServer::fd()
+{
+	return epollFd;
+}
+
+
+
+/**
+ * Function registers resource. Body is rendered on first request.
+ * @param path - request path
+ * @param contentType - value of Content-Type header
+ * @param version - returns version of data, body is rendered again when it changes
+ * @param render - writes body into stream
+ */
+void httpServer::addResource(const std::string &path, const std::string &contentType, std::function<uint64_t()> version, std::function<void(std::ostream &)> render)
+{
+	tHttpResource r;
+	r.contentType = contentType;
+	r.version = version;
+	r.render = render;
+	r.cached = false;
+	r.cachedVersion = 0;
+	r.renderedAt = 0;
+	r.modified = 0;
+	resources[path] = r;
+}
+
+
+
+/**
+ * Function processes all ready events without blocking.
+ */
+void httpServer::handle()
+{
+	struct epoll_event events[64];
+	int n = epoll_wait(epollFd, events, 64, 0);
+	
+	for (int i = 0; i < n; i++)
+	{
+		int fd = events[i].data.fd;
+		if (fd == listenFd)
+		{
+			acceptAll();
+			continue;
+		}
+		
+		if (events[i].events & (EPOLLERR | EPOLLHUP))
+		{
+			closeConn(fd);
+			continue;
+		}
+		if ((events[i].events & EPOLLOUT) && (! writeConn(fd)))
+		{
+			continue;
+		}
+		if (events[i].events & EPOLLIN)
+		{
+			readConn(fd);
+		}
+	}
+}
+
+
+
+/**
+ * Function accepts all pending connections.
+ */
+void httpServer::acceptAll()
+{
+	while (true)
+	{
+		int fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK);
+		if (fd < 0)
+		{
+			return;
+		}
+		
+		if (conns.size() >= HTTP_MAX_CONNECTIONS)
+		{
+			::close(fd);
+			continue;
+		}
+		
+		struct epoll_event ev;
+		ev.events = EPOLLIN;
+		ev.data.fd = fd;
+		epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+		
+		tHttpConn &c = conns[fd];
+		c.sent = 0;
+		c.close = false;
+	}
+}
+
+
+
+/**
+ * Function reads available data from connection and answers all complete requests.
+ * @param fd - connection socket
+ */
+void httpServer::readConn(int fd)
+{
+	tHttpConn &c = conns[fd];
+	char buf[4096];
+	bool eof = false;
+	
+	while (true)
+	{
+		ssize_t n = read(fd, buf, sizeof(buf));
+		if (n > 0)
+		{
+			c.in.append(buf, n);
+			continue;
+		}
+		if ((n < 0) && (errno == EINTR))
+		{
+			continue;
+		}
+		if ((n < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+		{
+			break;
+		}
+		if (n < 0)
+		{
+			closeConn(fd);
+			return;
+		}
+		
+		// client finished sending, requests already received are still answered
+		eof = true;
+		break;
+	}
+	
+	size_t end;
+	while ((! c.close) && ((end = c.in.find("\r\n\r\n")) != std::string::npos))
+	{
+		answer(c, c.in.substr(0, end + 2));
+		c.in.erase(0, end + 4);
+	}
+	
+	if ((! c.close) && (c.in.size() > HTTP_MAX_REQUEST))
+	{
+		c.out += "HTTP/1.1 431 Request Header Fields Too Large\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+		c.close = true;
+	}
+	
+	if (eof)
+	{
+		c.close = true;
+	}
+	
+	writeConn(fd);
+}
+
+
+
+/**
+ * Function sends pending response data. Connection waits for EPOLLOUT while data remain.
+ * @param fd - connection socket
+ * @return false if connection was closed
+ */
+bool httpServer::writeConn(int fd)
+{
+	tHttpConn &c = conns[fd];
+	
+	while (c.sent < c.out.size())
+	{
+		ssize_t n = send(fd, c.out.data() + c.sent, c.out.size() - c.sent, MSG_NOSIGNAL);
+		if (n > 0)
+		{
+			c.sent += n;
+			continue;
+		}
+		if ((n < 0) && (errno == EINTR))
+		{
+			continue;
+		}
+		if ((n < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+		{
+			break;
+		}
+		closeConn(fd);
+		return false;
+	}
+	
+	struct epoll_event ev;
+	ev.data.fd = fd;
+	if (c.sent < c.out.size())
+	{
+		ev.events = EPOLLIN | EPOLLOUT;
+		epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &ev);
+		return true;
+	}
+	
+	c.out.clear();
+	c.sent = 0;
+	if (c.close)
+	{
+		closeConn(fd);
+		return false;
+	}
+	
+	ev.events = EPOLLIN;
+	epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &ev);
+	return true;
+}
+
+
+
+/**
+ * Function closes connection.
+ * @param fd - connection socket
+ */
+void httpServer::closeConn(int fd)
+{
+	epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, NULL);
+	::close(fd);
+	conns.erase(fd);
+}
+
+
+
+/**
+ * Function renders resource again if version of its data changed,
+ * but not sooner than HTTP_MIN_RENDER_SECS after previous render.
+ * @param r - resource
+ */
+void httpServer::refresh(tHttpResource &r)
+{
+	uint64_t version = r.version();
+	std::time_t now = httpMonotonic();
+	if (r.cached && ((version == r.cachedVersion) || (now - r.renderedAt < HTTP_MIN_RENDER_SECS)))
+	{
+		return;
+	}
+	
+	std::ostringstream body;
+	r.render(body);
+	r.body = body.str();
+	if (httpGzip(r.body, r.gzBody) != 0)
+	{
+		r.gzBody.clear();
+	}
+	
+	char tag[64];
+	sprintf(tag, "\"%s-%lx\"", startTag.c_str(), (unsigned long) version);
+	r.etag = tag;
+	r.cached = true;
+	r.cachedVersion = version;
+	r.renderedAt = now;
+	r.modified = std::time(nullptr);
+}
+
+
+
+/**
+ * Function parses single request and appends response to connection output.
+ * @param c - connection
+ * @param head - request line and headers (each terminated by CRLF)
+ */
+void httpServer::answer(tHttpConn &c, const std::string &head)
+{
+	size_t lineEnd = head.find("\r\n");
+	std::string line = head.substr(0, lineEnd);
+	size_t sp1 = line.find(' ');
+	size_t sp2 = line.rfind(' ');
+	if ((sp1 == std::string::npos) || (sp2 == sp1))
+	{
+		c.out += "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+		c.close = true;
+		return;
+	}
+	
+	std::string method = line.substr(0, sp1);
+	std::string path = line.substr(sp1 + 1, sp2 - sp1 - 1);
+	std::string version = line.substr(sp2 + 1);
+	path = path.substr(0, path.find('?'));
+	
+	// HTTP/1.1 keeps connection open unless asked otherwise, HTTP/1.0 only if asked
+	std::string connection = httpHeader(head, "Connection");
+	if (version == "HTTP/1.0")
+	{
+		c.close = (strcasecmp(connection.c_str(), "keep-alive") != 0);
+	}
+	else
+	{
+		c.close = (strcasecmp(connection.c_str(), "close") == 0);
+	}
+	const char *connHeader = c.close ? "Connection: close\r\n" : "Connection: keep-alive\r\n";
+	
+	if ((method != "GET") && (method != "HEAD"))
+	{
+		c.out += std::string("HTTP/1.1 405 Method Not Allowed\r\nAllow: GET, HEAD\r\nContent-Length: 0\r\n") + connHeader + "\r\n";
+		return;
+	}
+	
+	std::map<std::string, tHttpResource>::iterator it = resources.find(path);
+	if (it == resources.end())
+	{
+		c.out += std::string("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n") + connHeader + "\r\n";
+		return;
+	}
+	
+	tHttpResource &r = it->second;
+	refresh(r);
+	
+	std::string lastModified = httpDate(r.modified);
+	std::string validators = "ETag: " + r.etag + "\r\nLast-Modified: " + lastModified + "\r\nCache-Control: no-cache\r\nVary: Accept-Encoding\r\n";
+	
+	// conditional request - ETag has precedence over modification time
+	bool notModified = false;
+	std::string ifNoneMatch = httpHeader(head, "If-None-Match");
+	std::string ifModifiedSince = httpHeader(head, "If-Modified-Since");
+	if (! ifNoneMatch.empty())
+	{
+		notModified = (ifNoneMatch.find(r.etag) != std::string::npos) || (ifNoneMatch == "*");
+	}
+	else if (! ifModifiedSince.empty())
+	{
+		struct tm tm;
+		memset(&tm, 0, sizeof(tm));
+		if (strptime(ifModifiedSince.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm) != NULL)
+		{
+			notModified = (r.modified <= timegm(&tm));
+		}
+	}
+	
+	if (notModified)
+	{
+		c.out += "HTTP/1.1 304 Not Modified\r\n" + validators + connHeader + "\r\n";
+		return;
+	}
+	
+	bool gzip = (! r.gzBody.empty()) && (httpHeader(head, "Accept-Encoding").find("gzip") != std::string::npos);
+	const std::string &body = gzip ? r.gzBody : r.body;
+	
+	char length[64];
+	sprintf(length, "Content-Length: %lu\r\n", (unsigned long) body.size());
+	
+	c.out += "HTTP/1.1 200 OK\r\nContent-Type: " + r.contentType + "\r\n" + validators + length + connHeader;
+	if (gzip)
+	{
+		c.out += "Content-Encoding: gzip\r\n";
+	}
+	c.out += "\r\n";
+	
+	if (method == "GET")
+	{
+		c.out += body;
+	}
+}
+
+
+
+/**
+ * Function closes all connections and listening socket.
+ */
+void httpServer::close()
+{
+	while (! conns.empty())
+	{
+		closeConn(conns.begin()->first);
+	}
+	if (listenFd >= 0)
+	{
+		::close(listenFd);
+		listenFd = -1;
+	}
+	if (epollFd >= 0)
+	{
+		::close(epollFd);
+		epollFd = -1;
+	}
+}
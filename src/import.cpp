@@ -0,0 +1,522 @@
+/* DumpStats - dump1090 feed statistical data collector
+ * Copyright (C) 2015 Marcel Kebisek
+ * Contact: marcel.kebisek@gmail.com
+ * 
+ * This file is part of DumpStats.
+ * 
+ * DumpStats is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * DumpStats is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with DumpStats. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "objects.H"
+#include "import.H"
+#include "recorder.H"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <chrono>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <zlib.h>
+#include <climits>
+
+
+namespace
+{
+
+// Chunk of log data consisting of whole lines
+typedef struct importChunk
+{
+	const char *ptr;
+	size_t len;
+	char *owned;		// buffer to be freed after processing (decompressed data), NULL for mapped file
+	size_t seq;			// order of chunk in imported logs, assigned by queue
+} tImportChunk;
+
+
+// New flights seen in chunk and latest message timestamp after processing it
+typedef struct chunkFlights
+{
+	std::vector<tFlightSighting> sightings;
+	std::time_t lastTime;
+} tChunkFlights;
+
+
+// Mapped log file, unmapped after all workers finish
+typedef struct importMapping
+{
+	void *addr;
+	size_t len;
+} tImportMapping;
+
+
+// Bounded queue of chunks between reader (main thread) and worker threads
+class chunkQueue
+{
+	std::deque<tImportChunk> chunks;
+	std::mutex lock;
+	std::condition_variable notEmpty;
+	std::condition_variable notFull;
+	size_t capacity;
+	size_t pushed;
+	bool closed;
+	
+	public:
+		chunkQueue(size_t cap) : capacity(cap), pushed(0), closed(false) {}
+		
+		// Add chunk, blocks while queue is full
+		void push(tImportChunk c)
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			while (chunks.size() >= capacity)
+			{
+				notFull.wait(guard);
+			}
+			c.seq = pushed++;
+			chunks.push_back(c);
+			notEmpty.notify_one();
+		}
+		
+		// Take chunk, blocks while queue is empty, returns false when queue is closed and empty
+		bool pop(tImportChunk &c)
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			while (chunks.empty() && !closed)
+			{
+				notEmpty.wait(guard);
+			}
+			if (chunks.empty())
+			{
+				return false;
+			}
+			c = chunks.front();
+			chunks.pop_front();
+			notFull.notify_one();
+			return true;
+		}
+		
+		// No more chunks will be added
+		void close()
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			closed = true;
+			notEmpty.notify_all();
+		}
+};
+
+
+// New flights of processed chunks, indexed by chunk order
+class flightLog
+{
+	std::map<size_t, tChunkFlights> chunks;
+	std::mutex lock;
+	
+	public:
+		// Store flights of chunk
+		void store(size_t seq, tChunkFlights &f)
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			chunks[seq].sightings.swap(f.sightings);
+			chunks[seq].lastTime = f.lastTime;
+		}
+		
+		// Count flights into company plot of stats in order of chunks, flight buffer is flushed
+		// after every chunk as if chunks were processed by single partial
+		void count(data &stats)
+		{
+			std::time_t last = 0;
+			std::map<size_t, tChunkFlights>::const_iterator it;
+			for (it = chunks.begin(); it != chunks.end(); ++it)
+			{
+				for (size_t i = 0; i < it->second.sightings.size(); i++)
+				{
+					stats.addFlight(it->second.sightings[i]);
+				}
+				last = std::max(last, it->second.lastTime);
+				stats.flushFBuffer(last);
+			}
+		}
+};
+
+
+
+/**
+ * Worker thread - processes chunks from queue into its own partial object. Company plot is not
+ * counted by worker, new flights of each chunk are stored into log instead.
+ * @param queue - queue of chunks
+ * @param partial - partial statistics owned by this worker
+ * @param log - log of new flights of chunks
+ */
+void importWorker(chunkQueue *queue, data *partial, flightLog *log)
+{
+	TRACE_THREAD("import worker");
+	
+	std::vector<tLineView> lines;
+	tImportChunk c;
+	tChunkFlights flights;
+	partial->setFlightLog(&flights.sightings);
+	
+	while (queue->pop(c))
+	{
+		TRACE_SCOPE("chunk");
+		lines.clear();
+		size_t consumed = frameLines(c.ptr, c.len, lines);
+		
+		// last line of file does not have to be terminated
+		if (consumed < c.len)
+		{
+			tLineView last;
+			last.ptr = c.ptr + consumed;
+			last.len = c.len - consumed;
+			lines.push_back(last);
+		}
+		
+		// worker chunks are not consecutive, flight buffer only removes duplicates inside chunk
+		partial->clearFBuffer();
+		partial->processBatch(lines.data(), lines.size(), 0);
+		
+		// lastLogTime covers earlier chunks of this worker only, all of them precede this one
+		flights.lastTime = partial->getLastLogTime();
+		log->store(c.seq, flights);
+		flights.sightings.clear();
+		
+		free(c.owned);
+	}
+}
+
+
+
+/**
+ * Function maps plain log file into memory and queues it split at line boundaries.
+ * @param path - path to log file
+ * @param queue - queue of chunks
+ * @param maps - list of mappings to be released after processing
+ * @param bytes - increased by size of queued data
+ * @param begin - offset of first byte to be queued
+ * @param limit - number of bytes to be queued (at most)
+ * @return zero if success, nonzero otherwise
+ */
+int queuePlain(const std::string &path, chunkQueue &queue, std::vector<tImportMapping> &maps, uint64_t &bytes, uint64_t begin, uint64_t limit)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		fprintf(stderr, "ERROR: Unable to open log file: [%s]\n", path.c_str());
+		return 1;
+	}
+	
+	struct stat st;
+	if (fstat(fd, &st) < 0)
+	{
+		fprintf(stderr, "ERROR: Unable to stat log file: [%s]\n", path.c_str());
+		close(fd);
+		return 1;
+	}
+	if (st.st_size == 0)
+	{
+		close(fd);
+		return 0;
+	}
+	
+	size_t size = st.st_size;
+	void *addr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED)
+	{
+		fprintf(stderr, "ERROR: Unable to map log file: [%s]\n", path.c_str());
+		return 1;
+	}
+	madvise(addr, size, MADV_SEQUENTIAL);
+	
+	tImportMapping m;
+	m.addr = addr;
+	m.len = size;
+	maps.push_back(m);
+	
+	const char *base = (const char *) addr;
+	size_t start = (begin < size) ? begin : size;
+	if (limit < size - start)
+	{
+		size = start + limit;
+	}
+	bytes += size - start;
+	
+	while (start < size)
+	{
+		size_t end = start + IMPORT_CHUNK_SIZE;
+		if (end >= size)
+		{
+			end = size;
+		}
+		else
+		{
+			const char *nl = (const char *) memchr(base + end, '\n', size - end);
+			end = (nl != NULL) ? (nl - base) + 1 : size;
+		}
+		
+		tImportChunk c;
+		c.ptr = base + start;
+		c.len = end - start;
+		c.owned = NULL;
+		queue.push(c);
+		
+		start = end;
+	}
+	
+	return 0;
+}
+
+
+
+/**
+ * Function decompresses gzip log file and queues decompressed data split at line boundaries.
+ * Decompression may start at beginning of any gzip member (recorded segments consist of one member per block).
+ * @param path - path to log file
+ * @param queue - queue of chunks
+ * @param bytes - increased by size of decompressed data
+ * @param begin - offset of first gzip member to be decompressed
+ * @param limit - number of decompressed bytes to be queued (at most)
+ * @return zero if success, nonzero otherwise
+ */
+int queueGzip(const std::string &path, chunkQueue &queue, uint64_t &bytes, uint64_t begin, uint64_t limit)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+	if ((fd < 0) || (lseek(fd, begin, SEEK_SET) < 0))
+	{
+		fprintf(stderr, "ERROR: Unable to open log file: [%s]\n", path.c_str());
+		return 1;
+	}
+	
+	gzFile gz = gzdopen(fd, "rb");
+	if (gz == NULL)
+	{
+		fprintf(stderr, "ERROR: Unable to open log file: [%s]\n", path.c_str());
+		close(fd);
+		return 1;
+	}
+	gzbuffer(gz, 1024 * 1024);
+	
+	char *buf = (char *) malloc(IMPORT_CHUNK_SIZE);
+	size_t fill = 0;		// bytes carried over from previous chunk
+	int result = 0;
+	
+	while (limit > 0)
+	{
+		size_t room = IMPORT_CHUNK_SIZE - fill;
+		if (room > limit)
+		{
+			room = limit;
+		}
+		
+		int n = gzread(gz, buf + fill, room);
+		if (n < 0)
+		{
+			fprintf(stderr, "ERROR: Decompression of log file failed: [%s]\n", path.c_str());
+			result = 1;
+			break;
+		}
+		if (n == 0)
+		{
+			break;
+		}
+		
+		bytes += n;
+		fill += n;
+		limit -= n;
+		
+		// queue whole lines, carry incomplete last line into next buffer
+		const char *nl = (const char *) memrchr(buf, '\n', fill);
+		size_t len = (nl != NULL) ? (nl - buf) + 1 : fill;
+		
+		char *next = (char *) malloc(IMPORT_CHUNK_SIZE);
+		memcpy(next, buf + len, fill - len);
+		
+		tImportChunk c;
+		c.ptr = buf;
+		c.len = len;
+		c.owned = buf;
+		queue.push(c);
+		
+		fill -= len;
+		buf = next;
+	}
+	
+	if (fill > 0)
+	{
+		tImportChunk c;
+		c.ptr = buf;
+		c.len = fill;
+		c.owned = buf;
+		queue.push(c);
+	}
+	else
+	{
+		free(buf);
+	}
+	
+	gzclose(gz);
+	return result;
+}
+
+
+
+
+/**
+ * Function finds part of recorded segment covering provided time range using segment index.
+ * Range is resolved with granularity of recorded blocks.
+ * @param path - path to segment
+ * @param from - start of time range
+ * @param to - end of time range
+ * @param begin - set to file offset of first block in range
+ * @param rawLimit - set to uncompressed length of blocks in range
+ * @return zero if range was resolved, nonzero if segment has no index
+ */
+int findRecordRange(const std::string &path, std::time_t from, std::time_t to, uint64_t &begin, uint64_t &rawLimit)
+{
+	std::vector<tRecordIndex> index;
+	if ((loadRecordIndex(path, index) != 0) || index.empty())
+	{
+		return 1;
+	}
+	
+	size_t first = index.size();
+	size_t last = index.size();
+	for (size_t i = 0; i < index.size(); i++)
+	{
+		// block i contains data received in <timestamp[i], timestamp[i + 1])
+		bool endsBefore = (i + 1 < index.size()) && (index[i + 1].timestamp < from);
+		if ((first == index.size()) && !endsBefore)
+		{
+			first = i;
+		}
+		if (index[i].timestamp > to)
+		{
+			last = i;
+			break;
+		}
+	}
+	
+	if ((first == index.size()) || (first >= last))
+	{
+		rawLimit = 0;
+		begin = 0;
+		return 0;
+	}
+	
+	begin = index[first].offset;
+	rawLimit = (last < index.size()) ? index[last].rawOffset - index[first].rawOffset : UINT64_MAX;
+	return 0;
+}
+
+}
+
+
+
+/**
+ * Function imports archived SBS logs into stats.
+ * Logs are read by main thread (plain files are mapped, files ending with .gz are decompressed),
+ * split into chunks at line boundaries and processed by worker threads. Every worker fills its own
+ * partial object in log time mode (flight buffer uses message timestamps), partials are merged into
+ * stats after all files are processed.
+ * Company plot is counted in one pass over new flights of all chunks in log order, so flights
+ * crossing chunk boundary are counted once and result does not depend on number of threads.
+ * If time range is provided, only blocks of recorded segments (see feedRecorder) received in this
+ * range are read, located through segment index. Files without index are read whole.
+ * @param stats - statistics to be extended
+ * @param files - paths to log files
+ * @param threads - number of worker threads
+ * @param projection - use local tangent plane projection in partials
+ * @param from - start of time range (zero for unlimited)
+ * @param to - end of time range (zero for unlimited)
+ * @return zero if success, nonzero otherwise
+ */
+int importLogs(data &stats, const std::vector<std::string> &files, int threads, bool projection, std::time_t from, std::time_t to)
+{
+	if (threads < 1)
+	{
+		threads = 1;
+	}
+	
+	tCoords ref = stats.getRef();
+	std::vector<data> partials;
+	for (int i = 0; i < threads; i++)
+	{
+		partials.push_back(data(ref.lat, ref.lon));
+		partials[i].setLogTime(true);
+		partials[i].setProjection(projection);
+		partials[i].setHeatBudget(stats.getHeatBudget());
+	}
+	
+	chunkQueue queue(2 * threads);
+	flightLog flights;
+	std::vector<tImportMapping> maps;
+	uint64_t bytes = 0;
+	int result = 0;
+	
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	
+	std::vector<std::thread> workers;
+	for (int i = 0; i < threads; i++)
+	{
+		workers.push_back(std::thread(importWorker, &queue, &partials[i], &flights));
+	}
+	
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		const std::string &path = files[i];
+		bool gzip = (path.size() > 3) && (path.compare(path.size() - 3, 3, ".gz") == 0);
+		
+		uint64_t begin = 0;
+		uint64_t limit = UINT64_MAX;
+		if ((from != 0) || (to != 0))
+		{
+			findRecordRange(path, from, (to != 0) ? to : LONG_MAX, begin, limit);
+		}
+		
+		if ((gzip ? queueGzip(path, queue, bytes, begin, limit) : queuePlain(path, queue, maps, bytes, begin, limit)) != 0)
+		{
+			result = 1;
+		}
+	}
+	
+	queue.close();
+	for (int i = 0; i < threads; i++)
+	{
+		workers[i].join();
+	}
+	
+	for (size_t i = 0; i < maps.size(); i++)
+	{
+		munmap(maps[i].addr, maps[i].len);
+	}
+	
+	for (int i = 0; i < threads; i++)
+	{
+		stats.merge(partials[i]);
+	}
+	
+	data companies(ref.lat, ref.lon);
+	companies.setLogTime(true);
+	flights.count(companies);
+	stats.merge(companies);
+	
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	double mb = bytes / (1024.0 * 1024.0);
+	fprintf(stdout, "Imported %.1f MB in %.2f s (%.1f MB/s, %d threads).\n", mb, elapsed, (elapsed > 0.0) ? mb / elapsed : 0.0, threads);
+	
+	return result;
+}
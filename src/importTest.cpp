@@ -0,0 +1,236 @@
+/* DumpStats - dump1090 feed statistical data collector
+ * Copyright (C) 2015 Marcel Kebisek
+ * Contact: marcel.kebisek@gmail.com
+ * 
+ * This file is part of DumpStats.
+ * 
+ * DumpStats is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * DumpStats is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with DumpStats. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// importTest - checks that import of log gives the same statistics (including company plot) with any number of threads (run by make test)
+
+#include "objects.H"
+#include "import.H"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+
+// Reference position of generated log
+#define TEST_LAT 48.1
+#define TEST_LON 17.1
+
+// Size of generated log - several import chunks, so flights cross chunk boundaries
+#define TEST_LOG_SIZE (3 * IMPORT_CHUNK_SIZE + IMPORT_CHUNK_SIZE / 2)
+
+// Aircraft in generated log
+#define TEST_AIRCRAFT 300
+
+// Thread counts compared against single thread
+static const int testThreads[] = {2, 4, 7};
+
+
+// Small deterministic generator, so failures are reproducible
+static uint64_t testState = 0x9E3779B97F4A7C15ull;
+
+static unsigned testRandom(unsigned n)
+{
+	testState ^= testState << 13;
+	testState ^= testState >> 7;
+	testState ^= testState << 17;
+	return (testState >> 11) % n;
+}
+
+
+/**
+ * Function writes SBS log of aircraft sending identification and position messages over several hours.
+ * Aircraft change their callsign from time to time, so flight buffer expires and counts flights again.
+ * @param path - path to log file
+ * @return zero if success, nonzero otherwise
+ */
+static int testWriteLog(const char *path)
+{
+	static const char *airlines[] = {"RYR", "WZZ", "DLH", "AUA", "BAW", "AFR", "KLM", "QTR", "UAE", "THY", "EZY", "SWR"};
+	
+	FILE *f = fopen(path, "w");
+	if (f == NULL)
+	{
+		fprintf(stderr, "ERROR: Unable to create test log: [%s]\n", path);
+		return 1;
+	}
+	
+	std::vector<std::string> callsigns(TEST_AIRCRAFT);
+	long size = 0;
+	for (unsigned k = 0; size < TEST_LOG_SIZE; k++)
+	{
+		unsigned a = testRandom(TEST_AIRCRAFT);
+		if (callsigns[a].empty() || (testRandom(400) == 0))
+		{
+			char cs[16];
+			sprintf(cs, "%s%u", airlines[testRandom(12)], 100 + testRandom(9900));
+			callsigns[a] = cs;
+		}
+		
+		// 20 messages per second
+		unsigned ms = k * 50;
+		char ts[64];
+		sprintf(ts, "2015/06/01,%02u:%02u:%02u.%03u", (ms / 3600000) % 24, (ms / 60000) % 60, (ms / 1000) % 60, ms % 1000);
+		
+		int n;
+		if (testRandom(10) == 0)
+		{
+			n = fprintf(f, "MSG,1,111,11111,%06X,111111,%s,%s,%s,,,,,,,,,,,\r\n", 0x400000 + a, ts, ts, callsigns[a].c_str());
+		}
+		else
+		{
+			double lat = TEST_LAT - 3.0 + testRandom(6000) / 1000.0;
+			double lon = TEST_LON - 4.0 + testRandom(8000) / 1000.0;
+			n = fprintf(f, "MSG,3,111,11111,%06X,111111,%s,%s,,%u,,,%.5f,%.5f,,,0,0,0,0\r\n", 0x400000 + a, ts, ts, 1000 + 25 * testRandom(1600), lat, lon);
+		}
+		size += n;
+	}
+	
+	return (fclose(f) == 0) ? 0 : 1;
+}
+
+
+/**
+ * Function imports log with provided number of threads and renders resulting statistics.
+ * @param path - path to log file
+ * @param threads - number of worker threads
+ * @param out - init file (without timestamp line) and distinct sketches
+ * @param companies - set to number of airlines in company plot section
+ * @return zero if success, nonzero otherwise
+ */
+static int testImport(const char *path, int threads, std::string &out, size_t &companies)
+{
+	data stats(TEST_LAT, TEST_LON);
+	std::vector<std::string> files(1, path);
+	if (importLogs(stats, files, threads, false, 0, 0) != 0)
+	{
+		return 1;
+	}
+	
+	std::ostringstream f;
+	stats.renderFile(f);
+	out = f.str();
+	out.erase(0, out.find('\n') + 1);
+	
+	// lines of company plot section are AAA|count
+	companies = 0;
+	std::istringstream lines(out);
+	std::string line;
+	while (std::getline(lines, line))
+	{
+		companies += (line.size() > 4) && (line[3] == '|') && isalpha(line[0]);
+	}
+	
+	std::string sketches;
+	stats.renderSketches(sketches);
+	out += sketches;
+	return 0;
+}
+
+
+/**
+ * Function processes chunks starting with position messages in log time mode (as import worker does) and checks
+ * that they do not enter aircraft state table with zero time (expired by the first real timestamp then).
+ * @return zero if success, nonzero otherwise
+ */
+static int testLeadingPositions()
+{
+	static const char *noTime =
+		"MSG,3,111,11111,400001,111111,2015/06/01,12:00:00.000,2015/06/01,12:00:00.000,,5000,,,48.10000,17.10000,,,0,0,0,0\r\n"
+		"MSG,3,111,11111,400002,111111,2015/06/01,12:00:00.050,2015/06/01,12:00:00.050,,6000,,,48.20000,17.20000,,,0,0,0,0\r\n";
+	static const char *seeded =
+		"MSG,3,111,11111,400003,111111,2015/06/01,12:00:00.100,2015/06/01,12:00:00.100,,7000,,,48.30000,17.30000,,,0,0,0,0\r\n"
+		"MSG,1,111,11111,400004,111111,2015/06/01,12:00:00.150,2015/06/01,12:00:00.150,RYR100,,,,,,,,,,,\r\n";
+	
+	data stats(TEST_LAT, TEST_LON);
+	stats.setLogTime(true);
+	std::vector<tLineView> lines;
+	
+	frameLines(noTime, strlen(noTime), lines);
+	stats.processBatch(lines.data(), lines.size(), 0);
+	lines.clear();
+	frameLines(seeded, strlen(seeded), lines);
+	stats.processBatch(lines.data(), lines.size(), 0);
+	
+	int expired = stats.expireAircraft(stats.getLastLogTime());
+	bool ok = (stats.getLastLogTime() > 0) && (expired == 0);
+	printf("import     chunks starting with positions, %s\n", ok ? "ok" : "FAILED");
+	if (! ok)
+	{
+		fprintf(stderr, "ERROR: Positions before first timestamp of chunk entered state table with zero time (%d expired)!\n", expired);
+		return 1;
+	}
+	return 0;
+}
+
+
+int main()
+{
+	char path[] = "/tmp/importTestXXXXXX";
+	int fd = mkstemp(path);
+	if (fd < 0)
+	{
+		fprintf(stderr, "ERROR: Unable to create test log!\n");
+		return 1;
+	}
+	close(fd);
+	
+	int failed = testLeadingPositions();
+	if (failed == 0)
+	{
+		failed = testWriteLog(path);
+	}
+	
+	std::string expected;
+	size_t companies = 0;
+	if ((failed == 0) && (testImport(path, 1, expected, companies) != 0))
+	{
+		failed = 1;
+	}
+	if ((failed == 0) && (companies == 0))
+	{
+		fprintf(stderr, "ERROR: Company plot of imported log is empty!\n");
+		failed = 1;
+	}
+	
+	for (size_t i = 0; (failed == 0) && (i < sizeof(testThreads) / sizeof(testThreads[0])); i++)
+	{
+		std::string result;
+		size_t n;
+		if (testImport(path, testThreads[i], result, n) != 0)
+		{
+			failed = 1;
+			break;
+		}
+		bool same = (result == expected);
+		printf("import     %d threads against 1 thread (%zu airlines), %s\n", testThreads[i], companies, same ? "ok" : "FAILED");
+		if (! same)
+		{
+			fprintf(stderr, "ERROR: Import with %d threads differs from single thread!\n", testThreads[i]);
+			failed = 1;
+		}
+	}
+	
+	unlink(path);
+	return failed;
+}
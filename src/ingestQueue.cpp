@@ -0,0 +1,446 @@
+/* DumpStats - dump1090 feed statistical data collector
+ * Copyright (C) 2015 Marcel Kebisek
+ * Contact: marcel.kebisek@gmail.com
+ * 
+ * This file is part of DumpStats.
+ * 
+ * DumpStats is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * DumpStats is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with DumpStats. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ingestQueue.H"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+
+/**
+ * Function returns monotonic time.
+ * @return time in nanoseconds
+ */
+uint64_t ingestNow()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+
+
+/**
+ * Function pins calling thread to single CPU.
+ * @param cpu - CPU number
+ * @return zero if succeeded
+ */
+int ingestPin(int cpu)
+{
+	if ((cpu < 0) || (cpu >= CPU_SETSIZE))
+	{
+		return -1;
+	}
+	
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+
+
+/**
+ * Function returns histogram bucket of latency. Values below 2^LATENCY_SUB_BITS have bucket each,
+ * every following power of 2 is split into 2^LATENCY_SUB_BITS buckets.
+ * @param ns - latency in nanoseconds
+ * @return bucket index
+ */
+static int latencyBucket(uint64_t ns)
+{
+	if (ns < (1u << LATENCY_SUB_BITS))
+	{
+		return (int) ns;
+	}
+	int e = 63 - __builtin_clzll(ns);
+	return ((e - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS) + (int) ((ns >> (e - LATENCY_SUB_BITS)) & ((1u << LATENCY_SUB_BITS) - 1));
+}
+
+/**
+ * Function returns largest latency of histogram bucket.
+ * @param bucket - bucket index
+ * @return latency in nanoseconds
+ */
+static uint64_t latencyUpper(int bucket)
+{
+	if (bucket < (1 << LATENCY_SUB_BITS))
+	{
+		return bucket;
+	}
+	int shift = (bucket >> LATENCY_SUB_BITS) - 1;
+	uint64_t sub = bucket & ((1 << LATENCY_SUB_BITS) - 1);
+	return (((1ull << LATENCY_SUB_BITS) + sub + 1) << shift) - 1;
+}
+
+
+
+/**
+ * Constructor.
+ */
+latencyHistogram::latencyHistogram()
+{
+	memset(counts, 0, sizeof(counts));
+	total = 0;
+	maximum = 0;
+}
+
+
+
+/**
+ * Function adds latency sample.
+ * @param ns - latency in nanoseconds
+ */
+void latencyHistogram::add(uint64_t ns)
+{
+	counts[latencyBucket(ns)]++;
+	total++;
+	maximum = std::max(maximum, ns);
+}
+
+
+
+/**
+ * Function returns latency percentile.
+ * @param q - fraction of samples (0-1)
+ * @return upper bound of bucket containing percentile (nanoseconds), zero without samples
+ */
+uint64_t latencyHistogram::percentile(double q) const
+{
+	if (total == 0)
+	{
+		return 0;
+	}
+	
+	uint64_t rank = std::max((uint64_t) 1, (uint64_t) ceil(q * total));
+	uint64_t seen = 0;
+	for (int i = 0; i < LATENCY_BUCKETS; i++)
+	{
+		seen += counts[i];
+		if (seen >= rank)
+		{
+			return std::min(latencyUpper(i), maximum);
+		}
+	}
+	return maximum;
+}
+
+
+
+/**
+ * Function returns number of samples.
+ * @return number of samples
+ */
+uint64_t latencyHistogram::count() const
+{
+	return total;
+}
+
+
+
+/**
+ * Function returns largest sample.
+ * @return latency in nanoseconds
+ */
+uint64_t latencyHistogram::max() const
+{
+	return maximum;
+}
+
+
+
+/**
+ * Constructor.
+ */
+ingestQueue::ingestQueue()
+{
+	eventFd = -1;
+	blocking = false;
+	head = 0;
+	markHead = 0;
+	tail = 0;
+	markTail = 0;
+	sleeping = false;
+	closed = false;
+	abandoned = false;
+}
+
+
+
+/**
+ * Destructor.
+ */
+ingestQueue::~ingestQueue()
+{
+	if (eventFd >= 0)
+	{
+		::close(eventFd);
+	}
+}
+
+
+
+/**
+ * Function allocates queue.
+ * @param blocking - processor sleeps in poll() on eventfd when queue is empty (otherwise it spins)
+ * @return zero if succeeded
+ */
+int ingestQueue::open(bool blocking)
+{
+	this->blocking = blocking;
+	ring.assign(INGEST_QUEUE_SIZE, 0);
+	marks.resize(INGEST_MARKS);
+	if (blocking)
+	{
+		eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (eventFd < 0)
+		{
+			fprintf(stderr, "ERROR: Unable to create eventfd of ingest queue!\n");
+			return -1;
+		}
+	}
+	return 0;
+}
+
+
+
+/**
+ * Function returns eventfd signalled when data arrives for sleeping processor.
+ * @return file descriptor, negative for busy queue
+ */
+int ingestQueue::fd() const
+{
+	return eventFd;
+}
+
+
+
+/**
+ * Function wakes up processor, if it announced sleep. Caller has published data before
+ * (full fence pairs with fence of sleep(), so either reader sees announcement or processor sees data).
+ */
+void ingestQueue::wake()
+{
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (sleeping.load(std::memory_order_relaxed) && sleeping.exchange(false))
+	{
+		uint64_t one = 1;
+		ssize_t n = ::write(eventFd, &one, sizeof(one));
+		(void) n;
+	}
+}
+
+
+
+/**
+ * Function appends block to queue. Time mark of block is published before its data, so block is never
+ * processed without mark. While queue is full, reader spins (busy queue) or sleeps for a while.
+ * @param data - block
+ * @param len - length of block
+ * @param time - monotonic time of socket read (nanoseconds)
+ * @return false if processor ended
+ */
+bool ingestQueue::write(const char *data, size_t len, uint64_t time)
+{
+	size_t size = ring.size();
+	uint64_t h = head.load(std::memory_order_relaxed);
+	
+	uint64_t m = markHead.load(std::memory_order_relaxed);
+	if (m - markTail.load(std::memory_order_acquire) < INGEST_MARKS)
+	{
+		marks[m & (INGEST_MARKS - 1)].end = h + len;
+		marks[m & (INGEST_MARKS - 1)].time = time;
+		markHead.store(m + 1, std::memory_order_release);
+	}
+	
+	size_t done = 0;
+	while (done < len)
+	{
+		if (abandoned.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+		
+		size_t space = size - (size_t) (h - tail.load(std::memory_order_acquire));
+		if (space == 0)
+		{
+			if (blocking)
+			{
+				usleep(50);
+			}
+			else
+			{
+				ingestPause();
+			}
+			continue;
+		}
+		
+		size_t n = std::min(space, len - done);
+		size_t pos = h & (size - 1);
+		size_t first = std::min(n, size - pos);
+		memcpy(&ring[pos], data + done, first);
+		memcpy(&ring[0], data + done + first, n - first);
+		done += n;
+		h += n;
+		head.store(h, std::memory_order_release);
+		if (blocking)
+		{
+			wake();
+		}
+	}
+	return true;
+}
+
+
+
+/**
+ * Function ends stream, processor ends after reading the rest of queue.
+ */
+void ingestQueue::close()
+{
+	closed.store(true, std::memory_order_release);
+	if (blocking)
+	{
+		wake();
+	}
+}
+
+
+
+/**
+ * Function announces sleep of processor. Announcement is followed by full fence and check of queue,
+ * so data written after check always wakes processor up.
+ * @return true if processor may sleep, false if data is available
+ */
+bool ingestQueue::sleep()
+{
+	sleeping.store(true, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (available())
+	{
+		sleeping.store(false, std::memory_order_relaxed);
+		return false;
+	}
+	return true;
+}
+
+
+
+/**
+ * Function clears eventfd and sleep announcement after processor woke up.
+ */
+void ingestQueue::awake()
+{
+	sleeping.store(false, std::memory_order_relaxed);
+	uint64_t value;
+	ssize_t n = ::read(eventFd, &value, sizeof(value));
+	(void) n;
+}
+
+
+
+/**
+ * Function checks whether processor has anything to read.
+ * @return true if data or end of stream is available
+ */
+bool ingestQueue::available() const
+{
+	return (head.load(std::memory_order_acquire) != tail.load(std::memory_order_relaxed)) || closed.load(std::memory_order_acquire);
+}
+
+
+
+/**
+ * Function reads data of queue.
+ * @param data - output buffer
+ * @param len - size of buffer
+ * @return number of bytes read, zero at end of stream
+ */
+size_t ingestQueue::read(char *data, size_t len)
+{
+	size_t size = ring.size();
+	uint64_t t = tail.load(std::memory_order_relaxed);
+	size_t n = std::min((size_t) (head.load(std::memory_order_acquire) - t), len);
+	size_t pos = t & (size - 1);
+	size_t first = std::min(n, size - pos);
+	memcpy(data, &ring[pos], first);
+	memcpy(data + first, &ring[0], n - first);
+	tail.store(t + n, std::memory_order_release);
+	return n;
+}
+
+
+
+/**
+ * Function records latency of blocks, which were read whole.
+ * @param now - monotonic time (nanoseconds) when their statistics were updated
+ * @param latency - histogram of latencies
+ */
+void ingestQueue::processed(uint64_t now, latencyHistogram &latency)
+{
+	uint64_t t = tail.load(std::memory_order_relaxed);
+	uint64_t m = markTail.load(std::memory_order_relaxed);
+	uint64_t end = markHead.load(std::memory_order_acquire);
+	while ((m != end) && (marks[m & (INGEST_MARKS - 1)].end <= t))
+	{
+		const tIngestMark &mark = marks[m & (INGEST_MARKS - 1)];
+		latency.add((now > mark.time) ? now - mark.time : 0);
+		m++;
+	}
+	markTail.store(m, std::memory_order_release);
+}
+
+
+
+/**
+ * Function ends processing, reader stops at next write.
+ */
+void ingestQueue::abandon()
+{
+	abandoned.store(true, std::memory_order_release);
+}
+
+
+
+/**
+ * Function returns number of bytes waiting for processor.
+ * @return backlog in bytes
+ */
+size_t ingestQueue::backlog() const
+{
+	return (size_t) (head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed));
+}
+
+
+
+/**
+ * Function returns size of queue.
+ * @return capacity in bytes
+ */
+size_t ingestQueue::capacity() const
+{
+	return ring.size();
+}
@@ -0,0 +1,288 @@
+/* DumpStats - dump1090 feed statistical data collector
+ * Copyright (C) 2015 Marcel Kebisek
+ * Contact: marcel.kebisek@gmail.com
+ * 
+ * This file is part of DumpStats.
+ * 
+ * DumpStats is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * DumpStats is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with DumpStats. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "liveStats.H"
+
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+/**
+ * Function converts segment name into shm_open() name (leading slash).
+ * @param name - segment name
+ * @return shm_open() name
+ */
+static std::string liveShmName(const std::string &name)
+{
+	return (name.empty() || (name[0] != '/')) ? "/" + name : name;
+}
+
+
+
+/**
+ * Constructor.
+ */
+liveWriter::liveWriter()
+{
+	seg = NULL;
+}
+
+
+
+/**
+ * Destructor.
+ */
+liveWriter::~liveWriter()
+{
+	close();
+}
+
+
+
+/**
+ * Function creates and maps shared memory segment, existing segment of the same name is reused.
+ * @param name - segment name
+ * @return zero if success, nonzero otherwise
+ */
+int liveWriter::open(const std::string &name)
+{
+	this->name = liveShmName(name);
+	
+	int fd = shm_open(this->name.c_str(), O_CREAT | O_RDWR, 0644);
+	if (fd == -1)
+	{
+		fprintf(stderr, "ERROR: Unable to create shared memory segment %s!\n", this->name.c_str());
+		return 1;
+	}
+	
+	if (ftruncate(fd, sizeof(tLiveSegment)) == -1)
+	{
+		fprintf(stderr, "ERROR: Unable to resize shared memory segment %s!\n", this->name.c_str());
+		::close(fd);
+		return 1;
+	}
+	
+	void *p = mmap(NULL, sizeof(tLiveSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (p == MAP_FAILED)
+	{
+		fprintf(stderr, "ERROR: Unable to map shared memory segment %s!\n", this->name.c_str());
+		return 1;
+	}
+	
+	seg = (tLiveSegment *) p;
+	
+	// header is written last, so reader never accepts half initialized segment
+	seg->seq.store(0, std::memory_order_relaxed);
+	seg->messages.store(0, std::memory_order_relaxed);
+	memset(&seg->data, 0, sizeof(seg->data));
+	seg->version = LIVE_VERSION;
+	seg->size = sizeof(tLiveSegment);
+	std::atomic_thread_fence(std::memory_order_release);
+	memcpy(seg->magic, LIVE_MAGIC, sizeof(seg->magic));
+	
+	return 0;
+}
+
+
+
+/**
+ * Function starts update of segment data.
+ * @return data to be filled
+ */
+tLiveData *liveWriter::begin()
+{
+	seg->seq.store(seg->seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	return &seg->data;
+}
+
+
+
+/**
+ * Function finishes update of segment data.
+ */
+void liveWriter::end()
+{
+	seg->seq.store(seg->seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+
+
+/**
+ * Function publishes number of messages read by processor, readers see it without waiting for next update of data.
+ * @param messages - messages read so far
+ */
+void liveWriter::progress(uint64_t messages)
+{
+	seg->messages.store(messages, std::memory_order_release);
+}
+
+
+
+/**
+ * Function unmaps and removes segment. Readers which have it mapped keep last published data.
+ */
+void liveWriter::close()
+{
+	if (seg != NULL)
+	{
+		munmap(seg, sizeof(tLiveSegment));
+		shm_unlink(name.c_str());
+		seg = NULL;
+	}
+}
+
+
+
+/**
+ * Function maps existing segment read-only and checks its header.
+ * @param name - segment name
+ * @param r - reader to initialize
+ * @param quiet - do not report missing or incompatible segment (caller waits for collector to create it)
+ * @return zero if success, nonzero otherwise
+ */
+int liveOpen(const std::string &name, tLiveReader &r, bool quiet)
+{
+	std::string shmName = liveShmName(name);
+	
+	int fd = shm_open(shmName.c_str(), O_RDONLY, 0);
+	if (fd == -1)
+	{
+		if (! quiet)
+		{
+			fprintf(stderr, "ERROR: Shared memory segment %s does not exist!\n", shmName.c_str());
+		}
+		return 1;
+	}
+	
+	struct stat st;
+	if ((fstat(fd, &st) == -1) || ((size_t) st.st_size < sizeof(tLiveSegment)))
+	{
+		if (! quiet)
+		{
+			fprintf(stderr, "ERROR: Shared memory segment %s is not compatible!\n", shmName.c_str());
+		}
+		::close(fd);
+		return 1;
+	}
+	
+	void *p = mmap(NULL, sizeof(tLiveSegment), PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (p == MAP_FAILED)
+	{
+		fprintf(stderr, "ERROR: Unable to map shared memory segment %s!\n", shmName.c_str());
+		return 1;
+	}
+	
+	r.seg = (const tLiveSegment *) p;
+	if ((memcmp(r.seg->magic, LIVE_MAGIC, sizeof(r.seg->magic)) != 0) || (r.seg->version != LIVE_VERSION) || (r.seg->size != sizeof(tLiveSegment)))
+	{
+		if (! quiet)
+		{
+			fprintf(stderr, "ERROR: Shared memory segment %s is not compatible!\n", shmName.c_str());
+		}
+		liveClose(r);
+		return 1;
+	}
+	
+	return 0;
+}
+
+
+
+/**
+ * Function unmaps segment.
+ * @param r - reader
+ */
+void liveClose(tLiveReader &r)
+{
+	if (r.seg != NULL)
+	{
+		munmap((void *) r.seg, sizeof(tLiveSegment));
+		r.seg = NULL;
+	}
+}
+
+
+
+/**
+ * Function starts read section, it waits while writer is updating data.
+ * @param r - reader
+ * @return sequence number to be passed to liveRetry()
+ */
+uint32_t liveBegin(const tLiveReader &r)
+{
+	uint32_t seq;
+	while ((seq = r.seg->seq.load(std::memory_order_acquire)) & 1)
+	{
+		std::this_thread::yield();
+	}
+	return seq;
+}
+
+
+
+/**
+ * Function ends read section.
+ * @param r - reader
+ * @param seq - sequence number returned by liveBegin()
+ * @return true if writer changed data since liveBegin() and read has to be repeated
+ */
+bool liveRetry(const tLiveReader &r, uint32_t seq)
+{
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return r.seg->seq.load(std::memory_order_relaxed) != seq;
+}
+
+
+
+/**
+ * Function copies consistent snapshot of whole data.
+ * @param r - reader
+ * @param out - copy of data
+ */
+void liveRead(const tLiveReader &r, tLiveData &out)
+{
+	uint32_t seq;
+	do
+	{
+		seq = liveBegin(r);
+		memcpy(&out, (const void *) &r.seg->data, sizeof(out));
+	}
+	while (liveRetry(r, seq));
+}
+
+
+
+/**
+ * Function returns number of messages read by processor so far (updated after each batch, outside of seqlock).
+ * @param r - reader
+ * @return messages read
+ */
+uint64_t liveMessages(const tLiveReader &r)
+{
+	return r.seg->messages.load(std::memory_order_acquire);
+}
@@ -0,0 +1,758 @@
+/* DumpStats - dump1090 feed statistical data collector
+ * Copyright (C) 2015 Marcel Kebisek
+ * Contact: marcel.kebisek@gmail.com
+ * 
+ * This file is part of DumpStats.
+ * 
+ * DumpStats is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * DumpStats is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with DumpStats. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// dumpStatsGen - load generator serving synthetic SBS traffic over TCP (serve mode) and benchmark of collect mode
+// driving dumpStats against it (bench mode).
+//
+// Messages are produced every GEN_TICK_US as due by current rate and queued for client, messages not fitting into
+// queue of GEN_CLIENT_BUFFER bytes are dropped (as feed of receiver drops data of client which does not keep up).
+// Bench mode runs fresh collector (dumpStats -M) for each rate step and follows number of messages it has read from
+// shared memory segment (updated after each batch), so end-to-end latency (message queued -> batch processed) is
+// measured without any change of processing. Step is lossless if no message was dropped and collector processed
+// all messages within GEN_DRAIN_MS after end of step. CPU time of collector (reader and processor) is taken from
+// rusage of finished child.
+
+#include "sbsGen.H"
+#include "liveStats.H"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+
+// Period of message production (microseconds)
+#define GEN_TICK_US 1000
+
+// Period of polling collector progress in bench mode (microseconds)
+#define GEN_POLL_US 50
+
+// Maximum bytes queued for client, messages beyond are dropped
+#define GEN_CLIENT_BUFFER (8 * 1024 * 1024)
+
+// Time for collector to process rest of messages after end of step (milliseconds)
+#define GEN_DRAIN_MS 1000
+
+// Time for collector to connect and create shared memory segment (milliseconds)
+#define GEN_START_MS 5000
+
+
+// Client connection with queue of messages
+typedef struct genClient
+{
+	int fd;
+	std::string queue;
+	size_t queuePos;			// bytes of queue sent already
+	uint64_t accepted;			// messages queued
+	uint64_t dropped;			// messages dropped because queue was full
+} tGenClient;
+
+
+// Messages queued at once, latency of chunk is time from queuing until collector read all of them
+typedef struct genChunk
+{
+	uint64_t queued;			// monotonic time in nanoseconds
+	uint64_t count;				// client messages accepted up to this chunk
+	uint64_t size;				// messages of chunk
+} tGenChunk;
+
+
+// Latency sample weighted by number of messages
+typedef struct genLatency
+{
+	uint64_t ns;
+	uint64_t weight;
+} tGenLatency;
+
+
+// Result of bench step
+typedef struct genStep
+{
+	double rate;
+	uint64_t sent;
+	uint64_t dropped;
+	uint64_t processed;
+	double p50;					// latency percentiles in milliseconds
+	double p90;
+	double p99;
+	double p999;
+	double max;
+	double collectorCpu;		// CPU seconds of collector
+	double generatorCpu;		// CPU seconds of generator
+	double duration;
+	bool lossless;
+} tGenStep;
+
+
+static volatile sig_atomic_t interrupted = 0;
+
+
+
+// Print help message
+void printHelp()
+{
+	printf("\nusage: dumpStatsGen [-n AIRCRAFT] [-r RATE[:RATE]] [-t SECONDS] [-x MIX] [-c RADIUS] [-p LAT] [-m LON] PORT\n");
+	printf("       dumpStatsGen -B DUMPSTATS [-n AIRCRAFT] [-r FROM:TO] [-S STEP] [-t SECONDS] [-x MIX] [-c RADIUS] [-p LAT] [-m LON] [-- COLLECTOR OPTIONS]\n\n");
+	printf("Serve mode serves synthetic SBS feed on TCP PORT (one client at a time), rate ramps linearly from first to second RATE\nover SECONDS and stays at second one.\n");
+	printf("Bench mode runs collector DUMPSTATS against generator at rates FROM, FROM+STEP, ... TO (each for SECONDS) until step\nis not lossless and reports maximum lossless rate, latency percentiles and CPU time per 1000 messages.\n\n");
+	printf("optional arguments:\n");
+	printf(" -n    number of aircraft (500 by default, 1 of %d taxis on airport at reference point)\n", GEN_SURFACE_RATIO);
+	printf(" -r    messages per second (10000 in serve mode, 100000:2000000 in bench mode by default)\n");
+	printf(" -t    duration of ramp in serve mode (0 by default), duration of step in bench mode (10 by default)\n");
+	printf(" -S    rate step of bench mode (FROM by default)\n");
+	printf(" -x    weights of message types MSG,1-8 (%s by default)\n", GEN_MIX_DEFAULT);
+	printf(" -c    radius of coverage around reference point in km (400 by default)\n");
+	printf(" -p    latitude of reference point (48.9966 by default)\n");
+	printf(" -m    longitude of reference point (2.5513 by default)\n\n");
+}
+
+
+
+// SIGINT handler
+void genSigint(int)
+{
+	interrupted = 1;
+}
+
+
+
+// Returns monotonic time in nanoseconds
+static uint64_t genNow()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+
+
+// Returns CPU time (user and system) of rusage in seconds
+static double genCpu(int who)
+{
+	struct rusage u;
+	getrusage(who, &u);
+	return u.ru_utime.tv_sec + u.ru_stime.tv_sec + (u.ru_utime.tv_usec + u.ru_stime.tv_usec) / 1e6;
+}
+
+
+
+/**
+ * Function starts listening on TCP port.
+ * @param loopback - listen on localhost only
+ * @param port - port, zero for any free port
+ * @return listening socket, negative if failed
+ */
+static int genListen(bool loopback, int port)
+{
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0)
+	{
+		fprintf(stderr, "ERROR: Unable to create socket!\n");
+		return -1;
+	}
+	
+	int on = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	
+	struct sockaddr_in sin;
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_port = htons(port);
+	sin.sin_addr.s_addr = htonl(loopback ? INADDR_LOOPBACK : INADDR_ANY);
+	if ((bind(fd, (struct sockaddr *) &sin, sizeof(sin)) < 0) || (listen(fd, 4) < 0))
+	{
+		fprintf(stderr, "ERROR: Unable to listen on port %d!\n", port);
+		close(fd);
+		return -1;
+	}
+	
+	return fd;
+}
+
+
+
+/**
+ * Function generates messages for client, messages which do not fit into its queue are dropped.
+ * @param gen - generator
+ * @param client - client
+ * @param count - number of messages
+ * @return number of queued messages
+ */
+static uint64_t genProduce(sbsGenerator &gen, tGenClient &client, uint64_t count)
+{
+	if (client.queue.size() - client.queuePos > GEN_CLIENT_BUFFER)
+	{
+		client.dropped += count;
+		return 0;
+	}
+	
+	gen.generate(count, client.queue);
+	client.accepted += count;
+	return count;
+}
+
+
+
+/**
+ * Function sends queued messages to client without blocking.
+ * @param client - client
+ * @return zero if success, nonzero if client disconnected
+ */
+static int genFlush(tGenClient &client)
+{
+	while (client.queuePos < client.queue.size())
+	{
+		ssize_t n = send(client.fd, client.queue.data() + client.queuePos, client.queue.size() - client.queuePos, MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+			{
+				break;
+			}
+			return 1;
+		}
+		client.queuePos += n;
+	}
+	
+	// sent part of queue is dropped once it grows large, so queue does not move on each partial send
+	if (client.queuePos == client.queue.size())
+	{
+		client.queue.clear();
+		client.queuePos = 0;
+	}
+	else if (client.queuePos > GEN_CLIENT_BUFFER)
+	{
+		client.queue.erase(0, client.queuePos);
+		client.queuePos = 0;
+	}
+	return 0;
+}
+
+
+
+/**
+ * Function returns number of messages due since start of ramp.
+ * @param from - rate at start of ramp
+ * @param to - rate at end of ramp
+ * @param ramp - duration of ramp in seconds
+ * @param t - seconds since start
+ * @return number of messages
+ */
+static double genDue(double from, double to, double ramp, double t)
+{
+	if (t < ramp)
+	{
+		return from * t + (to - from) * t * t / (2 * ramp);
+	}
+	return (from + to) * ramp / 2 + to * (t - ramp);
+}
+
+
+
+/**
+ * Function serves synthetic feed to clients connecting to port until interrupted.
+ * @param gen - generator
+ * @param port - TCP port
+ * @param from - rate at start of ramp
+ * @param to - rate at end of ramp
+ * @param ramp - duration of ramp in seconds
+ * @return zero if success, nonzero otherwise
+ */
+static int genServe(sbsGenerator &gen, int port, double from, double to, double ramp)
+{
+	int listenFd = genListen(false, port);
+	if (listenFd < 0)
+	{
+		return 1;
+	}
+	
+	uint64_t start = genNow();
+	while (! interrupted)
+	{
+		printf("Waiting for client on port %d..\n", port);
+		int fd = accept(listenFd, NULL, NULL);
+		if (fd < 0)
+		{
+			continue;
+		}
+		
+		tGenClient client;
+		client.fd = fd;
+		client.queuePos = 0;
+		client.accepted = 0;
+		client.dropped = 0;
+		
+		uint64_t connected = genNow();
+		uint64_t tick = connected;
+		uint64_t produced = 0;
+		uint64_t lastReport = 0;
+		while (! interrupted)
+		{
+			uint64_t now = genNow();
+			double t = (now - connected) / 1e9;
+			
+			struct timespec wall;
+			clock_gettime(CLOCK_REALTIME, &wall);
+			gen.setTime((now - start) / 1e9, wall);
+			
+			uint64_t due = genDue(from, to, ramp, t);
+			genProduce(gen, client, due - produced);
+			produced = due;
+			if (genFlush(client) != 0)
+			{
+				break;
+			}
+			
+			if ((uint64_t) t > lastReport)
+			{
+				lastReport = t;
+				double rate = (t < ramp) ? from + (to - from) * t / ramp : to;
+				printf("%6lu s  rate %9.0f msg/s  sent %12lu  dropped %12lu\n", (unsigned long) lastReport, rate,
+					(unsigned long) client.accepted, (unsigned long) client.dropped);
+				fflush(stdout);
+			}
+			
+			tick = connected + ((now - connected) / (GEN_TICK_US * 1000ull) + 1) * GEN_TICK_US * 1000ull;
+			now = genNow();
+			if (tick > now)
+			{
+				usleep((tick - now) / 1000);
+			}
+		}
+		close(fd);
+		
+		printf("Client disconnected: %lu messages sent, %lu dropped (%.0f s).\n", (unsigned long) client.accepted,
+			(unsigned long) client.dropped, (genNow() - connected) / 1e9);
+	}
+	
+	close(listenFd);
+	return 0;
+}
+
+
+
+/**
+ * Function returns latency percentile of samples sorted by latency.
+ * @param samples - sorted samples
+ * @param total - sum of weights
+ * @param q - percentile (0-1)
+ * @return latency in milliseconds
+ */
+static double genPercentile(const std::vector<tGenLatency> &samples, uint64_t total, double q)
+{
+	uint64_t limit = (uint64_t) (q * total);
+	uint64_t sum = 0;
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		sum += samples[i].weight;
+		if (sum > limit)
+		{
+			return samples[i].ns / 1e6;
+		}
+	}
+	return samples.empty() ? 0 : samples.back().ns / 1e6;
+}
+
+
+
+/**
+ * Function runs one bench step - starts collector, loads it by constant rate and measures it.
+ * @param gen - generator
+ * @param collector - path of dumpStats
+ * @param options - additional options of collector
+ * @param lat - reference latitude
+ * @param lon - reference longitude
+ * @param rate - messages per second
+ * @param seconds - duration of step
+ * @param start - monotonic start time of generator
+ * @param step - result
+ * @return zero if success, nonzero if collector could not be run
+ */
+static int genBenchStep(sbsGenerator &gen, const char *collector, const std::vector<std::string> &options, double lat, double lon,
+	double rate, double seconds, uint64_t start, tGenStep &step)
+{
+	int listenFd = genListen(true, 0);
+	if (listenFd < 0)
+	{
+		return 1;
+	}
+	struct sockaddr_in sin;
+	socklen_t sinLen = sizeof(sin);
+	getsockname(listenFd, (struct sockaddr *) &sin, &sinLen);
+	
+	char port[16], latText[32], lonText[32], shmName[64], dataPath[64];
+	snprintf(port, sizeof(port), "%d", ntohs(sin.sin_port));
+	snprintf(latText, sizeof(latText), "%f", lat);
+	snprintf(lonText, sizeof(lonText), "%f", lon);
+	snprintf(shmName, sizeof(shmName), "dumpStatsGen-%ld", (long) getpid());
+	snprintf(dataPath, sizeof(dataPath), "/tmp/dumpStatsGen-%ld.out", (long) getpid());
+	
+	std::vector<std::string> args = {collector, "-p", latText, "-m", lonText, "-f", dataPath, "-M", shmName};
+	args.insert(args.end(), options.begin(), options.end());
+	args.push_back("127.0.0.1");
+	args.push_back(port);
+	
+	double cpuBefore = genCpu(RUSAGE_CHILDREN);
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		// messages of collector (feed closed, ...) would interleave with results
+		int null = open("/dev/null", O_WRONLY);
+		dup2(null, STDOUT_FILENO);
+		dup2(null, STDERR_FILENO);
+		close(listenFd);
+		
+		std::vector<char *> argv;
+		for (size_t i = 0; i < args.size(); i++)
+		{
+			argv.push_back((char *) args[i].c_str());
+		}
+		argv.push_back(NULL);
+		execv(collector, argv.data());
+		_exit(127);
+	}
+	
+	// collector connects, then its processor creates segment
+	struct pollfd pfd;
+	pfd.fd = listenFd;
+	pfd.events = POLLIN;
+	int fd = (poll(&pfd, 1, GEN_START_MS) == 1) ? accept(listenFd, NULL, NULL) : -1;
+	close(listenFd);
+	
+	tLiveReader reader;
+	reader.seg = NULL;
+	uint64_t waitStart = genNow();
+	while ((fd >= 0) && (liveOpen(shmName, reader, true) != 0) && (genNow() - waitStart < GEN_START_MS * 1000000ull))
+	{
+		usleep(1000);
+	}
+	if ((fd < 0) || (reader.seg == NULL))
+	{
+		fprintf(stderr, "ERROR: Collector %s did not start!\n", collector);
+		if (fd >= 0)
+		{
+			close(fd);
+		}
+		kill(pid, SIGINT);
+		waitpid(pid, NULL, 0);
+		return 1;
+	}
+	
+	tGenClient client;
+	client.fd = fd;
+	client.queuePos = 0;
+	client.accepted = 0;
+	client.dropped = 0;
+	
+	std::deque<tGenChunk> chunks;
+	std::vector<tGenLatency> samples;
+	uint64_t produced = 0;
+	uint64_t processed = 0;
+	
+	double generatorBefore = genCpu(RUSAGE_SELF);
+	uint64_t begin = genNow();
+	uint64_t tick = begin;
+	uint64_t end = begin + (uint64_t) (seconds * 1e9);
+	bool producing = true;
+	bool failed = false;
+	while (! interrupted)
+	{
+		uint64_t now = genNow();
+		if (producing && (now >= tick))
+		{
+			if (now >= end)
+			{
+				producing = false;
+			}
+			else
+			{
+				struct timespec wall;
+				clock_gettime(CLOCK_REALTIME, &wall);
+				gen.setTime((now - start) / 1e9, wall);
+				
+				uint64_t due = rate * (now - begin) / 1e9;
+				uint64_t queued = genProduce(gen, client, due - produced);
+				produced = due;
+				if (queued > 0)
+				{
+					tGenChunk c;
+					c.queued = now;
+					c.count = client.accepted;
+					c.size = queued;
+					chunks.push_back(c);
+				}
+				tick = begin + ((now - begin) / (GEN_TICK_US * 1000ull) + 1) * GEN_TICK_US * 1000ull;
+			}
+		}
+		
+		if (genFlush(client) != 0)
+		{
+			failed = true;
+			break;
+		}
+		
+		processed = liveMessages(reader);
+		now = genNow();
+		while ((! chunks.empty()) && (chunks.front().count <= processed))
+		{
+			tGenLatency l;
+			l.ns = now - chunks.front().queued;
+			l.weight = chunks.front().size;
+			samples.push_back(l);
+			chunks.pop_front();
+		}
+		
+		if ((! producing) && ((processed >= client.accepted) || (now > end + GEN_DRAIN_MS * 1000000ull)))
+		{
+			break;
+		}
+		usleep(GEN_POLL_US);
+	}
+	step.duration = (genNow() - begin) / 1e9;
+	step.generatorCpu = genCpu(RUSAGE_SELF) - generatorBefore;
+	
+	// collector ends when feed is closed (processor drains pipe first)
+	close(fd);
+	liveClose(reader);
+	waitpid(pid, NULL, 0);
+	unlink(dataPath);
+	
+	step.rate = rate;
+	step.sent = client.accepted;
+	step.dropped = client.dropped;
+	step.processed = processed;
+	step.collectorCpu = genCpu(RUSAGE_CHILDREN) - cpuBefore;
+	step.lossless = (! failed) && (! interrupted) && (client.dropped == 0) && (processed >= client.accepted);
+	
+	std::sort(samples.begin(), samples.end(), [](const tGenLatency &a, const tGenLatency &b) { return a.ns < b.ns; });
+	uint64_t total = 0;
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		total += samples[i].weight;
+	}
+	step.p50 = genPercentile(samples, total, 0.5);
+	step.p90 = genPercentile(samples, total, 0.9);
+	step.p99 = genPercentile(samples, total, 0.99);
+	step.p999 = genPercentile(samples, total, 0.999);
+	step.max = samples.empty() ? 0 : samples.back().ns / 1e6;
+	
+	return 0;
+}
+
+
+
+/**
+ * Function runs bench steps from lowest rate until step is not lossless and reports results.
+ * @param gen - generator
+ * @param collector - path of dumpStats
+ * @param options - additional options of collector
+ * @param lat - reference latitude
+ * @param lon - reference longitude
+ * @param from - rate of first step
+ * @param to - rate of last step
+ * @param stepRate - rate increment
+ * @param seconds - duration of step
+ * @return zero if success, nonzero otherwise
+ */
+static int genBench(sbsGenerator &gen, const char *collector, const std::vector<std::string> &options, double lat, double lon,
+	double from, double to, double stepRate, double seconds)
+{
+	uint64_t start = genNow();
+	
+	printf("%10s %12s %10s %9s %9s %9s %9s %9s %13s %13s %13s  %s\n", "rate/s", "sent", "dropped", "p50 ms", "p90 ms", "p99 ms",
+		"p99.9 ms", "max ms", "collector %", "ms/1k msgs", "generator %", "result");
+	
+	tGenStep best = {};
+	tGenStep last = {};
+	bool found = false;
+	bool ran = false;
+	for (double rate = from; (rate <= to) && (! interrupted); rate += stepRate)
+	{
+		tGenStep step = {};
+		if (genBenchStep(gen, collector, options, lat, lon, rate, seconds, start, step) != 0)
+		{
+			return 1;
+		}
+		
+		printf("%10.0f %12lu %10lu %9.3f %9.3f %9.3f %9.3f %9.3f %13.1f %13.3f %13.1f  %s\n", step.rate, (unsigned long) step.sent,
+			(unsigned long) step.dropped, step.p50, step.p90, step.p99, step.p999, step.max, 100 * step.collectorCpu / step.duration,
+			(step.sent > 0) ? 1000 * step.collectorCpu / (step.sent / 1000.0) : 0.0, 100 * step.generatorCpu / step.duration,
+			step.lossless ? "lossless" : "LOSS");
+		fflush(stdout);
+		
+		last = step;
+		ran = true;
+		if (! step.lossless)
+		{
+			break;
+		}
+		best = step;
+		found = true;
+	}
+	
+	if (found)
+	{
+		printf("\nMaximum lossless rate: %.0f msg/s (latency p50 %.3f ms, p99 %.3f ms, max %.3f ms; collector CPU %.3f ms per 1000 messages)\n",
+			best.rate, best.p50, best.p99, best.max, 1000 * best.collectorCpu / (best.sent / 1000.0));
+	}
+	else
+	{
+		printf("\nNo lossless step, lower starting rate.\n");
+	}
+	
+	// collector competes with generator for CPUs of machine
+	if (ran && (last.generatorCpu > 0.9 * last.duration))
+	{
+		printf("Generator used whole CPU core at rate %.0f msg/s, rates are limited by generator.\n", last.rate);
+	}
+	else if (ran && (last.collectorCpu + last.generatorCpu > 0.9 * last.duration * sysconf(_SC_NPROCESSORS_ONLN)))
+	{
+		printf("Generator and collector used all CPUs at rate %.0f msg/s, rates are limited by machine.\n", last.rate);
+	}
+	return 0;
+}
+
+
+
+int main(int argc, char **argv)
+{
+	unsigned count = 500;
+	double from = 0;
+	double to = 0;
+	double seconds = -1;
+	double stepRate = 0;
+	double radius = 400;
+	double lat = 48.9966;
+	double lon = 2.5513;
+	const char *mixText = GEN_MIX_DEFAULT;
+	const char *collector = NULL;
+	
+	int c;
+	while ((c = getopt(argc, argv, "hn:r:t:S:x:c:p:m:B:")) != -1)
+	{
+		switch (c)
+		{
+			case 'n':
+				count = atoi(optarg);
+				break;
+			
+			case 'r':
+				from = atof(optarg);
+				to = (strchr(optarg, ':') != NULL) ? atof(strchr(optarg, ':') + 1) : from;
+				break;
+			
+			case 't':
+				seconds = atof(optarg);
+				break;
+			
+			case 'S':
+				stepRate = atof(optarg);
+				break;
+			
+			case 'x':
+				mixText = optarg;
+				break;
+			
+			case 'c':
+				radius = atof(optarg);
+				break;
+			
+			case 'p':
+				lat = atof(optarg);
+				break;
+			
+			case 'm':
+				lon = atof(optarg);
+				break;
+			
+			case 'B':
+				collector = optarg;
+				break;
+			
+			default:
+				printHelp();
+				return 1;
+		}
+	}
+	
+	unsigned mix[GEN_TYPES];
+	if (sbsGenerator::parseMix(mixText, mix) != 0)
+	{
+		fprintf(stderr, "ERROR: Invalid message mix %s!\n", mixText);
+		return 1;
+	}
+	if ((count < 2) || (radius <= 0) || (from < 0) || (to < from))
+	{
+		fprintf(stderr, "ERROR: Invalid number of aircraft, radius or rate!\n");
+		return 1;
+	}
+	
+	struct sigaction sa;
+	sa.sa_handler = genSigint;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = 0;
+	sigaction(SIGINT, &sa, NULL);
+	
+	sbsGenerator gen(lat, lon, radius, count, mix, 1);
+	
+	if (collector != NULL)
+	{
+		if (to == 0)
+		{
+			from = 100000;
+			to = 2000000;
+		}
+		if (stepRate <= 0)
+		{
+			stepRate = (from > 0) ? from : to;
+		}
+		std::vector<std::string> options(argv + optind, argv + argc);
+		return genBench(gen, collector, options, lat, lon, from, to, stepRate, (seconds > 0) ? seconds : 10);
+	}
+	
+	if (optind != argc - 1)
+	{
+		printHelp();
+		return 1;
+	}
+	if (to == 0)
+	{
+		from = to = 10000;
+	}
+	return genServe(gen, atoi(argv[optind]), from, to, (seconds > 0) ? seconds : 0);
+}
@@ -0,0 +1,758 @@
+/* DumpStats - dump1090 feed statistical data collector
+ * Copyright (C) 2015 Marcel Kebisek
+ * Contact: marcel.kebisek@gmail.com
+ * 
+ * This file is part of DumpStats.
+ * 
+ * DumpStats is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * DumpStats is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with DumpStats. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "objects.H"
+#include "modeS.H"
+
+
+// Latitudes at which number of longitude zones (NL) decreases from 59 to 58, ..., 2 to 1
+static const double cprZoneLat[58] =
+{
+	10.47047130, 14.82817437, 18.18626357, 21.02939493, 23.54504487, 25.82924707, 27.93898710, 29.91135686,
+	31.77209708, 33.53993436, 35.22899598, 36.85025108, 38.41241892, 39.92256684, 41.38651832, 42.80914012,
+	44.19454951, 45.54626723, 46.86733252, 48.16039128, 49.42776439, 50.67150166, 51.89342469, 53.09516153,
+	54.27817472, 55.44378444, 56.59318756, 57.72747354, 58.84763776, 59.95459277, 61.04917774, 62.13216659,
+	63.20427479, 64.26616523, 65.31845310, 66.36171008, 67.39646774, 68.42322022, 69.44242631, 70.45451075,
+	71.45986473, 72.45884545, 73.45177442, 74.43893416, 75.42056257, 76.39684391, 77.36789461, 78.33374083,
+	79.29428225, 80.24923213, 81.19801349, 82.13956981, 83.07199445, 83.99173563, 84.89166191, 85.75541621,
+	86.53536998, 87.00000000
+};
+
+// Characters of callsign (6-bit code)
+static const char callsignChars[] = "?ABCDEFGHIJKLMNOPQRSTUVWXYZ????? ???????????????0123456789??????";
+
+
+
+/**
+ * Function returns number of longitude zones of CPR at latitude.
+ * @param lat - latitude in degrees
+ * @return NL (1-59)
+ */
+static int cprNL(double lat)
+{
+	return 59 - (std::lower_bound(cprZoneLat, cprZoneLat + 58, std::fabs(lat)) - cprZoneLat);
+}
+
+
+
+/**
+ * Function returns non-negative remainder of division.
+ */
+static int cprMod(int a, int b)
+{
+	int r = a % b;
+	return (r < 0) ? r + b : r;
+}
+
+static double cprMod(double a, double b)
+{
+	double r = std::fmod(a, b);
+	return (r < 0) ? r + b : r;
+}
+
+
+
+/**
+ * Function decodes airborne position globally from even and odd CPR frame.
+ * @param cprLat - latitudes of even and odd frame (17 bits)
+ * @param cprLon - longitudes of even and odd frame (17 bits)
+ * @param odd - 1 if odd frame is the newer one (position belongs to it), 0 otherwise
+ * @param lat - decoded latitude in degrees
+ * @param lon - decoded longitude in degrees
+ * @return false if frames lie in different longitude zones (pair cannot be decoded)
+ */
+static bool cprGlobal(const uint32_t *cprLat, const uint32_t *cprLon, int odd, double &lat, double &lon)
+{
+	double lat0 = cprLat[0] / 131072.0;
+	double lat1 = cprLat[1] / 131072.0;
+	double lon0 = cprLon[0] / 131072.0;
+	double lon1 = cprLon[1] / 131072.0;
+	
+	int j = (int) std::floor(59 * lat0 - 60 * lat1 + 0.5);
+	double rLat0 = (360.0 / 60) * (cprMod(j, 60) + lat0);
+	double rLat1 = (360.0 / 59) * (cprMod(j, 59) + lat1);
+	if (rLat0 >= 270)
+	{
+		rLat0 -= 360;
+	}
+	if (rLat1 >= 270)
+	{
+		rLat1 -= 360;
+	}
+	if ((rLat0 < -90) || (rLat0 > 90) || (rLat1 < -90) || (rLat1 > 90) || (cprNL(rLat0) != cprNL(rLat1)))
+	{
+		return false;
+	}
+	
+	lat = odd ? rLat1 : rLat0;
+	int nl = cprNL(lat);
+	int ni = std::max(nl - odd, 1);
+	int m = (int) std::floor(lon0 * (nl - 1) - lon1 * nl + 0.5);
+	lon = (360.0 / ni) * (cprMod(m, ni) + (odd ? lon1 : lon0));
+	if (lon >= 180)
+	{
+		lon -= 360;
+	}
+	return true;
+}
+
+
+
+/**
+ * Function decodes position locally relative to reference position, which must lie within half of zone.
+ * @param cprLat - latitude of frame (17 bits)
+ * @param cprLon - longitude of frame (17 bits)
+ * @param odd - 1 for odd frame, 0 for even frame
+ * @param surface - true for surface position (zones are quarter of airborne ones)
+ * @param refLat - reference latitude in degrees
+ * @param refLon - reference longitude in degrees
+ * @param lat - decoded latitude in degrees
+ * @param lon - decoded longitude in degrees
+ */
+static void cprLocal(uint32_t cprLat, uint32_t cprLon, int odd, bool surface, double refLat, double refLon, double &lat, double &lon)
+{
+	double span = surface ? 90.0 : 360.0;
+	double fLat = cprLat / 131072.0;
+	double fLon = cprLon / 131072.0;
+	
+	double dLat = span / (60 - odd);
+	int j = (int) std::floor(refLat / dLat) + (int) std::floor(0.5 + cprMod(refLat, dLat) / dLat - fLat);
+	lat = dLat * (j + fLat);
+	
+	double dLon = span / std::max(cprNL(lat) - odd, 1);
+	int m = (int) std::floor(refLon / dLon) + (int) std::floor(0.5 + cprMod(refLon, dLon) / dLon - fLon);
+	lon = dLon * (m + fLon);
+}
+
+
+
+/**
+ * Function decodes 13-bit altitude field (AC13 of DF0/4/16/20, AC12 of extended squitter with M bit inserted).
+ * @param ac13 - altitude field
+ * @param altitude - altitude in feet
+ * @return false if altitude is not available, metric or invalid
+ */
+static bool decodeAC13(uint32_t ac13, long &altitude)
+{
+	if ((ac13 == 0) || (ac13 & 0x0040))
+	{
+		return false;
+	}
+	
+	// Q bit - 25 ft increments
+	if (ac13 & 0x0010)
+	{
+		long n = ((ac13 & 0x1F80) >> 2) | ((ac13 & 0x0020) >> 1) | (ac13 & 0x000F);
+		altitude = n * 25 - 1000;
+		return true;
+	}
+	
+	// Gillham code - reorder bits C1 A1 C2 A2 C4 A4 (M) B1 (Q) B2 D2 B4 D4 into A B C D digits of Mode A code
+	uint32_t gillham = 0;
+	if (ac13 & 0x1000) gillham |= 0x0010;	// C1
+	if (ac13 & 0x0800) gillham |= 0x1000;	// A1
+	if (ac13 & 0x0400) gillham |= 0x0020;	// C2
+	if (ac13 & 0x0200) gillham |= 0x2000;	// A2
+	if (ac13 & 0x0100) gillham |= 0x0040;	// C4
+	if (ac13 & 0x0080) gillham |= 0x4000;	// A4
+	if (ac13 & 0x0020) gillham |= 0x0100;	// B1
+	if (ac13 & 0x0008) gillham |= 0x0200;	// B2
+	if (ac13 & 0x0004) gillham |= 0x0002;	// D2
+	if (ac13 & 0x0002) gillham |= 0x0400;	// B4
+	if (ac13 & 0x0001) gillham |= 0x0004;	// D4
+	
+	// C bits give hundreds (1-5, reflected), D A B bits give five hundreds (Gray code)
+	if ((gillham & 0x0070) == 0)
+	{
+		return false;
+	}
+	
+	int hundreds = 0;
+	if (gillham & 0x0010) hundreds ^= 7;
+	if (gillham & 0x0020) hundreds ^= 3;
+	if (gillham & 0x0040) hundreds ^= 1;
+	if ((hundreds & 5) == 5)
+	{
+		hundreds ^= 2;
+	}
+	if (hundreds > 5)
+	{
+		return false;
+	}
+	
+	int fiveHundreds = 0;
+	if (gillham & 0x0002) fiveHundreds ^= 0xFF;
+	if (gillham & 0x0004) fiveHundreds ^= 0x7F;
+	if (gillham & 0x1000) fiveHundreds ^= 0x3F;
+	if (gillham & 0x2000) fiveHundreds ^= 0x1F;
+	if (gillham & 0x4000) fiveHundreds ^= 0x0F;
+	if (gillham & 0x0100) fiveHundreds ^= 0x07;
+	if (gillham & 0x0200) fiveHundreds ^= 0x03;
+	if (gillham & 0x0400) fiveHundreds ^= 0x01;
+	if (fiveHundreds & 1)
+	{
+		hundreds = 6 - hundreds;
+	}
+	
+	altitude = (fiveHundreds * 5 + hundreds - 13) * 100L;
+	return true;
+}
+
+
+
+/**
+ * Function converts hexadecimal digit into its value.
+ * @return value of digit, -1 if character is not hexadecimal digit
+ */
+static int hexDigit(char c)
+{
+	if ((c >= '0') && (c <= '9'))
+	{
+		return c - '0';
+	}
+	if ((c >= 'A') && (c <= 'F'))
+	{
+		return c - 'A' + 10;
+	}
+	if ((c >= 'a') && (c <= 'f'))
+	{
+		return c - 'a' + 10;
+	}
+	return -1;
+}
+
+
+
+/**
+ * Function splits Beast binary stream into Mode S replies. Frame starts by 0x1A and type ('1' Mode A/C, '2' short,
+ * '3' long reply), 6 bytes of timestamp, signal level and reply follow, 0x1A inside frame is doubled.
+ * Mode A/C and unknown frames are skipped, stream is resynchronized on next 0x1A after broken frame.
+ * @param buf - buffer of received bytes
+ * @param len - number of bytes in buffer
+ * @param frames - vector to append replies to
+ * @return number of consumed bytes
+ */
+size_t frameBeast(const char *buf, size_t len, std::vector<tModeSFrame> &frames)
+{
+	const uint8_t *p = (const uint8_t *) buf;
+	size_t start = 0;
+	
+	while (start < len)
+	{
+		if (p[start] != 0x1A)
+		{
+			const void *next = memchr(p + start, 0x1A, len - start);
+			start = (next != NULL) ? (const uint8_t *) next - p : len;
+			continue;
+		}
+		if (start + 1 >= len)
+		{
+			break;
+		}
+		
+		size_t payload;
+		switch (p[start + 1])
+		{
+			case '1': payload = 2; break;
+			case '2': payload = MODES_SHORT; break;
+			case '3': payload = MODES_LONG; break;
+			default: payload = 0; break;
+		}
+		if (payload == 0)
+		{
+			start++;
+			continue;
+		}
+		
+		// unescape timestamp, signal level and reply
+		uint8_t body[7 + MODES_LONG];
+		size_t need = 7 + payload;
+		size_t got = 0;
+		size_t i = start + 2;
+		bool broken = false;
+		while ((got < need) && (i < len))
+		{
+			if (p[i] == 0x1A)
+			{
+				if (i + 1 >= len)
+				{
+					break;
+				}
+				if (p[i + 1] != 0x1A)
+				{
+					broken = true;
+					break;
+				}
+				i++;
+			}
+			body[got++] = p[i++];
+		}
+		
+		if (broken)
+		{
+			start = i;
+			continue;
+		}
+		if (got < need)
+		{
+			break;
+		}
+		
+		if (payload != 2)
+		{
+			tModeSFrame f;
+			f.len = payload;
+			memcpy(f.msg, body + 7, payload);
+			frames.push_back(f);
+		}
+		start = i;
+	}
+	
+	return start;
+}
+
+
+
+/**
+ * Function splits AVR text stream into Mode S replies. Line holds reply in hexadecimal digits between '*' and ';',
+ * or between '@' with 12 digits of timestamp and ';'. Other lines and Mode A/C replies are skipped.
+ * @param buf - buffer of received bytes
+ * @param len - number of bytes in buffer
+ * @param frames - vector to append replies to
+ * @return number of consumed bytes
+ */
+size_t frameAvr(const char *buf, size_t len, std::vector<tModeSFrame> &frames)
+{
+	size_t start = 0;
+	const char *nl;
+	
+	while ((nl = (const char *) memchr(buf + start, '\n', len - start)) != NULL)
+	{
+		const char *p = buf + start;
+		const char *end = nl;
+		start = (nl - buf) + 1;
+		
+		if ((end > p) && (*p == '@'))
+		{
+			p += 13;
+		}
+		else if ((end > p) && (*p == '*'))
+		{
+			p++;
+		}
+		else
+		{
+			continue;
+		}
+		
+		const char *semicolon = (p < end) ? (const char *) memchr(p, ';', end - p) : NULL;
+		if ((semicolon == NULL) || ((semicolon - p != 2 * MODES_SHORT) && (semicolon - p != 2 * MODES_LONG)))
+		{
+			continue;
+		}
+		
+		tModeSFrame f;
+		f.len = (semicolon - p) / 2;
+		bool valid = true;
+		for (int i = 0; i < f.len; i++)
+		{
+			int hi = hexDigit(p[2 * i]);
+			int lo = hexDigit(p[2 * i + 1]);
+			if ((hi < 0) || (lo < 0))
+			{
+				valid = false;
+				break;
+			}
+			f.msg[i] = (hi << 4) | lo;
+		}
+		if (valid)
+		{
+			frames.push_back(f);
+		}
+	}
+	
+	return start;
+}
+
+
+
+/**
+ * Constructor.
+ * @param lat - latitude of receiver in degrees
+ * @param lon - longitude of receiver in degrees
+ */
+modeSDecoder::modeSDecoder(double lat, double lon)
+{
+	refLat = lat;
+	refLon = lon;
+	memset(&counters, 0, sizeof(counters));
+	
+	tModeSState empty;
+	memset(&empty, 0, sizeof(empty));
+	slots.assign(MODES_SLOTS, empty);
+	
+	// CRC-24 of Mode S, generator polynomial 0x1FFF409
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		uint32_t c = i << 16;
+		for (int j = 0; j < 8; j++)
+		{
+			c = (c & 0x800000) ? (c << 1) ^ 0xFFF409 : (c << 1);
+		}
+		crcTable[i] = c & 0xFFFFFF;
+	}
+	
+	memset(hexText, 0, sizeof(hexText));
+	memset(callsignText, 0, sizeof(callsignText));
+}
+
+
+
+/**
+ * Function computes CRC of reply and XORs it with its parity field.
+ * @param f - reply
+ * @return zero if parity matches, otherwise address (overlaid on parity) or error syndrome
+ */
+uint32_t modeSDecoder::crcResidual(const tModeSFrame &f) const
+{
+	uint32_t crc = 0;
+	for (int i = 0; i < f.len - 3; i++)
+	{
+		crc = ((crc << 8) ^ crcTable[((crc >> 16) ^ f.msg[i]) & 0xFF]) & 0xFFFFFF;
+	}
+	return crc ^ ((f.msg[f.len - 3] << 16) | (f.msg[f.len - 2] << 8) | f.msg[f.len - 1]);
+}
+
+
+
+/**
+ * Function returns state of aircraft. New aircraft takes first free slot of its probe window, or replaces least
+ * recently heard aircraft of window.
+ * @param icao - ICAO address
+ * @param create - take slot for aircraft if it is not in table
+ * @return state of aircraft, NULL if it is not in table and create is false
+ */
+tModeSState *modeSDecoder::state(uint32_t icao, bool create)
+{
+	size_t home = ((icao * 0x9E3779B1u) >> 8) & (MODES_SLOTS - 1);
+	tModeSState *victim = NULL;
+	for (size_t i = 0; i < MODES_PROBE; i++)
+	{
+		tModeSState &s = slots[(home + i) & (MODES_SLOTS - 1)];
+		if (s.key == (icao | MODES_USED))
+		{
+			return &s;
+		}
+		if ((victim == NULL) || ((victim->key != 0) && ((s.key == 0) || (s.lastSeen < victim->lastSeen))))
+		{
+			victim = &s;
+		}
+	}
+	if (! create)
+	{
+		return NULL;
+	}
+	
+	memset(victim, 0, sizeof(*victim));
+	victim->key = icao | MODES_USED;
+	return victim;
+}
+
+
+
+/**
+ * Function decodes CPR position of frame into record. Airborne position is decoded locally relative to recent
+ * position of aircraft, or globally from pair of even and odd frame. Surface position is decoded locally relative
+ * to recent position of aircraft or to receiver.
+ * @param msg - extended squitter
+ * @param surface - true for surface position frame
+ * @param s - state of aircraft
+ * @param now - current time
+ * @param r - record (position is set if decoded)
+ */
+void modeSDecoder::decodePosition(const uint8_t *msg, bool surface, tModeSState *s, uint32_t now, tSbsRecord &r)
+{
+	int odd = (msg[6] >> 2) & 1;
+	uint32_t cprLat = ((msg[6] & 0x03) << 15) | (msg[7] << 7) | (msg[8] >> 1);
+	uint32_t cprLon = ((msg[8] & 0x01) << 16) | (msg[9] << 8) | msg[10];
+	
+	bool recent = (s->posTime != 0) && (now - s->posTime <= MODES_CPR_LOCAL);
+	bool decoded = false;
+	bool global = false;
+	double lat, lon;
+	
+	if (surface)
+	{
+		cprLocal(cprLat, cprLon, odd, true, recent ? fixedToDegrees(s->lat) : refLat, recent ? fixedToDegrees(s->lon) : refLon, lat, lon);
+		decoded = true;
+	}
+	else
+	{
+		s->cprLat[odd] = cprLat;
+		s->cprLon[odd] = cprLon;
+		s->cprTime[odd] = now;
+		
+		if (recent)
+		{
+			cprLocal(cprLat, cprLon, odd, false, fixedToDegrees(s->lat), fixedToDegrees(s->lon), lat, lon);
+			decoded = true;
+		}
+		else if ((s->cprTime[1 - odd] != 0) && (now - s->cprTime[1 - odd] <= MODES_CPR_PAIR))
+		{
+			decoded = cprGlobal(s->cprLat, s->cprLon, odd, lat, lon);
+			global = true;
+		}
+	}
+	
+	tCoords pos;
+	if (decoded)
+	{
+		tCoords ref;
+		ref.lat = refLat;
+		ref.lon = refLon;
+		pos.lat = lat;
+		pos.lon = lon;
+		decoded = (lat >= -90) && (lat <= 90) && (getDistance(ref, pos) <= MODES_MAX_RANGE);
+	}
+	if (! decoded)
+	{
+		counters.noPosition++;
+		return;
+	}
+	
+	if (global)
+	{
+		counters.globalCpr++;
+	}
+	else
+	{
+		counters.localCpr++;
+	}
+	
+	tFixedCoords fixed = coordsToFixed(pos);
+	s->lat = fixed.lat;
+	s->lon = fixed.lon;
+	s->posTime = now;
+	r.hasPosition = true;
+	r.lat = fixed.lat;
+	r.lon = fixed.lon;
+}
+
+
+
+/**
+ * Function decodes extended squitter (DF17/18) of aircraft into record.
+ * @param msg - extended squitter (14 bytes)
+ * @param s - state of aircraft
+ * @param now - current time
+ * @param r - record with address filled
+ * @return false if type of squitter is not consumed
+ */
+bool modeSDecoder::decodeExtended(const uint8_t *msg, tModeSState *s, uint32_t now, tSbsRecord &r)
+{
+	int tc = msg[4] >> 3;
+	
+	if ((tc >= 1) && (tc <= 4))
+	{
+		// identification - 8 characters of 6 bits, trailing spaces are trimmed as in SBS output
+		uint64_t chars = ((uint64_t) msg[5] << 40) | ((uint64_t) msg[6] << 32) | ((uint64_t) msg[7] << 24) | ((uint64_t) msg[8] << 16) | (msg[9] << 8) | msg[10];
+		int n = 0;
+		for (int i = 0; i < 8; i++)
+		{
+			callsignText[i] = callsignChars[(chars >> (42 - 6 * i)) & 0x3F];
+			if (callsignText[i] != ' ')
+			{
+				n = i + 1;
+			}
+		}
+		r.type = 1;
+		r.field[SBS_FIELD_CALLSIGN].ptr = callsignText;
+		r.field[SBS_FIELD_CALLSIGN].len = n;
+		return true;
+	}
+	
+	if ((tc >= 5) && (tc <= 8))
+	{
+		r.type = 2;
+		decodePosition(msg, true, s, now, r);
+		return true;
+	}
+	
+	if (((tc >= 9) && (tc <= 18)) || ((tc >= 20) && (tc <= 22)))
+	{
+		// altitude field AC12 has no M bit
+		uint32_t ac12 = (msg[5] << 4) | (msg[6] >> 4);
+		r.type = 3;
+		r.hasAltitude = decodeAC13(((ac12 & 0x0FC0) << 1) | (ac12 & 0x003F), r.altitude);
+		decodePosition(msg, false, s, now, r);
+		return true;
+	}
+	
+	if (tc == 19)
+	{
+		// ground speed (subtypes 1, 2 - supersonic in 4 kt units) from east-west and north-south components
+		int subtype = msg[4] & 0x07;
+		if ((subtype == 1) || (subtype == 2))
+		{
+			int ew = ((msg[5] & 0x03) << 8) | msg[6];
+			int ns = ((msg[7] & 0x7F) << 3) | (msg[8] >> 5);
+			if ((ew != 0) && (ns != 0))
+			{
+				int scale = (subtype == 2) ? 4 : 1;
+				double vEW = (ew - 1) * scale;
+				double vNS = (ns - 1) * scale;
+				r.hasSpeed = true;
+				r.speed = std::lround(std::sqrt(vEW * vEW + vNS * vNS));
+			}
+		}
+		
+		// vertical rate in 64 ft/min units
+		int vr = ((msg[8] & 0x07) << 6) | (msg[9] >> 2);
+		if ((subtype >= 1) && (subtype <= 4) && (vr != 0))
+		{
+			r.hasVerticalRate = true;
+			r.verticalRate = ((msg[8] & 0x08) ? -64L : 64L) * (vr - 1);
+		}
+		r.type = 4;
+		return true;
+	}
+	
+	return false;
+}
+
+
+
+/**
+ * Function decodes Mode S reply into record of equivalent SBS message (see modeS.H). Current time of record
+ * and weight are left to caller, as with sbsParse().
+ * @param f - reply
+ * @param now - current time
+ * @param r - decoded record
+ * @return false if reply is not decoded (bad CRC, unknown address or type not consumed)
+ */
+bool modeSDecoder::decode(const tModeSFrame &f, std::time_t now, tSbsRecord &r)
+{
+	TRACE_SCOPE("decode");
+	
+	counters.frames++;
+	
+	int df = f.msg[0] >> 3;
+	if ((df >= 16) != (f.len == MODES_LONG))
+	{
+		return false;
+	}
+	
+	uint32_t residual = crcResidual(f);
+	uint32_t icao;
+	tModeSState *s;
+	switch (df)
+	{
+		case 11:
+		case 17:
+		case 18:
+			// DF11 may carry interrogator code in low bits of parity, DF18 only with ICAO address (CF 0)
+			if ((residual & ((df == 11) ? 0xFFFF80 : 0xFFFFFF)) != 0)
+			{
+				counters.badCrc++;
+				return false;
+			}
+			if ((df == 18) && ((f.msg[0] & 0x07) != 0))
+			{
+				return false;
+			}
+			icao = (f.msg[1] << 16) | (f.msg[2] << 8) | f.msg[3];
+			s = state(icao, true);
+			s->lastSeen = now;
+			break;
+		
+		case 4:
+		case 5:
+		case 20:
+		case 21:
+			icao = residual;
+			s = state(icao, false);
+			if ((s == NULL) || (now - s->lastSeen > MODES_ADDRESS_TTL))
+			{
+				counters.unknown++;
+				return false;
+			}
+			break;
+		
+		default:
+			return false;
+	}
+	
+	// record of message without text fields except address (and callsign)
+	r.count = SBS_FIELDS;
+	for (int i = 0; i < SBS_FIELDS; i++)
+	{
+		r.field[i].ptr = hexText;
+		r.field[i].len = 0;
+	}
+	snprintf(hexText, sizeof(hexText), "%06X", icao);
+	r.field[SBS_FIELD_HEX].len = 6;
+	r.hasIcao = true;
+	r.icao = icao;
+	r.hash = hyperLogLog::hash(icao);
+	r.hasAltitude = false;
+	r.hasPosition = false;
+	r.hasSpeed = false;
+	r.hasVerticalRate = false;
+	
+	switch (df)
+	{
+		case 17:
+		case 18:
+			if (! decodeExtended(f.msg, s, now, r))
+			{
+				return false;
+			}
+			break;
+		
+		case 4:
+		case 20:
+			r.type = 5;
+			r.hasAltitude = decodeAC13(((f.msg[2] & 0x1F) << 8) | f.msg[3], r.altitude);
+			break;
+		
+		case 5:
+		case 21:
+			r.type = 6;
+			break;
+		
+		case 11:
+			r.type = 8;
+			break;
+	}
+	
+	counters.decoded++;
+	return true;
+}
+
+
+
+/**
+ * Function returns counters of decoder.
+ * @return counters
+ */
+const tModeSCounters &modeSDecoder::getCounters() const
+{
+	return counters;
+}
@@ -20,13 +20,314 @@
 
 #include "objects.H"
 
+// Maximum number of malformed lines reported individually by loader
+#define LOAD_MAX_WARNINGS 20
+
+// Number of heat map cells parsed before they are added to heat map
+#define LOAD_HEAT_BATCH 256
+
+// Exact powers of ten representable in double
+static const double loadPow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+
+
+/**
+ * Function reports malformed line of init file. Only first LOAD_MAX_WARNINGS are printed.
+ * @param path - path to init file
+ * @param line - line number
+ * @param what - description of problem
+ * @param count - number of warnings reported so far, increased
+ */
+static void loadWarning(const std::string &path, size_t line, const char *what, int &count)
+{
+	if (count < LOAD_MAX_WARNINGS)
+	{
+		fprintf(stderr, "WARNING: %s:%lu: %s\n", path.c_str(), (unsigned long) line, what);
+	}
+	count++;
+}
+
+
+
+/**
+ * Function takes next line of mapped text, CR of CRLF line ending is dropped.
+ * @param c - cursor, moved behind the line
+ * @param l - set to line
+ * @return false at the end of text
+ */
+static bool loadLine(tTextCursor &c, tLineView &l)
+{
+	if (c.p >= c.end)
+	{
+		return false;
+	}
+	
+	const char *nl = (const char *) memchr(c.p, '\n', c.end - c.p);
+	const char *e = (nl != NULL) ? nl : c.end;
+	l.ptr = c.p;
+	l.len = e - c.p;
+	if ((l.len > 0) && (l.ptr[l.len - 1] == '\r'))
+	{
+		l.len--;
+	}
+	
+	c.p = (nl != NULL) ? nl + 1 : c.end;
+	c.line++;
+	return true;
+}
+
+
+
+/**
+ * Function parses decimal integer.
+ * @param p - start of number, moved behind it
+ * @param end - end of text
+ * @param v - parsed value
+ * @return false if there is no valid number
+ */
+static bool loadLong(const char *&p, const char *end, long &v)
+{
+	bool neg = false;
+	if ((p < end) && ((*p == '-') || (*p == '+')))
+	{
+		neg = (*p == '-');
+		p++;
+	}
+	if ((p >= end) || (*p < '0') || (*p > '9'))
+	{
+		return false;
+	}
+	
+	long r = 0;
+	int digits = 0;
+	while ((p < end) && (*p >= '0') && (*p <= '9'))
+	{
+		if (++digits > 18)
+		{
+			return false;
+		}
+		r = r * 10 + (*p - '0');
+		p++;
+	}
+	
+	v = neg ? -r : r;
+	return true;
+}
+
+
+
+/**
+ * Function parses decimal number. Numbers with at most 15 significant digits and no exponent
+ * (everything exportFile() writes) are converted exactly as mantissa / 10^fraction digits,
+ * where both operands are exact and the division is correctly rounded (same result as strtod()).
+ * Other numbers are passed to strtod().
+ * @param p - start of number, moved behind it
+ * @param end - end of text
+ * @param v - parsed value
+ * @return false if there is no valid number
+ */
+static bool loadDouble(const char *&p, const char *end, double &v)
+{
+	const char *start = p;
+	bool neg = false;
+	if ((p < end) && ((*p == '-') || (*p == '+')))
+	{
+		neg = (*p == '-');
+		p++;
+	}
+	
+	uint64_t m = 0;
+	int digits = 0;
+	int frac = 0;
+	bool any = false;
+	while ((p < end) && (*p >= '0') && (*p <= '9'))
+	{
+		m = m * 10 + (*p - '0');
+		digits += (m != 0);
+		any = true;
+		p++;
+	}
+	if ((p < end) && (*p == '.'))
+	{
+		p++;
+		while ((p < end) && (*p >= '0') && (*p <= '9'))
+		{
+			m = m * 10 + (*p - '0');
+			digits += (m != 0);
+			frac++;
+			any = true;
+			p++;
+		}
+	}
+	if (! any)
+	{
+		return false;
+	}
+	
+	if ((digits <= 15) && (frac <= 22) && ((p >= end) || ((*p != 'e') && (*p != 'E'))))
+	{
+		v = (double) m / loadPow10[frac];
+		v = neg ? -v : v;
+		return true;
+	}
+	
+	// slow path - long mantissa or exponent
+	char buf[64];
+	size_t len = std::min((size_t) (end - start), sizeof(buf) - 1);
+	memcpy(buf, start, len);
+	buf[len] = '\0';
+	char *stop;
+	v = strtod(buf, &stop);
+	if (stop == buf)
+	{
+		return false;
+	}
+	p = start + (stop - buf);
+	return true;
+}
+
+
+
+/**
+ * Function parses decimal number of degrees into fixed-point microdegrees. Digits behind sixth decimal
+ * are rounded half away from zero. Exponent is not accepted.
+ * @param p - start of number, moved behind it
+ * @param end - end of text
+ * @param v - parsed value in microdegrees
+ * @return false if there is no valid number or it does not fit fixed-point range
+ */
+static bool loadFixed(const char *&p, const char *end, int32_t &v)
+{
+	bool neg = false;
+	if ((p < end) && ((*p == '-') || (*p == '+')))
+	{
+		neg = (*p == '-');
+		p++;
+	}
+	
+	int64_t m = 0;
+	bool any = false;
+	while ((p < end) && (*p >= '0') && (*p <= '9'))
+	{
+		m = m * 10 + (*p - '0');
+		if (m > INT32_MAX / FIXED_SCALE)
+		{
+			return false;
+		}
+		any = true;
+		p++;
+	}
+	
+	int64_t scale = FIXED_SCALE;
+	m *= scale;
+	if ((p < end) && (*p == '.'))
+	{
+		p++;
+		while ((p < end) && (*p >= '0') && (*p <= '9'))
+		{
+			if (scale > 1)
+			{
+				scale /= 10;
+				m += (*p - '0') * scale;
+			}
+			else if ((scale == 1) && (*p >= '5'))
+			{
+				m++;
+				scale = 0;
+			}
+			else
+			{
+				scale = 0;
+			}
+			any = true;
+			p++;
+		}
+	}
+	if ((! any) || ((p < end) && ((*p == 'e') || (*p == 'E'))) || (m > INT32_MAX))
+	{
+		return false;
+	}
+	
+	v = (int32_t) (neg ? -m : m);
+	return true;
+}
+
+
+
+/**
+ * Function parses line consisting of values separated by '|'.
+ * @param l - line
+ * @param values - parsed values
+ * @param count - expected number of values
+ * @return false if line does not consist of exactly count valid values
+ */
+static bool loadDoubles(const tLineView &l, double *values, int count)
+{
+	const char *p = l.ptr;
+	const char *end = l.ptr + l.len;
+	for (int i = 0; i < count; i++)
+	{
+		if ((i > 0) && ((p >= end) || (*p++ != '|')))
+		{
+			return false;
+		}
+		if (! loadDouble(p, end, values[i]))
+		{
+			return false;
+		}
+	}
+	return (p == end);
+}
+
+/**
+ * Function parses line consisting of degree values separated by '|' into fixed-point microdegrees.
+ * @param l - line
+ * @param values - parsed values
+ * @param count - expected number of values
+ * @return false if line does not consist of exactly count valid values
+ */
+static bool loadFixeds(const tLineView &l, int32_t *values, int count)
+{
+	const char *p = l.ptr;
+	const char *end = l.ptr + l.len;
+	for (int i = 0; i < count; i++)
+	{
+		if ((i > 0) && ((p >= end) || (*p++ != '|')))
+		{
+			return false;
+		}
+		if (! loadFixed(p, end, values[i]))
+		{
+			return false;
+		}
+	}
+	return (p == end);
+}
+
 /**
- * In case of invalid input file, print stderr message and exit program.
+ * Function parses line consisting of integers separated by '|'.
+ * @param l - line
+ * @param values - parsed values
+ * @param count - expected number of values
+ * @return false if line does not consist of exactly count valid values
  */
-void data::formatError()
+static bool loadLongs(const tLineView &l, long *values, int count)
 {
-	fprintf(stderr, "ERROR: Invalid format of init file.\n");
-	exit(1);
+	const char *p = l.ptr;
+	const char *end = l.ptr + l.len;
+	for (int i = 0; i < count; i++)
+	{
+		if ((i > 0) && ((p >= end) || (*p++ != '|')))
+		{
+			return false;
+		}
+		if (! loadLong(p, end, values[i]))
+		{
+			return false;
+		}
+	}
+	return (p == end);
 }
 
 
@@ -128,6 +429,124 @@ double getBearing(tCoords first, tCoords second)
 
 
 
+/**
+ * Function parses ICAO24 address field.
+ * @param p - address field (hexadecimal, not null-terminated)
+ * @param len - length of field
+ * @param icao - parsed address
+ * @return false if address is empty or malformed
+ */
+static bool parseIcao(const char *p, size_t len, uint32_t &icao)
+{
+	if ((len == 0) || (len > 6))
+	{
+		return false;
+	}
+	
+	icao = 0;
+	for (size_t i = 0; i < len; i++)
+	{
+		char c = p[i];
+		uint32_t digit;
+		if ((c >= '0') && (c <= '9'))
+		{
+			digit = c - '0';
+		}
+		else if ((c >= 'A') && (c <= 'F'))
+		{
+			digit = c - 'A' + 10;
+		}
+		else if ((c >= 'a') && (c <= 'f'))
+		{
+			digit = c - 'a' + 10;
+		}
+		else
+		{
+			return false;
+		}
+		icao = (icao << 4) | digit;
+	}
+	return true;
+}
+
+
+
+/**
+ * Function parses SBS transmission message into record. Line is split into fields without copying
+ * (trailing empty field is not counted), numeric fields are parsed only for consumed message types.
+ * @param line - message (not null-terminated)
+ * @param len - length of message
+ * @param types - mask of consumed message types (SBS_TYPE())
+ * @param r - parsed record (time is left to caller)
+ * @return false if line is not complete transmission message of consumed type
+ */
+bool sbsParse(const char *line, size_t len, unsigned types, tSbsRecord &r)
+{
+	TRACE_SCOPE("parse");
+	
+	const char *p = line;
+	const char *end = line + len;
+	int n = 0;
+	while (p < end)
+	{
+		const char *comma = (const char *) memchr(p, ',', end - p);
+		const char *e = (comma != NULL) ? comma : end;
+		if (n < SBS_FIELDS)
+		{
+			r.field[n].ptr = p;
+			r.field[n].len = e - p;
+		}
+		n++;
+		if (comma == NULL)
+		{
+			break;
+		}
+		p = comma + 1;
+	}
+	r.count = n;
+	
+	// Only complete transmission messages are processed
+	if ((n < 16) || (r.field[0].len != 3) || (memcmp(r.field[0].ptr, "MSG", 3) != 0))
+	{
+		return false;
+	}
+	for (int i = n; i < SBS_FIELDS; i++)
+	{
+		r.field[i].ptr = end;
+		r.field[i].len = 0;
+	}
+	
+	long type;
+	const char *f = r.field[SBS_FIELD_TYPE].ptr;
+	const char *fEnd = f + r.field[SBS_FIELD_TYPE].len;
+	if ((! loadLong(f, fEnd, type)) || (f != fEnd) || (type < 1) || (type > SBS_TYPES) || (! (types & SBS_TYPE(type))))
+	{
+		return false;
+	}
+	r.type = type;
+	
+	r.hasIcao = parseIcao(r.field[SBS_FIELD_HEX].ptr, r.field[SBS_FIELD_HEX].len, r.icao);
+	r.hash = r.hasIcao ? hyperLogLog::hash(r.icao) : 0;
+	
+	f = r.field[SBS_FIELD_ALT].ptr;
+	r.hasAltitude = (r.field[SBS_FIELD_ALT].len > 0) && loadLong(f, f + r.field[SBS_FIELD_ALT].len, r.altitude);
+	
+	f = r.field[SBS_FIELD_LAT].ptr;
+	const char *g = r.field[SBS_FIELD_LON].ptr;
+	r.hasPosition = (r.field[SBS_FIELD_LAT].len > 0) && (r.field[SBS_FIELD_LON].len > 0)
+		&& loadFixed(f, f + r.field[SBS_FIELD_LAT].len, r.lat) && loadFixed(g, g + r.field[SBS_FIELD_LON].len, r.lon);
+	
+	f = r.field[SBS_FIELD_SPEED].ptr;
+	r.hasSpeed = (r.field[SBS_FIELD_SPEED].len > 0) && loadDouble(f, f + r.field[SBS_FIELD_SPEED].len, r.speed);
+	
+	f = r.field[SBS_FIELD_VRATE].ptr;
+	r.hasVerticalRate = (r.field[SBS_FIELD_VRATE].len > 0) && loadLong(f, f + r.field[SBS_FIELD_VRATE].len, r.verticalRate);
+	
+	return true;
+}
+
+
+
 /**
  * Function splits string into vector of substrings originally separated by delimiter
  * @param str - string to be splitted
@@ -153,130 +572,401 @@ std::vector<std::string> split(std::string str, char delimiter)
 
 
 /**
- * Constructor.
- * Initialize object from external file
- * @param path - std::string containing path to initialization file.
+ * Function parses n decimal numbers separated by separator character from start of field.
+ * Rest of field behind last number (e.g. fraction of seconds) is ignored.
+ * @param p - pointer to field characters (not null-terminated)
+ * @param len - length of field
+ * @param sep - separator of numbers
+ * @param out - array to be filled with numbers
+ * @param n - number of numbers
+ * @return true if field starts with n numbers
  */
-data::data(std::string path)
+static bool parseFieldNumbers(const char *p, size_t len, char sep, int *out, int n)
 {
-	std::ifstream f(path);
-	if (!f)		// input stream creation failed
+	size_t i = 0;
+	for (int k = 0; k < n; k++)
 	{
-		fprintf(stderr, "ERROR: Unable to open init file.\n");
-		exit(1);
+		if ((k > 0) && ((i >= len) || (p[i++] != sep)))
+		{
+			return false;
+		}
+		
+		size_t start = i;
+		int value = 0;
+		while ((i < len) && (p[i] >= '0') && (p[i] <= '9') && (i - start < 9))
+		{
+			value = value * 10 + (p[i] - '0');
+			i++;
+		}
+		if (i == start)
+		{
+			return false;
+		}
+		out[k] = value;
+	}
+	return true;
+}
+
+
+
+/**
+ * Function converts SBS date and time fields into UTC timestamp.
+ * @param date - date in YYYY/MM/DD format (not null-terminated)
+ * @param dateLen - length of date
+ * @param time - time in HH:MM:SS.sss format (fraction is ignored, not null-terminated)
+ * @param timeLen - length of time
+ * @return timestamp, -1 if fields are not valid
+ */
+std::time_t parseSbsTime(const char *date, size_t dateLen, const char *time, size_t timeLen)
+{
+	int d[3];
+	int h[3];
+	if ((! parseFieldNumbers(date, dateLen, '/', d, 3)) || (! parseFieldNumbers(time, timeLen, ':', h, 3)))
+	{
+		return -1;
 	}
 	
-	std::string line;
+	struct tm t;
+	memset(&t, 0, sizeof(t));
+	t.tm_year = d[0] - 1900;
+	t.tm_mon = d[1] - 1;
+	t.tm_mday = d[2];
+	t.tm_hour = h[0];
+	t.tm_min = h[1];
+	t.tm_sec = h[2];
 	
-	uptime = std::time(nullptr);
+	return timegm(&t);
+}
+
+
+
+/**
+ * Function splits buffer into lines terminated by newline character.
+ * Views into buffer are appended to lines, terminating newline is not part of view.
+ * Unterminated tail of buffer is not consumed, so it can be completed by next read.
+ * @param buf - buffer containing incoming data
+ * @param len - number of valid bytes in buffer
+ * @param lines - vector to append line views to
+ * @return number of consumed bytes (position right after last newline)
+ */
+size_t frameLines(const char *buf, size_t len, std::vector<tLineView> &lines)
+{
+	size_t start = 0;
+	const char *nl;
 	
-	// Load timestamp (line 1)
-	if (! std::getline(f, line))
+	while ((nl = (const char *) memchr(buf + start, '\n', len - start)) != NULL)
 	{
-		formatError();
+		tLineView line;
+		line.ptr = buf + start;
+		line.len = nl - line.ptr;
+		lines.push_back(line);
+		
+		start = (nl - buf) + 1;
 	}
-
-	timestamp = std::stoi(line);
 	
+	return start;
+}
+
+
+
+/**
+ * Constructor.
+ * Initialize object from external file, isLoaded() tells whether it was successful.
+ * @param path - std::string containing path to initialization file.
+ */
+data::data(std::string path)
+{
+	uptime = std::time(nullptr);
+	projected = false;
+	logTime = false;
+	lastLogTime = 0;
+	flightLog = NULL;
+	sampling = 1;
+	sampleCount = 0;
+	shedPositions = 0;
+	peakSampling = 1;
+	memset(sectionVersion, 0, sizeof(sectionVersion));
+	motionVersion = 0;
+	speedPlot.assign(SPEED_BINS, 0);
+	vratePlot.assign(VRATE_BINS, 0);
 	
-	// Load reference lat (line 2)
-	if (! std::getline(f, line))
+	loaded = (loadFile(path) == 0);
+	if (loaded)
 	{
-		formatError();
+		fprintf(stdout, "Loading successfull.\n");
+	}
+}
+
+
+
+/**
+ * Function loads init file written by exportFile(). File is mapped into memory and parsed in single pass
+ * without per-line allocations. Malformed lines are reported with line numbers and skipped (missing
+ * polar range or altitude values are replaced by reference position or zero), only invalid header
+ * (timestamp and reference position) makes loading fail.
+ * @param path - path to init file
+ * @return zero if success, nonzero otherwise
+ */
+int data::loadFile(std::string path)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd == -1)
+	{
+		fprintf(stderr, "ERROR: Unable to open init file.\n");
+		return 1;
 	}
 	
-	ref.lat = std::stod(line);
-	
+	struct stat st;
+	if ((fstat(fd, &st) == -1) || (st.st_size == 0))
+	{
+		fprintf(stderr, "ERROR: Init file %s is empty.\n", path.c_str());
+		close(fd);
+		return 1;
+	}
 	
-	// Load reference lon (line 3)
-	if (! std::getline(f, line))
+	size_t size = st.st_size;
+	void *base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED)
 	{
-		formatError();
+		fprintf(stderr, "ERROR: Unable to map init file %s.\n", path.c_str());
+		return 1;
 	}
+	madvise(base, size, MADV_SEQUENTIAL);
 	
-	ref.lon = std::stod(line);
+	tTextCursor c;
+	c.p = (const char *) base;
+	c.end = c.p + size;
+	c.line = 0;
+	tLineView l;
+	int warnings = 0;
 	
+	// Header - timestamp, reference lat and lon (lines 1-3)
+	long ts;
+	double refValues[2];
+	bool header = loadLine(c, l) && loadLongs(l, &ts, 1);
+	header = header && loadLine(c, l) && loadDoubles(l, &refValues[0], 1);
+	header = header && loadLine(c, l) && loadDoubles(l, &refValues[1], 1);
+	if (! header)
+	{
+		fprintf(stderr, "ERROR: %s:%lu: Invalid header of init file.\n", path.c_str(), (unsigned long) c.line);
+		munmap(base, size);
+		return 1;
+	}
+	timestamp = ts;
+	ref.lat = refValues[0];
+	ref.lon = refValues[1];
 	
-	// Load polar range plot values (lines 4-363)
+	// Load polar range plot values (lines 4-363), section ends by blank line
+	bool blank = false;
+	polarRange.reserve(360);
 	for (int i = 0; i < 360; i++)
 	{
-		if (! std::getline(f, line))
+		tFixedCoords newPos = coordsToFixed(ref);
+		int32_t values[2];
+		if (blank || (! loadLine(c, l)) || (l.len == 0))
 		{
-			formatError();
+			if (! blank)
+			{
+				loadWarning(path, c.line, "polar range section is incomplete", warnings);
+			}
+			blank = true;
+		}
+		else if (loadFixeds(l, values, 2))
+		{
+			newPos.lat = values[0];
+			newPos.lon = values[1];
+		}
+		else
+		{
+			loadWarning(path, c.line, "malformed polar range line", warnings);
 		}
-		std::vector<std::string> vec = split(line, '|');
-		tCoords newPos;
-		newPos.lat = std::stod (vec[0]);
-		newPos.lon = std::stod (vec[1]);
-		
 		polarRange.push_back(newPos);
 	}
 	
-	// Load delimiting blank line
-	if (! std::getline(f, line))
+	geoRefInit(geo, ref.lat, ref.lon);
+	initPolarDist();
+	initCellMemo();
+	
+	// Delimiting blank line
+	while ((! blank) && loadLine(c, l) && (l.len != 0))
 	{
-		formatError();
+		loadWarning(path, c.line, "unexpected line at the end of polar range section", warnings);
 	}
 	
-	// Load altPlot values (500 values)
+	// Load altPlot values (501 values), section ends by blank line
+	blank = false;
+	altPlot.reserve(501);
 	for (int i = 0; i <= 500; i++)
 	{
-		if (! std::getline(f,line))
+		long value = 0;
+		if (blank || (! loadLine(c, l)) || (l.len == 0))
+		{
+			if (! blank)
+			{
+				loadWarning(path, c.line, "altitude section is incomplete", warnings);
+			}
+			blank = true;
+		}
+		else if (! loadLongs(l, &value, 1))
 		{
-			formatError();
+			loadWarning(path, c.line, "malformed altitude line", warnings);
+			value = 0;
 		}
-		altPlot.push_back(std::stoi(line));
+		altPlot.push_back(value);
 	}
 	
-	// Load delimiting blank line
-	if (! std::getline(f, line))
+	// Delimiting blank line
+	while ((! blank) && loadLine(c, l) && (l.len != 0))
 	{
-		formatError();
+		loadWarning(path, c.line, "unexpected line at the end of altitude section", warnings);
 	}
 	
-	
-	// Load heatMap weighted points
-	while (std::getline(f, line))
+	// Load heatMap weighted points, hash table is sized for the rest of file (heat lines take at least 8 bytes).
+	// Cells are added in batches, so table accesses are not serialized by parsing in between.
+	heatMap.reserve((c.end - c.p) / 8);
+	// Blocks of adaptive map (4th field is level) are added at end.
+	std::vector<tHeatCell> batch;
+	std::vector<tHeatEntry> blocks;
+	batch.reserve(LOAD_HEAT_BATCH);
+	while (loadLine(c, l) && (l.len != 0))
 	{
-		if (line == "")
+		long values[4];
+		int latQ, lonQ;
+		if (loadLongs(l, values, 4))
 		{
-			break;
+			latQ = values[0];
+			lonQ = values[1];
+			if ((values[3] < 1) || (values[3] > HEAT_MAX_LEVEL) || (! heatValid(latQ, lonQ)))
+			{
+				loadWarning(path, c.line, "malformed heat map line", warnings);
+				continue;
+			}
+			tHeatEntry block;
+			block.code = heatMorton(latQ, lonQ);
+			block.weight = values[2];
+			block.level = values[3];
+			blocks.push_back(block);
+			continue;
+		}
+		else if (loadLongs(l, values, 3))
+		{
+			latQ = values[0];
+			lonQ = values[1];
+		}
+		else if (loadLongs(l, values, 2) && decodeHeatKey(values[0], latQ, lonQ))
+		{
+			// legacy line keyed by decimal concatenation of latitude and longitude
+			values[2] = values[1];
+		}
+		else
+		{
+			loadWarning(path, c.line, "malformed heat map line", warnings);
+			continue;
+		}
+		if (heatValid(latQ, lonQ))
+		{
+			tHeatCell cell;
+			cell.code = heatMorton(latQ, lonQ);
+			cell.weight = values[2];
+			batch.push_back(cell);
+			if (batch.size() == LOAD_HEAT_BATCH)
+			{
+				heatMap.addBatch(batch.data(), batch.size());
+				batch.clear();
+			}
 		}
-		std::vector<std::string> vec = split(line, '|');
-		int index = std::stoi (vec[0]);
-		int weight = std::stoi (vec[1]);
-		heatMap[index] = weight;
 	}
+	heatMap.addBatch(batch.data(), batch.size());
+	heatMap.addEntries(blocks.data(), blocks.size());
 	
 	// Load companyPlot string-keyed map
-	while (std::getline(f, line))
+	while (loadLine(c, l) && (l.len != 0))
 	{
-		if (line == "")
+		const char *sep = (const char *) memchr(l.ptr, '|', l.len);
+		const char *p = sep + 1;
+		long val;
+		if ((sep == NULL) || (sep == l.ptr) || (! loadLong(p, l.ptr + l.len, val)) || (p != l.ptr + l.len))
 		{
-			break;
+			loadWarning(path, c.line, "malformed company line", warnings);
+			continue;
 		}
-		std::string key = line.substr(0,3);		// First 3 characters
-		int val = std::stoi(line.substr(4));
-		companyPlot[key] = val;
+		companyPlot[std::string(l.ptr, sep - l.ptr)] = val;
 	}
 	
 	// Trailing $ check
-	if (! std::getline(f, line))
+	if ((! loadLine(c, l)) || (l.len != 1) || (l.ptr[0] != '$'))
 	{
-		formatError();
+		loadWarning(path, c.line, "missing trailing $ (file is truncated)", warnings);
 	}
-	if (line != "$")
+	
+	// Motion statistics follow first $ (files of older versions end by it)
+	if (c.p < c.end)
 	{
-		formatError();
+		loadMotion(path, c, warnings);
 	}
-	else
+	
+	if (warnings > LOAD_MAX_WARNINGS)
 	{
-		// Init successful
-		fprintf(stdout, "Loading successfull.\n");
-		return;
+		fprintf(stderr, "WARNING: %s: %d more malformed lines\n", path.c_str(), warnings - LOAD_MAX_WARNINGS);
+	}
+	
+	munmap(base, size);
+	
+	// Missing or unreadable sketch file starts distinct aircraft counting from scratch
+	distinct.load(path + HLL_EXTENSION);
+	return 0;
+}
+
+
+
+/**
+ * Function loads motion statistics section of init file (behind first $), missing values stay zero.
+ * @param path - path to init file (for warnings)
+ * @param c - cursor behind first $
+ * @param warnings - number of warnings reported so far, increased
+ */
+void data::loadMotion(const std::string &path, tTextCursor &c, int &warnings)
+{
+	tLineView l;
+	std::vector<int> *plots[] = {&speedPlot, &vratePlot};
+	for (int k = 0; k < 2; k++)
+	{
+		size_t i = 0;
+		while (loadLine(c, l) && (l.len != 0))
+		{
+			long value;
+			if ((i >= plots[k]->size()) || (! loadLongs(l, &value, 1)))
+			{
+				loadWarning(path, c.line, (k == 0) ? "malformed ground speed line" : "malformed vertical rate line", warnings);
+				continue;
+			}
+			(*plots[k])[i++] = value;
+		}
 	}
 	
+	int refLatQ = (int) round(ref.lat * SURFACE_SCALE);
+	int refLonQ = (int) round(ref.lon * SURFACE_SCALE);
+	std::vector<tHeatCell> batch;
+	while (loadLine(c, l) && (l.len != 0))
+	{
+		long v[3];
+		if ((! loadLongs(l, v, 3)) || (! heatValid(v[0] - refLatQ, v[1] - refLonQ)))
+		{
+			loadWarning(path, c.line, "malformed surface map line", warnings);
+			continue;
+		}
+		tHeatCell cell;
+		cell.code = heatMorton(v[0] - refLatQ, v[1] - refLonQ);
+		cell.weight = v[2];
+		batch.push_back(cell);
+	}
+	surfaceMap.addBatch(batch.data(), batch.size());
 	
+	if ((! loadLine(c, l)) || (l.len != 1) || (l.ptr[0] != '$'))
+	{
+		loadWarning(path, c.line, "missing trailing $ of motion statistics (file is truncated)", warnings);
+	}
 }
 
 
@@ -294,23 +984,38 @@ data::data(double lat, double lon)
 	ref.lon = lon;
 	
 	uptime = std::time(nullptr);
+	projected = false;
+	logTime = false;
+	lastLogTime = 0;
+	flightLog = NULL;
+	sampling = 1;
+	sampleCount = 0;
+	shedPositions = 0;
+	peakSampling = 1;
+	memset(sectionVersion, 0, sizeof(sectionVersion));
+	loaded = true;
+	timestamp = 0;
 	
 	// Fill 359 polarPlot values with reference position, since no other data is available yet
 	for (int i = 0; i < 360; i++)
 	{
-		tCoords newPos;
-		newPos.lat = ref.lat;
-		newPos.lon = ref.lon;
-		
-		polarRange.push_back(newPos);
+		polarRange.push_back(coordsToFixed(ref));
 	}
 	
+	geoRefInit(geo, ref.lat, ref.lon);
+	initPolarDist();
+	initCellMemo();
+	
 	// Fill 500 altPlot values with zero.
 	for (int i = 0; i <= 500; i++)
 	{
 		altPlot.push_back(0);
 	}
 	
+	motionVersion = 0;
+	speedPlot.assign(SPEED_BINS, 0);
+	vratePlot.assign(VRATE_BINS, 0);
+	
 	return;
 }
 
@@ -320,11 +1025,348 @@ data::data(double lat, double lon)
  */
 data::data()
 {
+	projected = false;
+	logTime = false;
+	lastLogTime = 0;
+	flightLog = NULL;
+	sampling = 1;
+	sampleCount = 0;
+	shedPositions = 0;
+	peakSampling = 1;
+	memset(sectionVersion, 0, sizeof(sectionVersion));
+	loaded = true;
+	timestamp = 0;
+	initCellMemo();
+	motionVersion = 0;
+	speedPlot.assign(SPEED_BINS, 0);
+	vratePlot.assign(VRATE_BINS, 0);
 	return;
 }
 
 
 
+/**
+ * Function computes distance of every polarRange position from reference.
+ */
+void data::initPolarDist()
+{
+	polarDist.resize(polarRange.size());
+	
+	for (size_t i = 0; i < polarRange.size(); i++)
+	{
+		polarDist[i] = getDistance(ref, fixedToCoords(polarRange[i]));
+	}
+}
+
+
+
+/**
+ * Function packs quantized heat map cell position into single cell memo key.
+ * @param latQ - cell latitude in 1/100 of degree
+ * @param lonQ - cell longitude in 1/100 of degree
+ * @return memo key
+ */
+static inline uint32_t cellMemoKey(int latQ, int lonQ)
+{
+	return (uint32_t) (latQ + 9000) * 36001u + (uint32_t) (lonQ + 18000);
+}
+
+
+
+/**
+ * Function clears heat map cell memo and its counters.
+ */
+void data::initCellMemo()
+{
+	tCellMemo empty;
+	empty.key = CELL_MEMO_EMPTY;
+	empty.binLo = 0;
+	empty.binSpan = 0;
+	empty.maxDist = 0.0f;
+	
+	cellMemo.assign(CELL_MEMO_SIZE, empty);
+	memoLookups = 0;
+	memoHits = 0;
+	memoSkips = 0;
+}
+
+
+
+/**
+ * Function checks in cell memo, whether heat map cell lies inside current polar range envelope,
+ * i.e. no position inside the cell can extend polarRange. As polarRange only grows, once inside
+ * cell stays inside.
+ * If cell is not in memo, its slot is claimed and returned for filling by fillCellMemo().
+ * @param latQ - cell latitude in 1/100 of degree
+ * @param lonQ - cell longitude in 1/100 of degree
+ * @param slot - set to memo slot to be filled, -1 if no filling is needed
+ * @return true if cell is inside envelope (bearing/distance calculation can be skipped)
+ */
+bool data::isCellInside(int latQ, int lonQ, int &slot)
+{
+	uint32_t key = cellMemoKey(latQ, lonQ);
+	uint32_t index = ((key * 2654435761u) >> 16) & (CELL_MEMO_SIZE - 1);
+	tCellMemo &m = cellMemo[index];
+	
+	memoLookups++;
+	slot = -1;
+	
+	if (m.key != key)
+	{
+		// claim slot, entry is not usable until filled
+		m.key = key;
+		m.maxDist = INFINITY;
+		slot = index;
+		return false;
+	}
+	
+	memoHits++;
+	for (int i = 0; i <= m.binSpan; i++)
+	{
+		if (polarDist[(m.binLo + i) % 360] < m.maxDist)
+		{
+			return false;
+		}
+	}
+	
+	memoSkips++;
+	return true;
+}
+
+
+
+/**
+ * Function fills cell memo slot based on known bearing bin and distance of single position inside cell.
+ * Any other cell point is at most CELL_DIAG_KM away, which gives conservative maximum distance
+ * and angular width of cell as seen from reference.
+ * @param slot - memo slot claimed by isCellInside()
+ * @param pos - position inside the cell
+ * @param bin - bearing bin of position
+ * @param distance - distance of position from reference in km
+ */
+void data::fillCellMemo(int slot, tFixedCoords pos, int bin, double distance)
+{
+	tCellMemo &m = cellMemo[slot];
+	
+	// slot may have been claimed by another cell since
+	if (m.key != cellMemoKey(fixedQuantize(pos.lat, HEAT_STEP), fixedQuantize(pos.lon, HEAT_STEP)))
+	{
+		return;
+	}
+	
+	if (distance <= 2.5 * CELL_DIAG_KM)
+	{
+		// cell too close to reference, may cover any bearing
+		m.binLo = 0;
+		m.binSpan = 359;
+	}
+	else
+	{
+		// asin(x) <= 1.1 * x for x <= 0.4, bin itself covers another half degree on each side
+		double width = toDegrees(1.1 * CELL_DIAG_KM / distance);
+		int lo = (int) floor(bin - width);
+		int hi = (int) floor(bin + 1.0 + width);
+		
+		m.binLo = (lo + 360) % 360;
+		m.binSpan = hi - lo;
+	}
+	
+	// small margin covers difference of kernel errors between two points of the cell
+	m.maxDist = distance + CELL_DIAG_KM + 0.05;
+}
+
+
+
+/**
+ * Function enables or disables log time mode.
+ * In this mode flight timestamps are taken from message (date/time generated fields)
+ * instead of current time, so historical logs are processed as if received live.
+ * @param enable - true to take time from messages
+ */
+void data::setLogTime(bool enable)
+{
+	logTime = enable;
+}
+
+
+
+/**
+ * Function returns latest message timestamp seen in log time mode.
+ * @return timestamp, zero if no message was processed yet
+ */
+std::time_t data::getLastLogTime()
+{
+	return lastLogTime;
+}
+
+
+
+/**
+ * Function returns reference position of object.
+ * @return reference position
+ */
+tCoords data::getRef()
+{
+	return ref;
+}
+
+
+
+/**
+ * Function merges statistics of another object into this one.
+ * Polar range keeps farther position for each bearing, counters are summed, distinct aircraft sketches are united.
+ * Flight buffer of other object is not merged.
+ * @param other - object with the same reference position
+ * @return zero if success, nonzero if reference positions differ
+ */
+int data::merge(const data &other)
+{
+	if ((other.ref.lat != ref.lat) || (other.ref.lon != ref.lon))
+	{
+		fprintf(stderr, "ERROR: Unable to merge statistics with different reference position!\n");
+		return 1;
+	}
+	
+	for (int i = 0; i < 360; i++)
+	{
+		if (other.polarDist[i] > polarDist[i])
+		{
+			polarRange[i] = other.polarRange[i];
+			polarDist[i] = other.polarDist[i];
+		}
+	}
+	
+	for (int i = 0; i <= 500; i++)
+	{
+		altPlot[i] += other.altPlot[i];
+	}
+	
+	heatMap.merge(other.heatMap);
+	
+	std::map<std::string, int>::const_iterator companyIter;
+	for (companyIter = other.companyPlot.begin(); companyIter != other.companyPlot.end(); ++companyIter)
+	{
+		companyPlot[companyIter->first] += companyIter->second;
+	}
+	
+	distinct.merge(other.distinct);
+	
+	for (int i = 0; i < SPEED_BINS; i++)
+	{
+		speedPlot[i] += other.speedPlot[i];
+	}
+	for (int i = 0; i < VRATE_BINS; i++)
+	{
+		vratePlot[i] += other.vratePlot[i];
+	}
+	const std::vector<tHeatCell> &surface = other.surfaceMap.cells();
+	surfaceMap.addBatch(surface.data(), surface.size());
+	motionVersion++;
+	
+	for (int i = 0; i < SNAP_SECTIONS; i++)
+	{
+		sectionVersion[i]++;
+	}
+	
+	return 0;
+}
+
+
+
+/**
+ * Function returns heat map cell memo counters.
+ * @param lookups - number of positions looked up in memo
+ * @param hits - number of lookups which found their cell in memo
+ * @param skips - number of positions for which bearing and distance calculation was skipped
+ */
+void data::getCellMemoStats(uint64_t &lookups, uint64_t &hits, uint64_t &skips)
+{
+	lookups = memoLookups;
+	hits = memoHits;
+	skips = memoSkips;
+}
+
+
+
+/**
+ * Function adapts sampling factor of position messages to backlog of processor (load shedding).
+ * Factor is doubled while backlog stays above SHED_HIGH percent of capacity and halved when it drops below
+ * SHED_LOW percent, so short bursts are absorbed by pipe and only sustained overload is sampled.
+ * @param backlog - number of bytes waiting for processing
+ * @param capacity - capacity of queue in bytes
+ * @return new sampling factor (1 if all messages are processed)
+ */
+unsigned data::adaptSampling(size_t backlog, size_t capacity)
+{
+	if ((backlog * 100 > capacity * SHED_HIGH) && (sampling < SHED_MAX_FACTOR))
+	{
+		sampling *= 2;
+		peakSampling = std::max(peakSampling, sampling);
+	}
+	else if ((backlog * 100 < capacity * SHED_LOW) && (sampling > 1))
+	{
+		sampling /= 2;
+	}
+	return sampling;
+}
+
+
+
+/**
+ * Function returns load shedding counters.
+ * @param factor - current sampling factor of position messages
+ * @param peak - highest sampling factor used so far
+ * @param shed - number of position messages left out of heat map and altitude plot
+ */
+void data::getSheddingStats(unsigned &factor, unsigned &peak, uint64_t &shed)
+{
+	factor = sampling;
+	peak = peakSampling;
+	shed = shedPositions;
+}
+
+
+
+/**
+ * Function enables or disables local tangent plane projection mode.
+ * In this mode bearing and distance of positions near reference are computed from projected
+ * east/north coordinates instead of spherical formulas (see geoBatchProjected() for error bound).
+ * @param enable - true to use projection
+ */
+void data::setProjection(bool enable)
+{
+	projected = enable;
+}
+
+
+
+/**
+ * Function sets budget of heat map entries, map exceeding it is compacted at once.
+ * @param entries - maximum number of entries, zero for unlimited
+ */
+void data::setHeatBudget(size_t entries)
+{
+	size_t before = heatMap.size();
+	heatMap.setBudget(entries);
+	if (heatMap.size() != before)
+	{
+		sectionVersion[SNAP_HEAT]++;
+	}
+}
+
+
+
+/**
+ * Function returns budget of heat map entries.
+ * @return maximum number of entries, zero for unlimited
+ */
+size_t data::getHeatBudget() const
+{
+	return heatMap.getBudget();
+}
+
+
+
 /**
  * Function returns uptime value from object instance.
  * @return uptime
@@ -336,6 +1378,28 @@ std::time_t data::getUptime()
 
 
 
+/**
+ * Function returns time of last change of file (time of export of loaded file, or of last exportFile()).
+ * @return timestamp, zero if object was not loaded from file nor exported yet
+ */
+std::time_t data::getTimestamp()
+{
+	return timestamp;
+}
+
+
+
+/**
+ * Function tells whether object was successfully initialized.
+ * @return false if init file could not be loaded
+ */
+bool data::isLoaded()
+{
+	return loaded;
+}
+
+
+
 
 /**
  * Function clears from flightBuffer entries older than 30 minutes.
@@ -343,7 +1407,20 @@ std::time_t data::getUptime()
  */
 int data::flushFBuffer()
 {
-	std::time_t now = std::time(nullptr);
+	return flushFBuffer(std::time(nullptr));
+}
+
+
+
+/**
+ * Function clears from flightBuffer entries older than 30 minutes relative to provided time.
+ * @param now - current time
+ * @return number of erased entries.
+ */
+int data::flushFBuffer(std::time_t now)
+{
+	TRACE_SCOPE("flushFBuffer");
+	
 	int counter = 0;
 	
 	for (int i = 0; i < flightBuffer.size(); i++)
@@ -358,6 +1435,29 @@ int data::flushFBuffer()
 	
 	return counter;
 }
+
+
+
+/**
+ * Function removes all entries of flightBuffer.
+ */
+void data::clearFBuffer()
+{
+	flightBuffer.clear();
+}
+
+
+
+/**
+ * Function sets log collecting flights instead of company plot. Every ID message of pair hex-callsign,
+ * which is not in flight buffer, is appended to log (and pair to buffer), so caller can count sightings
+ * in order of their appearance by addFlight() later.
+ * @param log - log of sightings, NULL to count companies directly
+ */
+void data::setFlightLog(std::vector<tFlightSighting> *log)
+{
+	flightLog = log;
+}
 	
 
 /**
@@ -368,87 +1468,442 @@ int data::flushFBuffer()
  */
 int data::exportFile(std::string path)
 {
+	TRACE_SCOPE("exportFile");
+	
 	std::ofstream f;
 	f.open(path);
 	if (f.is_open())
 	{
-		timestamp = std::time(nullptr);
-		f << timestamp << '\n';
-		f << ref.lat << '\n';
-		f << ref.lon << '\n';
+		renderFile(f);
 		
-		// Iterate over 359 polarPlot positions
-		for (int i = 0; i < 360; i++)
-		{
-			tCoords p = polarRange[i];
-			char buf[32];
-			sprintf(buf, "%.4f|%.4f", polarRange[i].lat, polarRange[i].lon);
-			std::string outLine = buf;
-			f << outLine << '\n';
-		}
+		// Close file
+		f.close();
 		
-		// Delimiting newline
-		f << '\n';
-		
-		// Iterate over 500 altPlot altitude counts
-		for (int i = 0; i <= 500; i++)
+		// Distinct aircraft sketches are binary, they are kept in separate file
+		return distinct.save(path + HLL_EXTENSION);
+	}
+	else
+	{
+		fprintf(stderr, "ERROR: Unable to open output file!\n");
+		return 1;
+	}
+}
+
+
+
+/**
+ * Function writes object data in format of init file (see exportFile()) and sets time of last change.
+ * @param f - output stream
+ */
+void data::renderFile(std::ostream &f)
+{
+	timestamp = std::time(nullptr);
+	f << timestamp << '\n';
+	f << ref.lat << '\n';
+	f << ref.lon << '\n';
+	
+	// Iterate over 359 polarPlot positions
+	for (int i = 0; i < 360; i++)
+	{
+		char buf[32];
+		sprintf(buf, "%.4f|%.4f", fixedToDegrees(polarRange[i].lat), fixedToDegrees(polarRange[i].lon));
+		std::string outLine = buf;
+		f << outLine << '\n';
+	}
+	
+	// Delimiting newline
+	f << '\n';
+	
+	// Iterate over 500 altPlot altitude counts
+	for (int i = 0; i <= 500; i++)
+	{
+		f << altPlot[i] << '\n';
+	}
+	
+	// Delimiting newline
+	f << '\n';
+	
+	// Iterate over heatMap active points (in Morton order), blocks of coarser level are written at their first cell with level
+	const std::vector<tHeatCell> &cells = heatMap.cells();
+	const std::vector<uint8_t> &levels = heatMap.levels();
+	for (size_t i = 0; i < cells.size(); i++)
+	{
+		int latQ, lonQ;
+		heatDemorton(cells[i].code, latQ, lonQ);
+		char buf[48];
+		if (levels[i] == 0)
 		{
-			f << altPlot[i] << '\n';
+			sprintf(buf, "%d|%d|%d", latQ, lonQ, cells[i].weight);
 		}
-		
-		// Delimiting newline
-		f << '\n';
-		
-		// Iterate over heatMap active points
-		std::map<int, int>::iterator heatMapIter;
-		for (heatMapIter = heatMap.begin(); heatMapIter != heatMap.end(); ++heatMapIter)
+		else
 		{
-			char buf[32];
-			sprintf(buf, "%d|%d", heatMapIter->first, heatMapIter->second);
-			std::string outLine = buf;
-			f << outLine << '\n';
+			sprintf(buf, "%d|%d|%d|%d", latQ, lonQ, cells[i].weight, levels[i]);
 		}
-		
-		// Delimiting newline
-		f << '\n';
-		
-		// Iterate over company records
-		std::map<std::string, int>::iterator companyIter;
-		for (companyIter = companyPlot.begin(); companyIter != companyPlot.end(); ++companyIter)
+		std::string outLine = buf;
+		f << outLine << '\n';
+	}
+	
+	// Delimiting newline
+	f << '\n';
+	
+	// Iterate over company records
+	std::map<std::string, int>::iterator companyIter;
+	for (companyIter = companyPlot.begin(); companyIter != companyPlot.end(); ++companyIter)
+	{
+		char buf[32];
+		sprintf(buf, "%s|%d", (companyIter->first).c_str(), companyIter->second);
+		std::string outLine = buf;
+		f << outLine << '\n';
+	}
+	
+	// Delimiting newline
+	f << '\n';
+	
+	// Trailing $ - valid file
+	f << '$';
+	
+	// Motion statistics - ground speed bins, vertical rate bins and surface map cells (1/SURFACE_SCALE degree),
+	// sections end by blank line, file ends by second $
+	f << '\n';
+	for (int i = 0; i < SPEED_BINS; i++)
+	{
+		f << speedPlot[i] << '\n';
+	}
+	f << '\n';
+	for (int i = 0; i < VRATE_BINS; i++)
+	{
+		f << vratePlot[i] << '\n';
+	}
+	f << '\n';
+	int refLatQ = (int) round(ref.lat * SURFACE_SCALE);
+	int refLonQ = (int) round(ref.lon * SURFACE_SCALE);
+	const std::vector<tHeatCell> &surface = surfaceMap.cells();
+	for (size_t i = 0; i < surface.size(); i++)
+	{
+		int latQ, lonQ;
+		heatDemorton(surface[i].code, latQ, lonQ);
+		char buf[48];
+		sprintf(buf, "%d|%d|%d", latQ + refLatQ, lonQ + refLonQ, surface[i].weight);
+		f << buf << '\n';
+	}
+	f << "\n$";
+}
+
+
+
+/**
+ * Function serializes distinct aircraft sketches in format of sketch file written along with init file.
+ * @param out - serialized sketches are appended here
+ */
+void data::renderSketches(std::string &out)
+{
+	distinct.serialize(out);
+}
+
+
+/**
+ * Function splits heat map key of files written by older versions into cell latitude and longitude.
+ * Key is decimal concatenation of both values, so there can be more possible splits,
+ * the one closest to reference position is used.
+ * @param key - heat map key
+ * @param latQ - set to cell latitude in 1/100 degree
+ * @param lonQ - set to cell longitude in 1/100 degree
+ * @return true if key could be decoded
+ */
+bool data::decodeHeatKey(int key, int &latQ, int &lonQ)
+{
+	char str[16];
+	int len = snprintf(str, sizeof(str), "%d", key);
+	int refLatQ = (int) round(ref.lat * 100);
+	int refLonQ = (int) round(ref.lon * 100);
+	bool found = false;
+	int best = 0;
+	
+	for (int k = 1; k < len; k++)
+	{
+		// longitude part was printed by %d, so it has no leading zero
+		if ((str[k] == '0') && (k + 1 < len))
 		{
-			char buf[32];
-			sprintf(buf, "%s|%d", (companyIter->first).c_str(), companyIter->second);
-			std::string outLine = buf;
-			f << outLine << '\n';
+			continue;
+		}
+		if (str[k - 1] == '-')
+		{
+			continue;
 		}
 		
-		// Delimiting newline
-		f << '\n';
-		
-		// Trailing $ - valid file
-		f << '$';
-		
-		// Close file
-		f.close();
+		int lat = 0;
+		int lon = 0;
+		for (int i = (str[0] == '-') ? 1 : 0; i < k; i++)
+		{
+			lat = lat * 10 + (str[i] - '0');
+		}
+		for (int i = k; i < len; i++)
+		{
+			lon = lon * 10 + (str[i] - '0');
+		}
+		if (str[0] == '-')
+		{
+			lat = -lat;
+		}
+		if ((abs(lat) > 9000) || (abs(lon) > 18000))
+		{
+			continue;
+		}
 		
-		return 0;
+		int diff = abs(lat - refLatQ) + abs(lon - refLonQ);
+		if ((! found) || (diff < best))
+		{
+			found = true;
+			best = diff;
+			latQ = lat;
+			lonQ = lon;
+		}
 	}
-	else
+	
+	return found;
+}
+
+
+
+/**
+ * Comparator used to sort companies in snapshot.
+ */
+static bool snapCompanyMore(const tSnapCompany &a, const tSnapCompany &b)
+{
+	return (a.count > b.count) || ((a.count == b.count) && (strcmp(a.code, b.code) < 0));
+}
+
+
+
+/**
+ * Function writes binary snapshot of object data (format is described in snapshot.H).
+ * Snapshot is written into temporary file and renamed, so readers mapping it never see partial file.
+ * @param path - path to snapshot file
+ * @return zero if success, nonzero otherwise
+ */
+int data::exportSnapshot(std::string path)
+{
+	TRACE_SCOPE("exportSnapshot");
+	
+	std::string content;
+	renderSnapshot(content);
+	
+	std::string tmpPath = path + ".tmp";
+	FILE *f = fopen(tmpPath.c_str(), "wb");
+	if (f == NULL)
 	{
-		fprintf(stderr, "ERROR: Unable to open output file!\n");
+		fprintf(stderr, "ERROR: Unable to open snapshot file!\n");
+		return 1;
+	}
+	
+	fwrite(content.data(), 1, content.size(), f);
+	
+	if ((fclose(f) != 0) || (rename(tmpPath.c_str(), path.c_str()) != 0))
+	{
+		fprintf(stderr, "ERROR: Unable to write snapshot file!\n");
 		return 1;
 	}
+	
+	return 0;
+}
+
+
+
+/**
+ * Function serializes binary snapshot of object data (format is described in snapshot.H).
+ * @param out - serialized snapshot is appended here
+ */
+void data::renderSnapshot(std::string &out)
+{
+	std::vector<tSnapPolar> polar(360);
+	for (int i = 0; i < 360; i++)
+	{
+		polar[i].lat = fixedToDegrees(polarRange[i].lat);
+		polar[i].lon = fixedToDegrees(polarRange[i].lon);
+		polar[i].dist = polarDist[i];
+	}
+	
+	std::vector<int32_t> alt(altPlot.begin(), altPlot.end());
+	
+	const std::vector<tHeatCell> &cells = heatMap.cells();
+	
+	std::vector<tSnapCompany> companies;
+	std::map<std::string, int>::iterator companyIter;
+	for (companyIter = companyPlot.begin(); companyIter != companyPlot.end(); ++companyIter)
+	{
+		tSnapCompany c;
+		memset(c.code, 0, sizeof(c.code));
+		strncpy(c.code, companyIter->first.c_str(), sizeof(c.code) - 1);
+		c.count = companyIter->second;
+		companies.push_back(c);
+	}
+	std::sort(companies.begin(), companies.end(), snapCompanyMore);
+	
+	tSnapHeader h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, SNAP_MAGIC, sizeof(h.magic));
+	h.version = SNAP_VERSION;
+	h.sectionCount = SNAP_SECTIONS;
+	h.timestamp = std::time(nullptr);
+	h.refLat = ref.lat;
+	h.refLon = ref.lon;
+	
+	uint64_t offset = sizeof(h);
+	h.sections[SNAP_POLAR].offset = offset;
+	h.sections[SNAP_POLAR].count = polar.size();
+	offset += polar.size() * sizeof(tSnapPolar);
+	h.sections[SNAP_ALT].offset = offset;
+	h.sections[SNAP_ALT].count = alt.size();
+	offset += alt.size() * sizeof(int32_t);
+	h.sections[SNAP_HEAT].offset = offset;
+	h.sections[SNAP_HEAT].count = cells.size();
+	offset += cells.size() * sizeof(tHeatCell);
+	h.sections[SNAP_COMPANY].offset = offset;
+	h.sections[SNAP_COMPANY].count = companies.size();
+	
+	out.reserve(out.size() + offset + companies.size() * sizeof(tSnapCompany));
+	out.append((const char *) &h, sizeof(h));
+	out.append((const char *) polar.data(), polar.size() * sizeof(tSnapPolar));
+	out.append((const char *) alt.data(), alt.size() * sizeof(int32_t));
+	out.append((const char *) cells.data(), cells.size() * sizeof(tHeatCell));
+	out.append((const char *) companies.data(), companies.size() * sizeof(tSnapCompany));
+}
+
+
+
+/**
+ * Function publishes current statistics into shared memory segment.
+ * Companies are sorted and heat map is merged into blocks fitting the segment before update starts,
+ * so readers are held off only for copying.
+ * @param live - writer of mapped segment
+ * @param now - current time
+ */
+void data::publishLive(liveWriter &live, std::time_t now)
+{
+	TRACE_SCOPE("publishLive");
+	
+	std::vector<tSnapCompany> companies;
+	std::map<std::string, int>::iterator companyIter;
+	for (companyIter = companyPlot.begin(); companyIter != companyPlot.end(); ++companyIter)
+	{
+		tSnapCompany c;
+		memset(c.code, 0, sizeof(c.code));
+		strncpy(c.code, companyIter->first.c_str(), sizeof(c.code) - 1);
+		c.count = companyIter->second;
+		companies.push_back(c);
+	}
+	std::sort(companies.begin(), companies.end(), snapCompanyMore);
+	if (companies.size() > LIVE_COMPANIES)
+	{
+		companies.resize(LIVE_COMPANIES);
+	}
+	
+	// coarsest level is single cell per 2^15 x 2^15 block, which always fits
+	const std::vector<tHeatCell> &cells = heatMap.cells();
+	int level = 0;
+	liveHeat.clear();
+	heatDownsample(cells.data(), cells.size(), level, liveHeat);
+	while (liveHeat.size() > LIVE_HEAT_CELLS)
+	{
+		std::vector<tHeatCell> coarser;
+		heatDownsample(liveHeat.data(), liveHeat.size(), ++level, coarser);
+		liveHeat.swap(coarser);
+	}
+	
+	tLiveData *d = live.begin();
+	d->updated = now;
+	d->refLat = ref.lat;
+	d->refLon = ref.lon;
+	for (int i = 0; i < 360; i++)
+	{
+		d->polar[i].lat = fixedToDegrees(polarRange[i].lat);
+		d->polar[i].lon = fixedToDegrees(polarRange[i].lon);
+		d->polar[i].dist = polarDist[i];
+	}
+	for (int i = 0; i <= 500; i++)
+	{
+		d->alt[i] = altPlot[i];
+	}
+	d->companyCount = companies.size();
+	memcpy(d->companies, companies.data(), companies.size() * sizeof(tSnapCompany));
+	d->heatLevel = level;
+	d->heatCount = liveHeat.size();
+	memcpy(d->heat, liveHeat.data(), liveHeat.size() * sizeof(tHeatCell));
+	live.end();
+}
+
+
+
+/**
+ * Function exports object data as archive period. Polar range is rounded to precision of exportFile().
+ * @param p - period to fill
+ * @param t - timestamp of period
+ */
+void data::exportPeriod(tArchivePeriod &p, std::time_t t)
+{
+	TRACE_SCOPE("exportPeriod");
+	
+	p.timestamp = t;
+	p.polar.resize(720);
+	for (int i = 0; i < 360; i++)
+	{
+		p.polar[2 * i] = (int32_t) round(fixedToDegrees(polarRange[i].lat) * 10000);
+		p.polar[2 * i + 1] = (int32_t) round(fixedToDegrees(polarRange[i].lon) * 10000);
+	}
+	p.alt.assign(altPlot.begin(), altPlot.end());
+	p.heat = heatMap.cells();
+	p.companies = companyPlot;
+}
+
+
+
+/**
+ * Function replaces object data by columns of archived period. Reference position is kept.
+ * @param p - archived period
+ * @param mask - columns to replace (bit 1 << column id), other data is left untouched
+ */
+void data::importPeriod(const tArchivePeriod &p, unsigned mask)
+{
+	if (mask & (1u << SNAP_POLAR))
+	{
+		for (int i = 0; i < 360; i++)
+		{
+			polarRange[i].lat = p.polar[2 * i] * (FIXED_SCALE / 10000);
+			polarRange[i].lon = p.polar[2 * i + 1] * (FIXED_SCALE / 10000);
+		}
+		initPolarDist();
+		initCellMemo();
+	}
+	if (mask & (1u << SNAP_ALT))
+	{
+		altPlot.assign(p.alt.begin(), p.alt.end());
+	}
+	if (mask & (1u << SNAP_HEAT))
+	{
+		heatMap.clear();
+		heatMap.addBatch(p.heat.data(), p.heat.size());
+	}
+	if (mask & (1u << SNAP_COMPANY))
+	{
+		companyPlot = p.companies;
+	}
+	
+	for (int i = 0; i < SNAP_SECTIONS; i++)
+	{
+		sectionVersion[i] += (mask >> i) & 1;
+	}
 }
 
 
+
 /**
  * Function checks whether a pair hex-callsign stored in stamp is currently in flightBuffer.
  * @param stamp - tFStamp containing pair of hex-callsign
  * @return true if pair is currently in buffer, false otherwise
  */
-bool data::isInFBuffer(tFStamp stamp)
+bool data::isInFBuffer(const tFStamp &stamp) const
 {
-	for (tFStamp st : flightBuffer)
+	for (const tFStamp &st : flightBuffer)
 	{
 		if ((st.hex == stamp.hex) && (st.callsign == stamp.callsign))
 		{
@@ -577,280 +2032,843 @@ bool data::isInFBuffer(tFStamp stamp)
  * 
  * [ Thanks to Mr Dave Reid for comprehensive information on this topic ]
  * 
- * @param message - incoming message converted to std::string
- * @return 1 or 3 based on type of processed message, zero for discarded message.
+ * @param message - incoming message
+ * @return type of processed message, zero for discarded message.
  */
-int data::processMessage(std::string message)
+int data::processMessage(const std::string &message)
 {
-	// Split message into individual csv fields
-	std::vector<std::string> fields = split(message, ',');
-	
+	int result = processLine(message.c_str(), message.size(), std::time(nullptr));
+	flushPositions();
 	
-	tFStamp stamp;
-	// Switch based on message type
-	switch (std::stoi(fields[1]))
-	{
-		case 1:
-			// ID message (hex+callsign available)
-			if ((fields[4] != "") && (fields[10] != ""))
-			{
-				stamp.hex = fields[4];
-				stamp.callsign = fields[10];
-				stamp.timestamp = std::time(nullptr);
-				
-				if (! isInFBuffer(stamp))
-				{
-					std::locale loc;
-					std::string company = stamp.callsign.substr(0,3);
-					if ((std::isalpha(company[0])) && (std::isalpha(company[1])) && (std::isalpha(company[2])) && (std::isdigit(stamp.callsign[3])))
-					{
-						if ( companyPlot.find(company) == companyPlot.end() )
-						{
-							companyPlot[company] = 1;
-						}
-						else
-						{
-							companyPlot[company]++;
-						}
-					}
-					
-					flightBuffer.push_back(stamp);
-				}
-			}
-			return 1;
-			break;
-			
-		case 3:
-			// Airborne position message (Altitude+lat/lon available)
-			if ((fields[14] != "") && (fields[15] != ""))
-			{
-				tCoords mPos;
-				mPos.lat = std::stod(fields[14]);
-				mPos.lon = std::stod(fields[15]);
-			
-				int bearing = (int) round(getBearing(ref, mPos));
-				
-				double distance = getDistance(ref, mPos);
-				
-				tCoords maxPos = polarRange[bearing];
-				
-				double maxDistance = getDistance(ref, maxPos);
-				
-				if (distance > maxDistance)
-				{
-					polarRange[bearing] = mPos;
-				}
-				
-				char buf[32];
-				sprintf(buf, "%d%d", (int) round(mPos.lat * 100), (int) round(mPos.lon * 100));
-				std::string sIntPos = buf;
-				int intPos = std::stoi(sIntPos);
-				
-				if (heatMap.find(intPos) == heatMap.end())
-				{
-					heatMap[intPos] = 1;
-				}
-				else
-				{
-					heatMap[intPos]++;
-				}
-			}
-			if (fields[11] != "")
-			{
-				int fl = std::stoi(fields[11]) / 100;	// Convert altitude to FL
-				if (fl <= 500)
-				{
-					altPlot[fl]++;
-				}
-			}
-			return 3;
-			break;
-	}
-	return 0;
+	return result;
 }
 
 
 
 /**
- * Function loads icao-iata database from external file into
- * internal representation.
- * Function fills instance data.
- * @param path - path to icao-iata.db
- * @return zero if success, nonzero otherwise
+ * Function processes batch of incoming messages.
+ * All messages in batch share single current time, so clock is read only once per batch
+ * instead of once per message.
+ * @param lines - array of line views, each containing single SBS message
+ * @param count - number of lines in array
+ * @param now - current time used for all messages in batch
+ * @return number of processed (not discarded) messages
  */
-int data::loadIcaoIata(std::string path)
+int data::processBatch(const tLineView *lines, size_t count, std::time_t now)
 {
-	std::ifstream f(path);
-	if (!f)		// input stream creation failed
+	TRACE_SCOPE("batch");
+	
+	int processed = 0;
+	
+	if (logTime)
 	{
-		return 1;
+		seedLogTime(lines, count);
 	}
 	
-	std::string line;
-	
-	while (std::getline(f, line))
+	for (size_t i = 0; i < count; i++)
 	{
-		std::vector<std::string> vec = split(line, '\t');
-		std::vector<std::string> vecc;
-		vecc.push_back(vec[2]);
-		vecc.push_back(vec[4]);
-		icaoIata[vec[1]] = vecc;
+		if (processLine(lines[i].ptr, lines[i].len, now) != 0)
+		{
+			processed++;
+		}
 	}
 	
-	return 0;
+	flushPositions();
+	
+	return processed;
 }
 
 
 
 /**
- * Function converts instance data and produces files with
- * Javascript code using GoogleMaps API to display collected data.
- * @param dir - directory to create JS files
- * @param launchDir - directory of executable
- * @param cThr - company treshold. If count of company is below or equal treshold, company will not appear in airline chart.
- * @return zero if success, nonzero otherwise
+ * Function advances lastLogTime to timestamp of first callsign message of batch, so messages preceding it
+ * in batch (import chunk may start anywhere in log) take its time instead of zero or time of older chunk.
+ * @param lines - array of line views, each containing single SBS message
+ * @param count - number of lines in array
  */
-int data::createJS(std::string dir, std::string launchDir, int cThr)
+void data::seedLogTime(const tLineView *lines, size_t count)
 {
-	// Create rangePlot
-	std::ofstream f;
-	std::string fpath = dir + "/polarPlot.js";
-	f.open(fpath);
-	if (f.is_open())
+	tSbsRecord r;
+	for (size_t i = 0; i < count; i++)
 	{
-		f << "function initializePolarPlot() {\n  var polarMapOptions = {\n    zoom: 7,\n    center: new google.maps.LatLng(";
-		f << ref.lat << ", " << ref.lon << "),\n    mapTypeId: google.maps.MapTypeId.TERRAIN\n  };\n\n  var polarPlot;\n\n  var polarMap = new google.maps.Map(document.getElementById('polar-map-canvas'),\n      polarMapOptions);";
-		f << "var triangleCoords = [\n";
+		if (! sbsParse(lines[i].ptr, lines[i].len, SBS_TYPE(1), r))
+		{
+			continue;
+		}
 		
-		for (int i = 0; i < 360; i++)
+		const tSbsField &date = r.field[SBS_FIELD_DATE];
+		const tSbsField &time = r.field[SBS_FIELD_TIME];
+		std::time_t t = parseSbsTime(date.ptr, date.len, time.ptr, time.len);
+		if (t >= 0)
 		{
-			tCoords p = polarRange[i];
-			f << "    new google.maps.LatLng(" << p.lat << ", " << p.lon << ")";
-			if (i != 359)
-			{
-				f << ",\n";
-			}
-			else
+			if (t > lastLogTime)
 			{
-				f << "\n";
+				lastLogTime = t;
 			}
+			return;
 		}
-		f << "  ];\n\n  polarPlot = new google.maps.Polygon({\n    paths: triangleCoords,\n    strokeColor: '#FF0000',\n    strokeOpacity: 0.8,\n    strokeWeight: 2,\n    fillColor: '#FF0000',\n    fillOpacity: 0.35\n  });\n\n";
-		f << "  var image = new google.maps.MarkerImage('http://maps.google.com/mapfiles/kml/pal4/icon57.png', null, new google.maps.Point(0,0), new google.maps.Point(16,16));";
-		f << "  var myLatLng = new google.maps.LatLng(" << ref.lat << ", " << ref.lon << ");";
-		f << "  var beachMarker = new google.maps.Marker({\n      position: myLatLng,\n      map: polarMap,\n      icon: image\n  });\n\n";
-		f << "  polarPlot.setMap(polarMap);\n}\n\ngoogle.maps.event.addDomListener(window, 'load', initializePolarPlot);";
-		
-		f.close();
-		
 	}
-	else
+}
+
+
+
+/**
+ * Function processes batch of Mode S replies - each decoded reply is passed to statistics modules as equivalent
+ * SBS message, positions are flushed once at the end (see processBatch()).
+ * @param decoder - decoder of replies (keeps CPR state of aircraft)
+ * @param frames - array of replies
+ * @param count - number of replies
+ * @param now - current time
+ * @return number of processed (not discarded) replies
+ */
+int data::processFrames(modeSDecoder &decoder, const tModeSFrame *frames, size_t count, std::time_t now)
+{
+	TRACE_SCOPE("batch");
+	
+	int processed = 0;
+	
+	for (size_t i = 0; i < count; i++)
 	{
-		fprintf(stderr, "ERROR: Unable to open output file: [%s]\n", fpath.c_str());
-		return 1;
+		tSbsRecord r;
+		if (decoder.decode(frames[i], now, r) && (tPipeline::messages & SBS_TYPE(r.type)))
+		{
+			processRecord(r, now);
+			processed++;
+		}
 	}
 	
+	flushPositions();
 	
-	// Create heatMap
-	fpath = dir + "/heatMap.js";
-	f.open(fpath);
-	if (f.is_open())
+	return processed;
+}
+
+
+
+/**
+ * Function computes bearing and distance of all positions queued by current batch
+ * at once using batched geodesic kernel and updates polarRange with new maximums.
+ */
+void data::flushPositions()
+{
+	size_t n = batchPos.size();
+	if (n == 0)
+	{
+		return;
+	}
+	
+	TRACE_SCOPE("geodesic");
+	
+	batchLat.resize(n);
+	batchLon.resize(n);
+	for (size_t i = 0; i < n; i++)
+	{
+		batchLat[i] = fixedToDegrees(batchPos[i].lat);
+		batchLon[i] = fixedToDegrees(batchPos[i].lon);
+	}
+	
+	batchBins.resize(n);
+	batchDist.resize(n);
+	if (projected)
 	{
-		f << "var map, pointarray, heatmap;\n\nvar heatMapData = [\n";
+		geoBatchProjected(geo, batchLat.data(), batchLon.data(), n, batchBins.data(), batchDist.data());
+	}
+	else
+	{
+		geoBatch(geo, batchLat.data(), batchLon.data(), n, batchBins.data(), batchDist.data());
+	}
+	
+	for (size_t i = 0; i < n; i++)
+	{
+		int bearing = batchBins[i];
+		if (batchDist[i] > polarDist[bearing])
+		{
+			polarRange[bearing] = batchPos[i];
+			polarDist[bearing] = batchDist[i];
+			sectionVersion[SNAP_POLAR]++;
+		}
 		
-		std::map<int, int>::iterator heatMapIter;
-		for (heatMapIter = heatMap.begin(); heatMapIter != heatMap.end(); ++heatMapIter)
+		if (batchSlot[i] >= 0)
 		{
-			std::string pos = std::to_string(heatMapIter->first);
-			int iLat = std::stoi(pos.substr(0,4));
-			int iLon = std::stoi(pos.substr(4,4));
-			int weight = heatMapIter->second;
-			
-			double hLat = iLat / 100.0;
-			double hLon = iLon / 100.0;
-			
-			f << "  {location: new google.maps.LatLng(" << hLat << ", " << hLon << "), weight: " << weight << "}";
-			
-			if (++heatMapIter != heatMap.end())
+			fillCellMemo(batchSlot[i], batchPos[i], bearing, batchDist[i]);
+		}
+	}
+	
+	batchPos.clear();
+	batchSlot.clear();
+}
+
+
+
+/**
+ * Function removes aircraft not heard of for AIRCRAFT_TIMEOUT seconds from aircraft state table.
+ * @param now - current time
+ * @return number of removed aircraft
+ */
+int data::expireAircraft(std::time_t now)
+{
+	TRACE_SCOPE("expireAircraft");
+	
+	return (int) aircraft.expire((uint32_t) now, AIRCRAFT_TIMEOUT);
+}
+
+
+
+/**
+ * Function processes single message (see processMessage()) using provided current time.
+ * @param message - pointer to message characters (not null-terminated)
+ * @param len - length of message
+ * @param now - current time
+ * @return type of processed message, zero for discarded message.
+ */
+int data::processLine(const char *message, size_t len, std::time_t now)
+{
+	tSbsRecord r;
+	if (! sbsParse(message, len, tPipeline::messages, r))
+	{
+		return 0;
+	}
+	
+	processRecord(r, now);
+	return r.type;
+}
+
+
+
+/**
+ * Function passes parsed SBS message or decoded Mode S reply to statistics modules consuming its type.
+ * @param r - parsed message (time and weight are set here)
+ * @param now - current time
+ */
+void data::processRecord(tSbsRecord &r, std::time_t now)
+{
+	// In log time mode callsign messages carry time, other messages take the latest one
+	r.time = now;
+	if (logTime)
+	{
+		if (r.type == 1)
+		{
+			const tSbsField &date = r.field[SBS_FIELD_DATE];
+			const tSbsField &time = r.field[SBS_FIELD_TIME];
+			std::time_t t = parseSbsTime(date.ptr, date.len, time.ptr, time.len);
+			if (t >= 0)
+			{
+				r.time = t;
+				if (t > lastLogTime)
+				{
+					lastLogTime = t;
+				}
+			}
+		}
+		else if (lastLogTime > 0)
+		{
+			r.time = lastLogTime;
+		}
+	}
+	
+	// In overload only every sampling-th position counts into heat map and altitude plot, for all skipped ones
+	r.weight = 1;
+	if ((sampling > 1) && (r.type == 3))
+	{
+		if (++sampleCount % sampling == 0)
+		{
+			r.weight = sampling;
+		}
+		else
+		{
+			r.weight = 0;
+			shedPositions++;
+		}
+	}
+	
+	tPipeline::dispatch(*this, r);
+}
+
+
+
+/**
+ * Module of aircraft state table and distinct aircraft sketches - every message with address updates
+ * last known state of aircraft (callsign, position, altitude) and counts aircraft in its hour.
+ * @param r - parsed message
+ */
+void data::consumeTrack(const tSbsRecord &r)
+{
+	TRACE_SCOPE("module track");
+	
+	// Time of message is unknown in logTime mode until first callsign message (state and hourly sketch are keyed by time)
+	if (! r.hasIcao || (logTime && (r.time == 0)))
+	{
+		return;
+	}
+	
+	tAircraftState *a = aircraft.touch(r.icao, r.time);
+	distinct.add(r.hash, r.time);
+	
+	const tSbsField &callsign = r.field[SBS_FIELD_CALLSIGN];
+	if ((r.type == 1) && (callsign.len > 0))
+	{
+		memset(a->callsign, 0, sizeof(a->callsign));
+		memcpy(a->callsign, callsign.ptr, std::min(callsign.len, sizeof(a->callsign)));
+	}
+	
+	if (r.hasPosition)
+	{
+		a->lat = r.lat;
+		a->lon = r.lon;
+		if (a->firstRange == AIRCRAFT_NO_RANGE)
+		{
+			tCoords pos;
+			pos.lat = fixedToDegrees(r.lat);
+			pos.lon = fixedToDegrees(r.lon);
+			double range = getDistance(ref, pos) * 10;
+			a->firstRange = (range < AIRCRAFT_NO_RANGE - 1) ? (uint16_t) range : AIRCRAFT_NO_RANGE - 1;
+		}
+	}
+	
+	if (r.hasAltitude && (r.altitude >= INT16_MIN * 25) && (r.altitude <= INT16_MAX * 25))
+	{
+		a->alt = (int16_t) (r.altitude / 25);
+	}
+}
+
+
+
+/**
+ * Module of airline counts - ID message (hex+callsign) of flight, which is not in flight buffer,
+ * increases counter of its airline. If flight log is set, new flights are only appended to it.
+ * @param r - parsed message
+ */
+void data::consumeCompany(const tSbsRecord &r)
+{
+	TRACE_SCOPE("module company");
+	
+	const tSbsField &hex = r.field[SBS_FIELD_HEX];
+	const tSbsField &callsign = r.field[SBS_FIELD_CALLSIGN];
+	if ((hex.len == 0) || (callsign.len == 0))
+	{
+		return;
+	}
+	
+	tFlightSighting s;
+	s.stamp.hex.assign(hex.ptr, hex.len);
+	s.stamp.callsign.assign(callsign.ptr, callsign.len);
+	s.stamp.timestamp = r.time;
+	s.hash = r.hash;
+	s.hasIcao = r.hasIcao;
+	
+	if (flightLog == NULL)
+	{
+		addFlight(s);
+	}
+	else if (! isInFBuffer(s.stamp))
+	{
+		// buffer only suppresses repeated sightings until it is cleared
+		flightLog->push_back(s);
+		flightBuffer.push_back(s.stamp);
+	}
+}
+
+
+
+/**
+ * Function counts flight in company plot, unless its pair hex-callsign is in flight buffer.
+ * @param s - sighting of flight
+ */
+void data::addFlight(const tFlightSighting &s)
+{
+	const tFStamp &stamp = s.stamp;
+	if (! isInFBuffer(stamp))
+	{
+		std::string company = stamp.callsign.substr(0,3);
+		if ((std::isalpha(company[0])) && (std::isalpha(company[1])) && (std::isalpha(company[2])) && (std::isdigit(stamp.callsign[3])))
+		{
+			if ( companyPlot.find(company) == companyPlot.end() )
 			{
-				f << ",\n";
+				companyPlot[company] = 1;
 			}
 			else
 			{
-				f << "\n";
+				companyPlot[company]++;
 			}
-			heatMapIter--;
-		}
+			sectionVersion[SNAP_COMPANY]++;
 			
-		f << "];\n\nfunction initialize() {\n  var mapOptions = {\n    zoom: 9,\n    center: new google.maps.LatLng(" << ref.lat << ", " << ref.lon << "),\n    mapTypeId: google.maps.MapTypeId.SATELLITE\n";
-		f << "  };\n\n  map = new google.maps.Map(document.getElementById('map-canvas'),\n      mapOptions);\n\n  var pointArray = new google.maps.MVCArray(heatMapData);\n\n";
-		f << "  heatmap = new google.maps.visualization.HeatmapLayer({\n    data: pointArray\n  });\n\n  var image = new google.maps.MarkerImage('http://maps.google.com/mapfiles/kml/pal4/icon57.png', null, new google.maps.Point(0,0), new google.maps.Point(16,16));";
-		f << "  var myLatLng = new google.maps.LatLng(" << ref.lat << ", " << ref.lon << ");  var beachMarker = new google.maps.Marker({\n      position: myLatLng,\n      map: map,\n      icon: image\n";
-		f << "  });heatmap.setMap(map);\n}\n\nfunction toggleHeatmap() {\n  heatmap.setMap(heatmap.getMap() ? null : map);\n}\n\n";
-		f << "function changeGradient() {\n  var gradient = [\n    'rgba(0, 255, 255, 0)',\n    'rgba(0, 255, 255, 1)',\n    'rgba(0, 191, 255, 1)',\n    'rgba(0, 127, 255, 1)',\n";
-		f << "    'rgba(0, 63, 255, 1)',\n    'rgba(0, 0, 255, 1)',\n    'rgba(0, 0, 223, 1)',\n    'rgba(0, 0, 191, 1)',\n    'rgba(0, 0, 159, 1)',\n    'rgba(0, 0, 127, 1)',\n";
-		f << "    'rgba(63, 0, 91, 1)',\n    'rgba(127, 0, 63, 1)',\n    'rgba(191, 0, 31, 1)',\n    'rgba(255, 0, 0, 1)'\n  ]\n  heatmap.set('gradient', heatmap.get('gradient') ? null : gradient);\n}\n\n";
-		f << "function changeRadius() {\n  heatmap.set('radius', heatmap.get('radius') ? null : 20);\n}\n\nfunction changeOpacity() {\n  heatmap.set('opacity', heatmap.get('opacity') ? null : 0.2);\n";
-		f << "}\n\nfunction mtypeHybrid() {\n	map.setMapTypeId(google.maps.MapTypeId.HYBRID);\n}\n\nfunction mtypeSat() {\n	map.setMapTypeId(google.maps.MapTypeId.SATELLITE);\n}google.maps.event.addDomListener(window, 'load', initialize);";
+			// pair in flight buffer was counted already
+			if (s.hasIcao)
+			{
+				distinct.addAirline(company, s.hash);
+			}
+		}
 		
-		f.close();
+		flightBuffer.push_back(stamp);
 	}
-	else
+}
+
+
+
+/**
+ * Module of polar range - airborne position is queued for batched bearing and distance calculation
+ * (flushPositions()), unless cell memo proves that position cannot extend polar range.
+ * @param r - parsed message
+ */
+void data::consumePolar(const tSbsRecord &r)
+{
+	TRACE_SCOPE("module polar");
+	
+	if (! r.hasPosition)
+	{
+		return;
+	}
+	
+	int slot;
+	if (! isCellInside(fixedQuantize(r.lat, HEAT_STEP), fixedQuantize(r.lon, HEAT_STEP), slot))
+	{
+		tFixedCoords pos;
+		pos.lat = r.lat;
+		pos.lon = r.lon;
+		batchPos.push_back(pos);
+		batchSlot.push_back(slot);
+	}
+}
+
+
+
+/**
+ * Module of heat map - airborne position increases weight of its cell (by sampling factor in overload).
+ * @param r - parsed message
+ */
+void data::consumeHeat(const tSbsRecord &r)
+{
+	TRACE_SCOPE("module heat");
+	
+	if ((! r.hasPosition) || (r.weight == 0))
+	{
+		return;
+	}
+	
+	int latQ = fixedQuantize(r.lat, HEAT_STEP);
+	int lonQ = fixedQuantize(r.lon, HEAT_STEP);
+	if (heatValid(latQ, lonQ))
+	{
+		heatMap.add(heatMorton(latQ, lonQ), r.weight);
+		sectionVersion[SNAP_HEAT]++;
+	}
+}
+
+
+
+/**
+ * Module of altitude plot - airborne position with altitude increases counter of its flight level
+ * (by sampling factor in overload).
+ * @param r - parsed message
+ */
+void data::consumeAltitude(const tSbsRecord &r)
+{
+	TRACE_SCOPE("module altitude");
+	
+	if ((! r.hasAltitude) || (r.weight == 0))
+	{
+		return;
+	}
+	
+	long fl = r.altitude / 100;	// Convert altitude to FL
+	if ((fl >= 0) && (fl <= 500))
+	{
+		altPlot[fl] += r.weight;
+		sectionVersion[SNAP_ALT]++;
+	}
+}
+
+
+
+/**
+ * Module of ground speed histogram - airborne velocity message increases counter of its speed bin.
+ * @param r - parsed message
+ */
+void data::consumeSpeed(const tSbsRecord &r)
+{
+	TRACE_SCOPE("module speed");
+	
+	if ((! r.hasSpeed) || (r.speed < 0))
+	{
+		return;
+	}
+	
+	int bin = std::min((int) (r.speed / SPEED_BIN), SPEED_BINS - 1);
+	speedPlot[bin]++;
+	motionVersion++;
+}
+
+
+
+/**
+ * Module of vertical rate histogram - airborne velocity message increases counter of its vertical rate bin.
+ * @param r - parsed message
+ */
+void data::consumeVerticalRate(const tSbsRecord &r)
+{
+	TRACE_SCOPE("module vertical rate");
+	
+	if (! r.hasVerticalRate)
+	{
+		return;
+	}
+	
+	long bin = (long) floor((double) r.verticalRate / VRATE_BIN) + VRATE_BINS / 2;
+	bin = std::max(0L, std::min(bin, (long) VRATE_BINS - 1));
+	vratePlot[bin]++;
+	motionVersion++;
+}
+
+
+
+/**
+ * Module of surface movement map - surface position increases weight of its cell.
+ * @param r - parsed message
+ */
+void data::consumeSurface(const tSbsRecord &r)
+{
+	TRACE_SCOPE("module surface");
+	
+	if (! r.hasPosition)
+	{
+		return;
+	}
+	
+	int latQ = fixedQuantize(r.lat, FIXED_SCALE / SURFACE_SCALE) - (int) round(ref.lat * SURFACE_SCALE);
+	int lonQ = fixedQuantize(r.lon, FIXED_SCALE / SURFACE_SCALE) - (int) round(ref.lon * SURFACE_SCALE);
+	if (heatValid(latQ, lonQ))
+	{
+		surfaceMap.add(heatMorton(latQ, lonQ), 1);
+		motionVersion++;
+	}
+}
+
+
+
+/**
+ * Function loads icao-iata database from external file into
+ * internal representation.
+ * Function fills instance data.
+ * @param path - path to icao-iata.db
+ * @return zero if success, nonzero otherwise
+ */
+int data::loadIcaoIata(std::string path)
+{
+	std::ifstream f(path);
+	if (!f)		// input stream creation failed
 	{
-		fprintf(stderr, "ERROR: Unable to open output file: [%s]\n", fpath.c_str());
 		return 1;
 	}
 	
+	std::string line;
 	
-	//Create csv file for highcharts airline chart
-	fpath = dir + "/airline.csv";
-	f.open(fpath);
-	if (f.is_open())
+	while (std::getline(f, line))
+	{
+		std::vector<std::string> vec = split(line, '\t');
+		std::vector<std::string> vecc;
+		vecc.push_back(vec[2]);
+		vecc.push_back(vec[4]);
+		icaoIata[vec[1]] = vecc;
+	}
+	
+	return 0;
+}
+
+
+
+/**
+ * Function writes Javascript code drawing polar range plot using GoogleMaps API.
+ * @param f - output stream
+ */
+void data::renderPolarJS(std::ostream &f)
+{
+	f << "function initializePolarPlot() {\n  var polarMapOptions = {\n    zoom: 7,\n    center: new google.maps.LatLng(";
+	f << ref.lat << ", " << ref.lon << "),\n    mapTypeId: google.maps.MapTypeId.TERRAIN\n  };\n\n  var polarPlot;\n\n  var polarMap = new google.maps.Map(document.getElementById('polar-map-canvas'),\n      polarMapOptions);";
+	f << "var triangleCoords = [\n";
+	
+	for (int i = 0; i < 360; i++)
+	{
+		tCoords p = fixedToCoords(polarRange[i]);
+		f << "    new google.maps.LatLng(" << p.lat << ", " << p.lon << ")";
+		if (i != 359)
+		{
+			f << ",\n";
+		}
+		else
+		{
+			f << "\n";
+		}
+	}
+	f << "  ];\n\n  polarPlot = new google.maps.Polygon({\n    paths: triangleCoords,\n    strokeColor: '#FF0000',\n    strokeOpacity: 0.8,\n    strokeWeight: 2,\n    fillColor: '#FF0000',\n    fillOpacity: 0.35\n  });\n\n";
+	f << "  var image = new google.maps.MarkerImage('http://maps.google.com/mapfiles/kml/pal4/icon57.png', null, new google.maps.Point(0,0), new google.maps.Point(16,16));";
+	f << "  var myLatLng = new google.maps.LatLng(" << ref.lat << ", " << ref.lon << ");";
+	f << "  var beachMarker = new google.maps.Marker({\n      position: myLatLng,\n      map: polarMap,\n      icon: image\n  });\n\n";
+	f << "  polarPlot.setMap(polarMap);\n}\n\ngoogle.maps.event.addDomListener(window, 'load', initializePolarPlot);";
+}
+
+
+
+/**
+ * Function writes Javascript code drawing heat map using GoogleMaps API (cells in Morton order).
+ * @param f - output stream
+ */
+void data::renderHeatJS(std::ostream &f)
+{
+	f << "var map, pointarray, heatmap;\n\nvar heatMapData = [\n";
+	
+	const std::vector<tHeatCell> &cells = heatMap.cells();
+	const std::vector<uint8_t> &levels = heatMap.levels();
+	for (size_t i = 0; i < cells.size(); i++)
 	{
-		f << "Airline,Share\n";
+		int iLat, iLon;
+		heatDemorton(cells[i].code, iLat, iLon);
+		int weight = cells[i].weight;
 		
-		if (loadIcaoIata(launchDir + "/data/iata-icao.db") != 0)
+		// block of coarser level is drawn at its center, size is its side in degrees
+		int side = 1 << levels[i];
+		double hLat = (iLat + (side - 1) / 2.0) / 100.0;
+		double hLon = (iLon + (side - 1) / 2.0) / 100.0;
+		
+		f << "  {location: new google.maps.LatLng(" << hLat << ", " << hLon << "), weight: " << weight << ", size: " << side / 100.0 << "}";
+		
+		if (i + 1 < cells.size())
 		{
-			fprintf(stderr, "ERROR: Error while loading iata-icao database!\n");
-			return 1;
+			f << ",\n";
 		}
-			
-		int total = 0;
-		std::map<std::string, int>::iterator airlineIter;
-		for (airlineIter = companyPlot.begin(); airlineIter != companyPlot.end(); ++airlineIter)
+		else
 		{
-			total += airlineIter->second;
+			f << "\n";
 		}
+	}
 		
-		for (airlineIter = companyPlot.begin(); airlineIter != companyPlot.end(); ++airlineIter)
+	f << "];\n\nfunction initialize() {\n  var mapOptions = {\n    zoom: 9,\n    center: new google.maps.LatLng(" << ref.lat << ", " << ref.lon << "),\n    mapTypeId: google.maps.MapTypeId.SATELLITE\n";
+	f << "  };\n\n  map = new google.maps.Map(document.getElementById('map-canvas'),\n      mapOptions);\n\n  var pointArray = new google.maps.MVCArray(heatMapData);\n\n";
+	f << "  heatmap = new google.maps.visualization.HeatmapLayer({\n    data: pointArray\n  });\n\n  var image = new google.maps.MarkerImage('http://maps.google.com/mapfiles/kml/pal4/icon57.png', null, new google.maps.Point(0,0), new google.maps.Point(16,16));";
+	f << "  var myLatLng = new google.maps.LatLng(" << ref.lat << ", " << ref.lon << ");  var beachMarker = new google.maps.Marker({\n      position: myLatLng,\n      map: map,\n      icon: image\n";
+	f << "  });heatmap.setMap(map);\n}\n\nfunction toggleHeatmap() {\n  heatmap.setMap(heatmap.getMap() ? null : map);\n}\n\n";
+	f << "function changeGradient() {\n  var gradient = [\n    'rgba(0, 255, 255, 0)',\n    'rgba(0, 255, 255, 1)',\n    'rgba(0, 191, 255, 1)',\n    'rgba(0, 127, 255, 1)',\n";
+	f << "    'rgba(0, 63, 255, 1)',\n    'rgba(0, 0, 255, 1)',\n    'rgba(0, 0, 223, 1)',\n    'rgba(0, 0, 191, 1)',\n    'rgba(0, 0, 159, 1)',\n    'rgba(0, 0, 127, 1)',\n";
+	f << "    'rgba(63, 0, 91, 1)',\n    'rgba(127, 0, 63, 1)',\n    'rgba(191, 0, 31, 1)',\n    'rgba(255, 0, 0, 1)'\n  ]\n  heatmap.set('gradient', heatmap.get('gradient') ? null : gradient);\n}\n\n";
+	f << "function changeRadius() {\n  heatmap.set('radius', heatmap.get('radius') ? null : 20);\n}\n\nfunction changeOpacity() {\n  heatmap.set('opacity', heatmap.get('opacity') ? null : 0.2);\n";
+	f << "}\n\nfunction mtypeHybrid() {\n	map.setMapTypeId(google.maps.MapTypeId.HYBRID);\n}\n\nfunction mtypeSat() {\n	map.setMapTypeId(google.maps.MapTypeId.SATELLITE);\n}google.maps.event.addDomListener(window, 'load', initialize);";
+}
+
+
+
+/**
+ * Function writes csv data of airline chart for HighCharts API. Iata-icao database has to be loaded.
+ * @param f - output stream
+ * @param cThr - company treshold. If count of company is below or equal treshold, company will not appear in airline chart.
+ */
+void data::renderAirlineCSV(std::ostream &f, int cThr)
+{
+	f << "Airline,Share\n";
+	
+	int total = 0;
+	std::map<std::string, int>::iterator airlineIter;
+	for (airlineIter = companyPlot.begin(); airlineIter != companyPlot.end(); ++airlineIter)
+	{
+		total += airlineIter->second;
+	}
+	
+	for (airlineIter = companyPlot.begin(); airlineIter != companyPlot.end(); ++airlineIter)
+	{
+		std::string name;
+		if ( icaoIata.find(airlineIter->first) == icaoIata.end() )
 		{
-			std::string name;
-			if ( icaoIata.find(airlineIter->first) == icaoIata.end() )
-			{
-				continue;
-			}
-			else
-			{
-				std::vector<std::string> vec = icaoIata[airlineIter->first];
-				name = vec[0];
-			}
-			
-			if (airlineIter->second > cThr)
-			{
-				f << name << "," << (std::round((double(airlineIter->second) / double(total)) * 10000.0 ) / 10000.0) * 100;
-			
-				if (++airlineIter != companyPlot.end())
-				{
-					f << "\n";
-				}
-				airlineIter--;
-			}
-			else
+			continue;
+		}
+		else
+		{
+			std::vector<std::string> vec = icaoIata[airlineIter->first];
+			name = vec[0];
+		}
+		
+		if (airlineIter->second > cThr)
+		{
+			f << name << "," << (std::round((double(airlineIter->second) / double(total)) * 10000.0 ) / 10000.0) * 100;
+		
+			if (++airlineIter != companyPlot.end())
 			{
-				continue;
+				f << "\n";
 			}
+			airlineIter--;
 		}
-		
+		else
+		{
+			continue;
+		}
+	}
+}
+
+
+
+/**
+ * Function writes csv data of altitude chart for HighCharts API.
+ * @param f - output stream
+ */
+void data::renderAltCSV(std::ostream &f)
+{
+	f << "Altitude,Share\n";
+	
+	int total = 0;
+	for (int i = 0; i <= 500; i++)
+	{
+		total += altPlot[i];
+	}
+	
+	for (int i = 0; i <= 500; i++)
+	{
+		f << i*100 << "," << (std::round((double(altPlot[i]) / double(total)) * 10000.0 ) / 10000.0) * 100;
+		if (i != 500)
+		{
+			f << '\n';
+		}
+	}
+}
+
+
+
+/**
+ * Function writes JSON view of statistics (polar range with distances, altitude counts, airline counts).
+ * @param f - output stream
+ */
+void data::renderJSON(std::ostream &f)
+{
+	char buf[96];
+	sprintf(buf, "{\"timestamp\":%ld,\"ref\":[%.4f,%.4f],\"started\":%ld,\n\"polar\":[", (long) std::time(nullptr), ref.lat, ref.lon, (long) getUptime());
+	f << buf;
+	for (int i = 0; i < 360; i++)
+	{
+		sprintf(buf, "%s[%.4f,%.4f,%.1f]", (i > 0) ? "," : "", fixedToDegrees(polarRange[i].lat), fixedToDegrees(polarRange[i].lon), polarDist[i]);
+		f << buf;
+	}
+	
+	f << "],\n\"altitude\":[";
+	for (int i = 0; i <= 500; i++)
+	{
+		f << ((i > 0) ? "," : "") << altPlot[i];
+	}
+	
+	f << "],\n\"airlines\":{";
+	std::map<std::string, int>::iterator companyIter;
+	for (companyIter = companyPlot.begin(); companyIter != companyPlot.end(); ++companyIter)
+	{
+		f << ((companyIter != companyPlot.begin()) ? "," : "") << "\"" << companyIter->first << "\":" << companyIter->second;
+	}
+	
+	// Tracked aircraft - how many have position and how far was the farthest one first seen
+	size_t positioned = 0;
+	unsigned farthest = 0;
+	aircraft.forEach([&](const tAircraftState &a)
+	{
+		if (a.firstRange != AIRCRAFT_NO_RANGE)
+		{
+			positioned++;
+			farthest = std::max(farthest, (unsigned) a.firstRange);
+		}
+	});
+	sprintf(buf, "{\"tracked\":%zu,\"positioned\":%zu,\"evicted\":%llu,\"firstRange\":%.1f}", aircraft.size(), positioned, (unsigned long long) aircraft.getEvictions(), farthest / 10.0);
+	
+	f << "},\n\"cells\":" << heatMap.size() << ",\n\"heat\":{\"budget\":" << heatMap.getBudget() << ",\"compactions\":" << heatMap.getCompactions() << ",\"levels\":[";
+	for (int l = 0; l <= HEAT_MAX_LEVEL; l++)
+	{
+		f << ((l > 0) ? "," : "") << heatMap.levelSize(l);
+	}
+	f << "]},\n\"aircraft\":" << buf;
+	
+	// Estimated numbers of distinct aircraft
+	sprintf(buf, ",\n\"distinct\":{\"total\":%.0f,\"hour\":%.0f,\"airlines\":{", distinct.getTotal(), distinct.getHour(std::time(nullptr) / 3600));
+	f << buf;
+	std::map<std::string, hyperLogLog>::const_iterator airlineIter;
+	for (airlineIter = distinct.getAirlines().begin(); airlineIter != distinct.getAirlines().end(); ++airlineIter)
+	{
+		sprintf(buf, "%s\"%s\":%.0f", (airlineIter != distinct.getAirlines().begin()) ? "," : "", airlineIter->first.c_str(), airlineIter->second.estimate());
+		f << buf;
+	}
+	
+	f << "}},\n\"speed\":[";
+	for (int i = 0; i < SPEED_BINS; i++)
+	{
+		f << ((i > 0) ? "," : "") << speedPlot[i];
+	}
+	f << "],\n\"verticalRate\":[";
+	for (int i = 0; i < VRATE_BINS; i++)
+	{
+		f << ((i > 0) ? "," : "") << vratePlot[i];
+	}
+	f << "],\n\"surfaceCells\":" << surfaceMap.size();
+	
+	sprintf(buf, ",\n\"shedding\":{\"sampling\":%u,\"peakSampling\":%u,\"shedPositions\":%llu}}\n", sampling, peakSampling, (unsigned long long) shedPositions);
+	f << buf;
+}
+
+
+
+/**
+ * Function returns version of statistics section, which is increased with every change of section.
+ * @param section - section id (SNAP_POLAR, SNAP_ALT, SNAP_HEAT, SNAP_COMPANY)
+ * @return version
+ */
+uint64_t data::getVersion(int section)
+{
+	return (section == VERSION_MOTION) ? motionVersion : sectionVersion[section];
+}
+
+
+
+/**
+ * Function converts instance data and produces files with
+ * Javascript code using GoogleMaps API to display collected data.
+ * @param dir - directory to create JS files
+ * @param launchDir - directory of executable
+ * @param cThr - company treshold. If count of company is below or equal treshold, company will not appear in airline chart.
+ * @return zero if success, nonzero otherwise
+ */
+int data::createJS(std::string dir, std::string launchDir, int cThr)
+{
+	// Create rangePlot
+	std::ofstream f;
+	std::string fpath = dir + "/polarPlot.js";
+	f.open(fpath);
+	if (f.is_open())
+	{
+		renderPolarJS(f);
+		f.close();
+	}
+	else
+	{
+		fprintf(stderr, "ERROR: Unable to open output file: [%s]\n", fpath.c_str());
+		return 1;
+	}
+	
+	
+	// Create heatMap
+	fpath = dir + "/heatMap.js";
+	f.open(fpath);
+	if (f.is_open())
+	{
+		renderHeatJS(f);
+		f.close();
+	}
+	else
+	{
+		fprintf(stderr, "ERROR: Unable to open output file: [%s]\n", fpath.c_str());
+		return 1;
+	}
+	
+	
+	//Create csv file for highcharts airline chart
+	if (loadIcaoIata(launchDir + "/data/iata-icao.db") != 0)
+	{
+		fprintf(stderr, "ERROR: Error while loading iata-icao database!\n");
+		return 1;
+	}
+	
+	fpath = dir + "/airline.csv";
+	f.open(fpath);
+	if (f.is_open())
+	{
+		renderAirlineCSV(f, cThr);
 		f.close();
 	}
 	else
@@ -865,23 +2883,7 @@ int data::createJS(std::string dir, std::string launchDir, int cThr)
 	f.open(fpath);
 	if (f.is_open())
 	{
-		f << "Altitude,Share\n";
-		
-		int total = 0;
-		for (int i = 0; i <= 500; i++)
-		{
-			total += altPlot[i];
-		}
-		
-		for (int i = 0; i <= 500; i++)
-		{
-			f << i*100 << "," << (std::round((double(altPlot[i]) / double(total)) * 10000.0 ) / 10000.0) * 100;
-			if (i != 500)
-			{
-				f << '\n';
-			}
-		}
-		
+		renderAltCSV(f);
 		f.close();
 	}
 	else
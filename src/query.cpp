@@ -0,0 +1,289 @@
+/* DumpStats - dump1090 feed statistical data collector
+ * Copyright (C) 2015 Marcel Kebisek
+ * Contact: marcel.kebisek@gmail.com
+ * 
+ * This file is part of DumpStats.
+ * 
+ * DumpStats is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * DumpStats is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with DumpStats. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "snapshot.H"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+// Read-only mapping of snapshot file
+typedef struct snapMap
+{
+	const char *base;
+	size_t size;
+	const tSnapHeader *header;
+} tSnapMap;
+
+
+
+/**
+ * Function returns pointer to first record of section.
+ * @param m - mapped snapshot
+ * @param section - section id
+ * @return pointer to records
+ */
+template<class T>
+static const T *sectionPtr(const tSnapMap &m, int section)
+{
+	return reinterpret_cast<const T *>(m.base + m.header->sections[section].offset);
+}
+
+
+
+/**
+ * Function maps snapshot file and checks its header and section bounds.
+ * @param path - path to snapshot file
+ * @param m - mapping to fill
+ * @return zero if success, nonzero otherwise
+ */
+static int mapSnapshot(const std::string &path, tSnapMap &m)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd == -1)
+	{
+		fprintf(stderr, "ERROR: Unable to open snapshot file %s!\n", path.c_str());
+		return 1;
+	}
+	
+	struct stat st;
+	if ((fstat(fd, &st) == -1) || ((size_t) st.st_size < sizeof(tSnapHeader)))
+	{
+		fprintf(stderr, "ERROR: %s is not a snapshot file!\n", path.c_str());
+		::close(fd);
+		return 1;
+	}
+	
+	m.size = st.st_size;
+	void *p = mmap(NULL, m.size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (p == MAP_FAILED)
+	{
+		fprintf(stderr, "ERROR: Unable to map snapshot file %s!\n", path.c_str());
+		return 1;
+	}
+	
+	m.base = (const char *) p;
+	m.header = (const tSnapHeader *) p;
+	
+	if ((memcmp(m.header->magic, SNAP_MAGIC, sizeof(m.header->magic)) != 0) || (m.header->version != SNAP_VERSION) || (m.header->sectionCount != SNAP_SECTIONS))
+	{
+		fprintf(stderr, "ERROR: %s is not a snapshot file of supported version!\n", path.c_str());
+		munmap(p, m.size);
+		return 1;
+	}
+	
+	const size_t recordSize[SNAP_SECTIONS] = {sizeof(tSnapPolar), sizeof(int32_t), sizeof(tHeatCell), sizeof(tSnapCompany)};
+	for (int i = 0; i < SNAP_SECTIONS; i++)
+	{
+		const tSnapSection &s = m.header->sections[i];
+		if ((s.offset > m.size) || (s.count > (m.size - s.offset) / recordSize[i]))
+		{
+			fprintf(stderr, "ERROR: Snapshot file %s is truncated!\n", path.c_str());
+			munmap(p, m.size);
+			return 1;
+		}
+	}
+	
+	return 0;
+}
+
+
+
+/**
+ * Function prints snapshot summary.
+ * @param m - mapped snapshot
+ */
+static void queryInfo(const tSnapMap &m)
+{
+	const tSnapHeader *h = m.header;
+	std::time_t t = h->timestamp;
+	char date[64];
+	strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", localtime(&t));
+	
+	const tSnapPolar *polar = sectionPtr<tSnapPolar>(m, SNAP_POLAR);
+	double maxDist = 0;
+	int maxBearing = 0;
+	for (uint64_t i = 0; i < h->sections[SNAP_POLAR].count; i++)
+	{
+		if (polar[i].dist > maxDist)
+		{
+			maxDist = polar[i].dist;
+			maxBearing = i;
+		}
+	}
+	
+	printf("created:   %s\n", date);
+	printf("reference: %f %f\n", h->refLat, h->refLon);
+	printf("max range: %.1f km at %d deg\n", maxDist, maxBearing);
+	printf("cells:     %lu\n", (unsigned long) h->sections[SNAP_HEAT].count);
+	printf("airlines:  %lu\n", (unsigned long) h->sections[SNAP_COMPANY].count);
+}
+
+
+
+/**
+ * Function prints top N airlines with their share of all flights.
+ * @param m - mapped snapshot
+ * @param n - number of airlines to print
+ */
+static void queryAirlines(const tSnapMap &m, uint64_t n)
+{
+	const tSnapCompany *c = sectionPtr<tSnapCompany>(m, SNAP_COMPANY);
+	uint64_t count = m.header->sections[SNAP_COMPANY].count;
+	
+	double total = 0;
+	for (uint64_t i = 0; i < count; i++)
+	{
+		total += c[i].count;
+	}
+	
+	for (uint64_t i = 0; (i < n) && (i < count); i++)
+	{
+		printf("%-4.4s %8d %6.2f%%\n", c[i].code, c[i].count, total > 0 ? 100.0 * c[i].count / total : 0.0);
+	}
+}
+
+
+
+/**
+ * Function prints farthest position on given bearing.
+ * @param m - mapped snapshot
+ * @param bearing - bearing in degrees
+ * @return zero if success, nonzero otherwise
+ */
+static int queryRange(const tSnapMap &m, int bearing)
+{
+	if ((bearing < 0) || ((uint64_t) bearing >= m.header->sections[SNAP_POLAR].count))
+	{
+		fprintf(stderr, "ERROR: Bearing has to be between 0 and 359!\n");
+		return 1;
+	}
+	
+	const tSnapPolar &p = sectionPtr<tSnapPolar>(m, SNAP_POLAR)[bearing];
+	printf("%d %f %f %.1f\n", bearing, p.lat, p.lon, p.dist);
+	return 0;
+}
+
+
+
+/**
+ * Function prints heat map cells inside bounding box. Cells are stored in Morton order,
+ * so only runs of cells crossing the box are read (see heatRange()).
+ * @param m - mapped snapshot
+ * @param lat1, lon1, lat2, lon2 - corners of bounding box in decimal degrees
+ * @param level - cells are merged into blocks of 2^level x 2^level cells
+ */
+static void queryCells(const tSnapMap &m, double lat1, double lon1, double lat2, double lon2, int level)
+{
+	// cells with center inside box, tolerance absorbs binary representation of decimal bounds
+	int latLo = (int) ceil(std::min(lat1, lat2) * 100 - 1e-6);
+	int latHi = (int) floor(std::max(lat1, lat2) * 100 + 1e-6);
+	int lonLo = (int) ceil(std::min(lon1, lon2) * 100 - 1e-6);
+	int lonHi = (int) floor(std::max(lon1, lon2) * 100 + 1e-6);
+	
+	std::vector<tHeatCell> cells;
+	heatRange(sectionPtr<tHeatCell>(m, SNAP_HEAT), m.header->sections[SNAP_HEAT].count, latLo, lonLo, latHi, lonHi, cells);
+	
+	std::vector<tHeatCell> blocks;
+	heatDownsample(cells.data(), cells.size(), level, blocks);
+	
+	int64_t weight = 0;
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		int latQ, lonQ;
+		heatDemorton(blocks[i].code, latQ, lonQ);
+		printf("%.2f %.2f %d\n", latQ / 100.0, lonQ / 100.0, blocks[i].weight);
+		weight += blocks[i].weight;
+	}
+	
+	printf("%lu cells, weight %ld\n", (unsigned long) blocks.size(), (long) weight);
+}
+
+
+
+/**
+ * Function maps snapshot and answers query. Supported queries:
+ *   info                         snapshot summary
+ *   airlines[:N]                 top N airlines (default 20)
+ *   range:BEARING                farthest position on bearing
+ *   cells:LAT1,LON1,LAT2,LON2[:LEVEL]  heat map cells inside bounding box,
+ *                                      optionally merged into blocks of 2^LEVEL x 2^LEVEL cells
+ * @param path - path to snapshot file
+ * @param query - query string
+ * @return zero if success, nonzero otherwise
+ */
+int runQuery(const std::string &path, const std::string &query)
+{
+	tSnapMap m;
+	if (mapSnapshot(path, m))
+	{
+		return 1;
+	}
+	
+	std::string name = query.substr(0, query.find(':'));
+	std::string arg = (query.find(':') != std::string::npos) ? query.substr(query.find(':') + 1) : "";
+	int result = 0;
+	
+	if (name == "info")
+	{
+		queryInfo(m);
+	}
+	else if (name == "airlines")
+	{
+		queryAirlines(m, arg.empty() ? 20 : strtoul(arg.c_str(), NULL, 10));
+	}
+	else if ((name == "range") && (! arg.empty()))
+	{
+		result = queryRange(m, atoi(arg.c_str()));
+	}
+	else if (name == "cells")
+	{
+		double lat1, lon1, lat2, lon2;
+		int level = 0;
+		int values = sscanf(arg.c_str(), "%lf,%lf,%lf,%lf:%d", &lat1, &lon1, &lat2, &lon2, &level);
+		if ((values >= 4) && (level >= 0) && (level <= 15))
+		{
+			queryCells(m, lat1, lon1, lat2, lon2, level);
+		}
+		else
+		{
+			fprintf(stderr, "ERROR: Bounding box has to be given as LAT1,LON1,LAT2,LON2[:LEVEL] (LEVEL 0-15)!\n");
+			result = 1;
+		}
+	}
+	else
+	{
+		fprintf(stderr, "ERROR: Unknown query %s!\n", query.c_str());
+		result = 1;
+	}
+	
+	munmap((void *) m.base, m.size);
+	return result;
+}
@@ -0,0 +1,411 @@
+/* DumpStats - dump1090 feed statistical data collector
+ * Copyright (C) 2015 Marcel Kebisek
+ * Contact: marcel.kebisek@gmail.com
+ * 
+ * This file is part of DumpStats.
+ * 
+ * DumpStats is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * DumpStats is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with DumpStats. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "recorder.H"
+#include "trace.H"
+
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <fstream>
+#include <unistd.h>
+#include <fcntl.h>
+
+
+/**
+ * Constructor.
+ * Starts writer thread, first segment is created with first recorded data.
+ * @param dir - directory to store segment files in
+ * @param rotateSecs - period of segment rotation in seconds
+ * @param compress - compress segments with gzip
+ */
+feedRecorder::feedRecorder(std::string dir, int rotateSecs, bool compress)
+{
+	this->dir = dir;
+	this->rotateSecs = rotateSecs;
+	this->compress = compress;
+	
+	active.bytes.reserve(RECORD_BLOCK_SIZE);
+	active.timestamp = 0;
+	active.newSegment = true;
+	segmentStart = 0;
+	lastAppend = 0;
+	
+	stopping = false;
+	dropping = false;
+	droppedBlocks = 0;
+	droppedBytes = 0;
+	segFd = -1;
+	idxFile = NULL;
+	segOffset = 0;
+	rawOffset = 0;
+	
+	writer = std::thread(&feedRecorder::writerLoop, this);
+}
+
+
+
+/**
+ * Destructor.
+ */
+feedRecorder::~feedRecorder()
+{
+	close();
+}
+
+
+
+/**
+ * Function appends received data to active block. Block is handed to writer thread when it is full,
+ * when it waits longer than RECORD_FLUSH_SECS or when segment rotation is due.
+ * Only memory copy is done in caller thread.
+ * @param buf - received data
+ * @param len - length of data
+ * @param now - time of reception
+ */
+void feedRecorder::append(const char *buf, size_t len, std::time_t now)
+{
+	TRACE_SCOPE("record");
+	
+	if (segmentStart == 0)
+	{
+		segmentStart = now;
+		lastAppend = now;
+	}
+	
+	if (now >= segmentStart + rotateSecs)
+	{
+		// incomplete last line is carried into first block of new segment
+		flushActive(false);
+		active.newSegment = true;
+		segmentStart = now;
+	}
+	else if ((! active.bytes.empty()) && (now - active.timestamp >= RECORD_FLUSH_SECS))
+	{
+		flushActive(false);
+	}
+	
+	while (len > 0)
+	{
+		if (active.bytes.empty())
+		{
+			active.timestamp = now;
+		}
+		
+		size_t n = RECORD_BLOCK_SIZE - active.bytes.size();
+		if (n > len)
+		{
+			n = len;
+		}
+		active.bytes.insert(active.bytes.end(), buf, buf + n);
+		buf += n;
+		len -= n;
+		
+		if (active.bytes.size() >= RECORD_BLOCK_SIZE)
+		{
+			flushActive(false);
+		}
+	}
+	
+	lastAppend = now;
+}
+
+
+
+/**
+ * Function hands active block to writer thread.
+ * Unless all is set, incomplete last line is moved into new active block (block without complete
+ * line stays active), so every block (and index entry) starts at line boundary.
+ * If RECORD_MAX_PENDING blocks are waiting already (disk is slow or stalled), block is dropped
+ * and counted, so memory of reader stays bounded. Segment is recorded with gap then.
+ * @param all - hand over whole block including incomplete line
+ */
+void feedRecorder::flushActive(bool all)
+{
+	if (active.bytes.empty())
+	{
+		return;
+	}
+	
+	tRecordBlock block;
+	block.timestamp = active.timestamp;
+	block.newSegment = active.newSegment;
+	block.bytes.reserve(RECORD_BLOCK_SIZE);
+	
+	size_t len = active.bytes.size();
+	if (! all)
+	{
+		const char *nl = (const char *) memrchr(active.bytes.data(), '\n', len);
+		if (nl != NULL)
+		{
+			len = (nl - active.bytes.data()) + 1;
+		}
+		else if (len < RECORD_BLOCK_SIZE)
+		{
+			// no complete line yet, block waits for rest of it (overlong line is handed over whole)
+			return;
+		}
+	}
+	
+	// remaining tail becomes start of next block
+	block.bytes.assign(active.bytes.begin() + len, active.bytes.end());
+	active.bytes.resize(len);
+	std::swap(block.bytes, active.bytes);
+	
+	// incomplete line was received by this or previous append
+	active.newSegment = false;
+	active.timestamp = lastAppend;
+	
+	std::unique_lock<std::mutex> guard(lock);
+	if (pending.size() >= RECORD_MAX_PENDING)
+	{
+		if (! dropping)
+		{
+			fprintf(stderr, "Recorder: writing of segments falls behind feed, blocks are dropped.\n");
+			dropping = true;
+		}
+		droppedBlocks++;
+		droppedBytes += block.bytes.size();
+		
+		// rotation is not lost with dropped block
+		active.newSegment = block.newSegment;
+		return;
+	}
+	dropping = false;
+	pending.push_back(std::move(block));
+	ready.notify_one();
+}
+
+
+
+/**
+ * Function returns number of blocks dropped because RECORD_MAX_PENDING blocks were waiting for writer thread.
+ * @param blocks - set to number of dropped blocks
+ * @param bytes - set to number of dropped bytes
+ */
+void feedRecorder::getDropped(uint64_t &blocks, uint64_t &bytes)
+{
+	std::unique_lock<std::mutex> guard(lock);
+	blocks = droppedBlocks;
+	bytes = droppedBytes;
+}
+
+
+
+/**
+ * Function writes all remaining data and stops writer thread.
+ */
+void feedRecorder::close()
+{
+	if (! writer.joinable())
+	{
+		return;
+	}
+	
+	flushActive(true);
+	
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		stopping = true;
+		ready.notify_one();
+	}
+	writer.join();
+	closeSegment();
+}
+
+
+
+/**
+ * Writer thread - writes blocks handed by reader until recorder is closed.
+ */
+void feedRecorder::writerLoop()
+{
+	TRACE_THREAD("recorder");
+	
+	while (true)
+	{
+		tRecordBlock block;
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			while (pending.empty() && !stopping)
+			{
+				ready.wait(guard);
+			}
+			if (pending.empty())
+			{
+				return;
+			}
+			block = std::move(pending.front());
+			pending.pop_front();
+		}
+		
+		writeBlock(block);
+	}
+}
+
+
+
+/**
+ * Function writes single block into current segment (opening new one if needed) and adds index entry.
+ * @param block - block to be written
+ */
+void feedRecorder::writeBlock(tRecordBlock &block)
+{
+	TRACE_SCOPE("segment write");
+	
+	if (block.newSegment || (segFd < 0))
+	{
+		closeSegment();
+		if (openSegment(block.timestamp) != 0)
+		{
+			return;
+		}
+	}
+	
+	const unsigned char *out = (const unsigned char *) block.bytes.data();
+	size_t outLen = block.bytes.size();
+	
+	if (compress)
+	{
+		// every block is independent gzip member
+		z_stream zs;
+		memset(&zs, 0, sizeof(zs));
+		deflateInit2(&zs, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+		
+		zbuf.resize(deflateBound(&zs, block.bytes.size()));
+		zs.next_in = (unsigned char *) block.bytes.data();
+		zs.avail_in = block.bytes.size();
+		zs.next_out = zbuf.data();
+		zs.avail_out = zbuf.size();
+		deflate(&zs, Z_FINISH);
+		
+		out = zbuf.data();
+		outLen = zbuf.size() - zs.avail_out;
+		deflateEnd(&zs);
+	}
+	
+	size_t done = 0;
+	while (done < outLen)
+	{
+		ssize_t n = write(segFd, out + done, outLen - done);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			fprintf(stderr, "ERROR: Unable to write recorded segment!\n");
+			return;
+		}
+		done += n;
+	}
+	
+	fprintf(idxFile, "%ld %lu %lu\n", (long) block.timestamp, (unsigned long) segOffset, (unsigned long) rawOffset);
+	fflush(idxFile);
+	
+	segOffset += outLen;
+	rawOffset += block.bytes.size();
+}
+
+
+
+/**
+ * Function opens new segment file and its index.
+ * Name of segment is derived from time of its first block: DIR/sbs-YYYYMMDD-HHMMSS.log[.gz]
+ * @param t - time of first block
+ * @return zero if success, nonzero otherwise
+ */
+int feedRecorder::openSegment(std::time_t t)
+{
+	char name[64];
+	strftime(name, sizeof(name), "/sbs-%Y%m%d-%H%M%S.log", gmtime(&t));
+	
+	std::string path = dir + name + (compress ? ".gz" : "");
+	segFd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (segFd < 0)
+	{
+		fprintf(stderr, "ERROR: Unable to open segment file: [%s]\n", path.c_str());
+		return 1;
+	}
+	
+	idxFile = fopen((path + ".idx").c_str(), "w");
+	if (idxFile == NULL)
+	{
+		fprintf(stderr, "ERROR: Unable to open segment index: [%s.idx]\n", path.c_str());
+		::close(segFd);
+		segFd = -1;
+		return 1;
+	}
+	
+	segOffset = 0;
+	rawOffset = 0;
+	return 0;
+}
+
+
+
+/**
+ * Function closes current segment file and its index.
+ */
+void feedRecorder::closeSegment()
+{
+	if (segFd >= 0)
+	{
+		::close(segFd);
+		segFd = -1;
+	}
+	if (idxFile != NULL)
+	{
+		fclose(idxFile);
+		idxFile = NULL;
+	}
+}
+
+
+
+/**
+ * Function loads index of recorded segment.
+ * @param segment - path to segment file (index is expected in SEGMENT.idx)
+ * @param index - vector to be filled with index entries
+ * @return zero if success, nonzero if index cannot be read
+ */
+int loadRecordIndex(const std::string &segment, std::vector<tRecordIndex> &index)
+{
+	FILE *f = fopen((segment + ".idx").c_str(), "r");
+	if (f == NULL)
+	{
+		return 1;
+	}
+	
+	long t;
+	unsigned long offset;
+	unsigned long raw;
+	while (fscanf(f, "%ld %lu %lu", &t, &offset, &raw) == 3)
+	{
+		tRecordIndex entry;
+		entry.timestamp = t;
+		entry.offset = offset;
+		entry.rawOffset = raw;
+		index.push_back(entry);
+	}
+	
+	fclose(f);
+	return 0;
+}
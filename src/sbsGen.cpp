@@ -0,0 +1,442 @@
+/* DumpStats - dump1090 feed statistical data collector
+ * Copyright (C) 2015 Marcel Kebisek
+ * Contact: marcel.kebisek@gmail.com
+ * 
+ * This file is part of DumpStats.
+ * 
+ * DumpStats is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * DumpStats is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with DumpStats. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sbsGen.H"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <ctime>
+
+
+// Kilometers per degree of latitude
+#define GEN_KM_PER_DEG 111.195
+
+// Airlines of generated callsigns
+static const char *genAirlines[] = {"RYR", "WZZ", "DLH", "AUA", "LOT", "BAW", "AFR", "KLM", "EZY", "SAS", "THY", "UAE", "QTR", "SWR", "CSA", "TVS", "UAL", "AAL", "DAL", "EWG", "BEL", "TAP", "IBE", "FIN"};
+
+
+
+/**
+ * Function appends unsigned number to text.
+ * @param p - end of text
+ * @param v - number
+ * @return new end of text
+ */
+static char *genUInt(char *p, uint64_t v)
+{
+	char digits[20];
+	int n = 0;
+	do
+	{
+		digits[n++] = '0' + (v % 10);
+		v /= 10;
+	}
+	while (v > 0);
+	
+	while (n > 0)
+	{
+		*p++ = digits[--n];
+	}
+	return p;
+}
+
+
+
+/**
+ * Function appends signed number to text.
+ * @param p - end of text
+ * @param v - number
+ * @return new end of text
+ */
+static char *genInt(char *p, int64_t v)
+{
+	if (v < 0)
+	{
+		*p++ = '-';
+		v = -v;
+	}
+	return genUInt(p, v);
+}
+
+
+
+/**
+ * Function appends decimal number with 5 decimal places (as coordinates of dump1090) to text.
+ * @param p - end of text
+ * @param v - number
+ * @return new end of text
+ */
+static char *genFixed5(char *p, double v)
+{
+	int64_t q = llround(v * 100000);
+	if (q < 0)
+	{
+		*p++ = '-';
+		q = -q;
+	}
+	p = genUInt(p, q / 100000);
+	*p++ = '.';
+	int64_t frac = q % 100000;
+	for (int64_t d = 10000; d > 0; d /= 10)
+	{
+		*p++ = '0' + (frac / d) % 10;
+	}
+	return p;
+}
+
+
+
+/**
+ * Constructor. Aircraft are spawned at random positions of coverage area.
+ * @param lat - latitude of reference point
+ * @param lon - longitude of reference point
+ * @param radius - radius of coverage area (km)
+ * @param count - number of aircraft
+ * @param mix - weights of MSG,1-8
+ * @param seed - seed of random numbers
+ */
+sbsGenerator::sbsGenerator(double lat, double lon, double radius, unsigned count, const unsigned mix[GEN_TYPES], uint64_t seed)
+{
+	refLat = lat;
+	refLon = lon;
+	this->radius = radius;
+	rng = seed * 0x9E3779B97F4A7C15ull + 1;
+	now = 0;
+	stampLen = 0;
+	
+	mixTotal = 0;
+	for (int i = 0; i < GEN_TYPES; i++)
+	{
+		mixTotal += mix[i];
+		mixLimit[i] = mixTotal;
+	}
+	
+	// surface traffic only if mix contains surface positions, at least one aircraft stays airborne
+	size_t surfaceCount = (mix[1] > 0) ? (count + GEN_SURFACE_RATIO - 1) / GEN_SURFACE_RATIO : 0;
+	if ((surfaceCount >= count) && (count > 0))
+	{
+		surfaceCount = count - 1;
+	}
+	airborneCount = count - surfaceCount;
+	
+	aircraft.resize(count);
+	for (size_t i = 0; i < aircraft.size(); i++)
+	{
+		tGenAircraft &a = aircraft[i];
+		
+		// odd multiplier is bijection of 24-bit numbers, so addresses are unique
+		uint32_t icao = ((uint32_t) (i + seed) * 0x9E3779B1u) & 0xFFFFFF;
+		const char *hexDigits = "0123456789ABCDEF";
+		for (int j = 0; j < 6; j++)
+		{
+			a.hex[j] = hexDigits[(icao >> (20 - 4 * j)) & 0x0F];
+		}
+		
+		if (next() % 100 < GEN_PRIVATE_SHARE)
+		{
+			snprintf(a.callsign, sizeof(a.callsign), "OM%c%c%c", (char) ('A' + next() % 26), (char) ('A' + next() % 26), (char) ('A' + next() % 26));
+		}
+		else
+		{
+			snprintf(a.callsign, sizeof(a.callsign), "%s%u", genAirlines[next() % (sizeof(genAirlines) / sizeof(genAirlines[0]))], (unsigned) (1 + next() % 9999));
+		}
+		
+		for (int j = 0; j < 4; j++)
+		{
+			a.squawk[j] = '0' + next() % 8;
+		}
+		
+		a.surface = (i >= airborneCount);
+		spawn(a);
+	}
+}
+
+
+
+/**
+ * Function parses message mix.
+ * @param text - weights of message types "TYPE:WEIGHT,..." (types 1-8, missing types have zero weight)
+ * @param mix - weights of MSG,1-8
+ * @return zero if success, nonzero otherwise
+ */
+int sbsGenerator::parseMix(const char *text, unsigned mix[GEN_TYPES])
+{
+	for (int i = 0; i < GEN_TYPES; i++)
+	{
+		mix[i] = 0;
+	}
+	
+	unsigned total = 0;
+	const char *p = text;
+	while (*p != '\0')
+	{
+		char *end;
+		long type = strtol(p, &end, 10);
+		if ((end == p) || (*end != ':') || (type < 1) || (type > GEN_TYPES))
+		{
+			return 1;
+		}
+		p = end + 1;
+		long weight = strtol(p, &end, 10);
+		if ((end == p) || (weight < 0) || ((*end != ',') && (*end != '\0')))
+		{
+			return 1;
+		}
+		mix[type - 1] = weight;
+		total += weight;
+		p = (*end == ',') ? end + 1 : end;
+	}
+	
+	return (total == 0) ? 1 : 0;
+}
+
+
+
+/**
+ * Function returns next random number (xorshift64*).
+ * @return random number
+ */
+uint64_t sbsGenerator::next()
+{
+	rng ^= rng >> 12;
+	rng ^= rng << 25;
+	rng ^= rng >> 27;
+	return rng * 0x2545F4914F6CDD1Dull;
+}
+
+
+
+/**
+ * Function returns uniformly distributed random number of interval.
+ * @param from - start of interval
+ * @param to - end of interval
+ * @return random number
+ */
+double sbsGenerator::uniform(double from, double to)
+{
+	return from + (to - from) * ((next() >> 11) * (1.0 / 9007199254740992.0));
+}
+
+
+
+/**
+ * Function places aircraft at random position of its area (coverage area or airport) with random state.
+ * @param a - aircraft
+ */
+void sbsGenerator::spawn(tGenAircraft &a)
+{
+	double area = a.surface ? GEN_SURFACE_RADIUS : radius;
+	double dist = area * sqrt(uniform(0, 1));
+	double bearing = uniform(0, 2 * M_PI);
+	a.lat = refLat + dist * cos(bearing) / GEN_KM_PER_DEG;
+	a.lon = refLon + dist * sin(bearing) / (GEN_KM_PER_DEG * cos(a.lat * M_PI / 180));
+	a.track = uniform(0, 360);
+	a.moved = now;
+	
+	if (a.surface)
+	{
+		a.speed = uniform(0, 25);
+		a.alt = 0;
+		a.vrate = 0;
+	}
+	else
+	{
+		a.speed = uniform(250, 500);
+		a.alt = uniform(1000, 41000);
+		a.vrate = (next() % 10 < 6) ? 0 : (int) ((next() % 40 + 8) * 64) * ((next() & 1) ? 1 : -1);
+	}
+}
+
+
+
+/**
+ * Function moves aircraft by time elapsed since its last move. Aircraft reaching edge of its area turns back
+ * towards reference point, aircraft reaching lowest or highest altitude levels off.
+ * @param a - aircraft
+ */
+void sbsGenerator::move(tGenAircraft &a)
+{
+	double dt = now - a.moved;
+	a.moved = now;
+	if (dt <= 0)
+	{
+		return;
+	}
+	
+	double dist = a.speed * 1.852 * dt / 3600;
+	double trackRad = a.track * M_PI / 180;
+	a.lat += dist * cos(trackRad) / GEN_KM_PER_DEG;
+	a.lon += dist * sin(trackRad) / (GEN_KM_PER_DEG * cos(a.lat * M_PI / 180));
+	
+	double north = (a.lat - refLat) * GEN_KM_PER_DEG;
+	double east = (a.lon - refLon) * GEN_KM_PER_DEG * cos(a.lat * M_PI / 180);
+	double area = a.surface ? GEN_SURFACE_RADIUS : radius;
+	if (north * north + east * east > area * area)
+	{
+		double back = atan2(-east, -north) * 180 / M_PI;
+		a.track = fmod(back + uniform(-30, 30) + 360, 360);
+	}
+	
+	a.alt += a.vrate * dt / 60;
+	if (((a.alt < 1000) && (a.vrate < 0)) || ((a.alt > 41000) && (a.vrate > 0)))
+	{
+		a.vrate = 0;
+	}
+}
+
+
+
+/**
+ * Function sets generator time and wall clock time written into date and time fields of messages.
+ * @param seconds - generator time (seconds from start)
+ * @param wall - wall clock time
+ */
+void sbsGenerator::setTime(double seconds, const struct timespec &wall)
+{
+	now = seconds;
+	
+	struct tm t;
+	localtime_r(&wall.tv_sec, &t);
+	char date[32];
+	snprintf(date, sizeof(date), "%04d/%02d/%02d,%02d:%02d:%02d.%03d", t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec, (int) (wall.tv_nsec / 1000000));
+	stampLen = snprintf(stamp, sizeof(stamp), "%s,%s,", date, date);
+}
+
+
+
+/**
+ * Function generates messages of random aircraft and types drawn by message mix.
+ * Position (MSG,2) belongs to aircraft on surface (airborne position is generated without surface traffic),
+ * airborne position (MSG,3) to airborne one, other types to any aircraft.
+ * @param count - number of messages
+ * @param out - text messages are appended to
+ */
+void sbsGenerator::generate(size_t count, std::string &out)
+{
+	char line[256];
+	
+	for (size_t n = 0; n < count; n++)
+	{
+		unsigned w = next() % mixTotal;
+		int type = 0;
+		while (w >= mixLimit[type])
+		{
+			type++;
+		}
+		type++;
+		
+		size_t i;
+		if ((type == 2) && (airborneCount < aircraft.size()))
+		{
+			i = airborneCount + next() % (aircraft.size() - airborneCount);
+		}
+		else if ((type == 3) || (type == 2))
+		{
+			type = 3;
+			i = next() % airborneCount;
+		}
+		else
+		{
+			i = next() % aircraft.size();
+		}
+		tGenAircraft &a = aircraft[i];
+		
+		char *p = line;
+		memcpy(p, "MSG,", 4);
+		p += 4;
+		*p++ = '0' + type;
+		memcpy(p, ",111,11111,", 11);
+		p += 11;
+		memcpy(p, a.hex, 6);
+		p += 6;
+		memcpy(p, ",111111,", 8);
+		p += 8;
+		memcpy(p, stamp, stampLen);
+		p += stampLen;
+		
+		// callsign, altitude, ground speed, track, latitude, longitude, vertical rate, squawk, flags
+		switch (type)
+		{
+			case 1:
+				p = stpcpy(p, a.callsign);
+				p = stpcpy(p, ",,,,,,,,0,0,0,0");
+				break;
+			case 2:
+				move(a);
+				*p++ = ',';
+				*p++ = ',';
+				p = genInt(p, lround(a.speed));
+				*p++ = ',';
+				p = genInt(p, lround(a.track));
+				*p++ = ',';
+				p = genFixed5(p, a.lat);
+				*p++ = ',';
+				p = genFixed5(p, a.lon);
+				p = stpcpy(p, ",,,0,0,0,-1");
+				break;
+			case 3:
+				move(a);
+				*p++ = ',';
+				p = genInt(p, lround(a.alt / 25) * 25);
+				*p++ = ',';
+				*p++ = ',';
+				*p++ = ',';
+				p = genFixed5(p, a.lat);
+				*p++ = ',';
+				p = genFixed5(p, a.lon);
+				p = stpcpy(p, ",,,0,0,0,0");
+				break;
+			case 4:
+				*p++ = ',';
+				*p++ = ',';
+				p = genInt(p, lround(a.speed));
+				*p++ = ',';
+				p = genInt(p, lround(a.track));
+				*p++ = ',';
+				*p++ = ',';
+				*p++ = ',';
+				p = genInt(p, a.vrate);
+				p = stpcpy(p, ",,0,0,0,0");
+				break;
+			case 6:
+				*p++ = ',';
+				p = genInt(p, lround(a.alt / 25) * 25);
+				p = stpcpy(p, ",,,,,,");
+				memcpy(p, a.squawk, 4);
+				p += 4;
+				p = stpcpy(p, ",0,0,0,0");
+				break;
+			case 5:
+			case 7:
+				*p++ = ',';
+				p = genInt(p, lround(a.alt / 25) * 25);
+				p = stpcpy(p, ",,,,,,,,,,0");
+				break;
+			default:
+				p = stpcpy(p, ",,,,,,,,,,,0");
+				break;
+		}
+		*p++ = '\n';
+		
+		out.append(line, p - line);
+	}
+}
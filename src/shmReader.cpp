@@ -0,0 +1,136 @@
+/* DumpStats - dump1090 feed statistical data collector
+ * Copyright (C) 2015 Marcel Kebisek
+ * Contact: marcel.kebisek@gmail.com
+ * 
+ * This file is part of DumpStats.
+ * 
+ * DumpStats is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * DumpStats is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with DumpStats. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// dumpStatsShm - prints live statistics published by collector into shared memory segment (-M NAME)
+
+#include "liveStats.H"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+
+// Print help message
+void printHelp()
+{
+	printf("\nusage: dumpStatsShm NAME [QUERY]\n\n");
+	printf("NAME   is name of shared memory segment given to collector by -M option\nQUERY  is one of:\n");
+	printf("  info           summary (default)\n  airlines[:N]   top N airlines with share of flights (20 by default)\n");
+	printf("  range:BEARING  farthest position on bearing (0-359)\n  alt            number of positions for each flight level\n");
+	printf("  heat           heat map cells (merged into blocks if heat map does not fit into segment)\n\n");
+}
+
+
+int main(int argc, char **argv)
+{
+	if ((argc < 2) || (argc > 3) || (strcmp(argv[1], "-h") == 0))
+	{
+		printHelp();
+		return 1;
+	}
+	
+	tLiveReader r;
+	if (liveOpen(argv[1], r))
+	{
+		return 1;
+	}
+	
+	// single consistent copy, all output is printed from it
+	static tLiveData d;
+	liveRead(r, d);
+	uint64_t messages = liveMessages(r);
+	liveClose(r);
+	
+	std::string query = (argc == 3) ? argv[2] : "info";
+	std::string name = query.substr(0, query.find(':'));
+	std::string arg = (query.find(':') != std::string::npos) ? query.substr(query.find(':') + 1) : "";
+	
+	if (name == "info")
+	{
+		std::time_t t = d.updated;
+		char date[64];
+		strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", localtime(&t));
+		
+		double maxDist = 0;
+		int maxBearing = 0;
+		for (int i = 0; i < 360; i++)
+		{
+			if (d.polar[i].dist > maxDist)
+			{
+				maxDist = d.polar[i].dist;
+				maxBearing = i;
+			}
+		}
+		
+		printf("updated:   %s\n", date);
+		printf("reference: %f %f\n", d.refLat, d.refLon);
+		printf("max range: %.1f km at %d deg\n", maxDist, maxBearing);
+		printf("cells:     %u (level %u)\n", d.heatCount, d.heatLevel);
+		printf("airlines:  %u\n", d.companyCount);
+		printf("messages:  %lu\n", (unsigned long) messages);
+	}
+	else if (name == "airlines")
+	{
+		unsigned long n = arg.empty() ? 20 : strtoul(arg.c_str(), NULL, 10);
+		double total = 0;
+		for (uint32_t i = 0; i < d.companyCount; i++)
+		{
+			total += d.companies[i].count;
+		}
+		for (uint32_t i = 0; (i < n) && (i < d.companyCount); i++)
+		{
+			printf("%-4.4s %8d %6.2f%%\n", d.companies[i].code, d.companies[i].count, total > 0 ? 100.0 * d.companies[i].count / total : 0.0);
+		}
+	}
+	else if ((name == "range") && (! arg.empty()))
+	{
+		int bearing = atoi(arg.c_str());
+		if ((bearing < 0) || (bearing > 359))
+		{
+			fprintf(stderr, "ERROR: Bearing has to be between 0 and 359!\n");
+			return 1;
+		}
+		printf("%d %f %f %.1f\n", bearing, d.polar[bearing].lat, d.polar[bearing].lon, d.polar[bearing].dist);
+	}
+	else if (name == "alt")
+	{
+		for (int i = 0; i <= 500; i++)
+		{
+			printf("FL%03d %d\n", i, d.alt[i]);
+		}
+	}
+	else if (name == "heat")
+	{
+		for (uint32_t i = 0; i < d.heatCount; i++)
+		{
+			int latQ, lonQ;
+			heatDemorton(d.heat[i].code, latQ, lonQ);
+			printf("%.2f %.2f %d\n", latQ / 100.0, lonQ / 100.0, d.heat[i].weight);
+		}
+	}
+	else
+	{
+		fprintf(stderr, "ERROR: Unknown query %s!\n", query.c_str());
+		return 1;
+	}
+	
+	return 0;
+}
@@ -0,0 +1,228 @@
+/* DumpStats - dump1090 feed statistical data collector
+ * Copyright (C) 2015 Marcel Kebisek
+ * Contact: marcel.kebisek@gmail.com
+ * 
+ * This file is part of DumpStats.
+ * 
+ * DumpStats is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * DumpStats is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with DumpStats. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "trace.H"
+
+#if TRACE
+
+#include <cstdio>
+#include <cstdlib>
+#include <csignal>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+
+// Ring of spans of single thread (never freed, so spans of finished threads are written too)
+typedef struct traceRing
+{
+	tTraceEvent events[TRACE_EVENTS];
+	std::atomic<uint64_t> count;	// spans recorded so far, next one goes to count % TRACE_EVENTS
+	long tid;
+	const char *name;
+} tTraceRing;
+
+
+static std::mutex traceLock;
+static std::vector<tTraceRing *> traceRings;
+static thread_local tTraceRing *traceLocal = NULL;
+static volatile sig_atomic_t traceRequested = 0;
+
+
+
+/**
+ * Function returns ring of calling thread, ring is created and registered on first use.
+ * @return ring of thread
+ */
+static tTraceRing *traceRing()
+{
+	if (traceLocal == NULL)
+	{
+		tTraceRing *r = new tTraceRing();
+		r->count = 0;
+		r->tid = syscall(SYS_gettid);
+		r->name = NULL;
+		
+		std::lock_guard<std::mutex> guard(traceLock);
+		traceRings.push_back(r);
+		traceLocal = r;
+	}
+	return traceLocal;
+}
+
+
+
+/**
+ * Function records span into ring of calling thread, oldest span is overwritten when ring is full.
+ * @param name - name of span (string literal)
+ * @param start - monotonic start time in nanoseconds
+ * @param end - monotonic end time in nanoseconds
+ */
+void traceRecord(const char *name, uint64_t start, uint64_t end)
+{
+	tTraceRing *r = traceRing();
+	uint64_t n = r->count.load(std::memory_order_relaxed);
+	tTraceEvent &e = r->events[n % TRACE_EVENTS];
+	e.name = name;
+	e.start = start;
+	e.end = end;
+	r->count.store(n + 1, std::memory_order_release);
+}
+
+
+
+/**
+ * Function names calling thread in trace.
+ * @param name - name of thread (string literal)
+ */
+void traceThreadName(const char *name)
+{
+	traceRing()->name = name;
+}
+
+
+
+/**
+ * SIGUSR1 handler - trace file is written by next TRACE_POLL().
+ */
+static void traceSignal(int s)
+{
+	traceRequested = 1;
+}
+
+
+
+/**
+ * Function writes trace file at exit of process.
+ */
+static void traceAtExit()
+{
+	traceDump();
+}
+
+
+
+/**
+ * Function installs SIGUSR1 handler and writing of trace file at exit.
+ * Handler does not restart system calls, so blocking poll() of main loop returns and reaches TRACE_POLL().
+ */
+void traceInit()
+{
+	struct sigaction sa;
+	sa.sa_handler = traceSignal;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = 0;
+	sigaction(SIGUSR1, &sa, NULL);
+	
+	atexit(traceAtExit);
+}
+
+
+
+/**
+ * Function drops spans and rings inherited from parent process, so forked child writes only its own spans.
+ * Must be called by the only thread of child right after fork().
+ */
+void traceReset()
+{
+	tTraceRing *own = traceRing();
+	own->count = 0;
+	own->tid = syscall(SYS_gettid);
+	
+	traceRings.clear();
+	traceRings.push_back(own);
+}
+
+
+
+/**
+ * Function writes trace file, if SIGUSR1 was received since last call.
+ */
+void tracePoll()
+{
+	if (traceRequested)
+	{
+		traceRequested = 0;
+		traceDump();
+	}
+}
+
+
+
+/**
+ * Function writes spans of all rings into dumpStats-PID.trace.json (Chrome trace format) through temporary file.
+ * Spans recorded by other threads while writing may be torn.
+ * @return zero if success, nonzero otherwise
+ */
+int traceDump()
+{
+	long pid = getpid();
+	char path[64];
+	snprintf(path, sizeof(path), "dumpStats-%ld.trace.json", pid);
+	std::string tmpPath = std::string(path) + ".tmp";
+	
+	FILE *f = fopen(tmpPath.c_str(), "w");
+	if (f == NULL)
+	{
+		fprintf(stderr, "ERROR: Unable to write trace file %s!\n", path);
+		return 1;
+	}
+	
+	fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+	const char *sep = "\n";
+	
+	std::lock_guard<std::mutex> guard(traceLock);
+	for (size_t i = 0; i < traceRings.size(); i++)
+	{
+		tTraceRing *r = traceRings[i];
+		if (r->name != NULL)
+		{
+			fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%ld,\"tid\":%ld,\"args\":{\"name\":\"%s\"}}", sep, pid, r->tid, r->name);
+			sep = ",\n";
+		}
+		
+		uint64_t n = r->count.load(std::memory_order_acquire);
+		uint64_t first = (n > TRACE_EVENTS) ? n - TRACE_EVENTS : 0;
+		for (uint64_t j = first; j < n; j++)
+		{
+			const tTraceEvent &e = r->events[j % TRACE_EVENTS];
+			uint64_t dur = (e.end > e.start) ? e.end - e.start : 0;
+			fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%ld,\"tid\":%ld,\"ts\":%lu.%03lu,\"dur\":%lu.%03lu}", sep, e.name, pid, r->tid,
+				(unsigned long) (e.start / 1000), (unsigned long) (e.start % 1000), (unsigned long) (dur / 1000), (unsigned long) (dur % 1000));
+			sep = ",\n";
+		}
+	}
+	
+	fprintf(f, "\n]}\n");
+	bool failed = (ferror(f) != 0);
+	if ((fclose(f) != 0) || failed || (rename(tmpPath.c_str(), path) != 0))
+	{
+		fprintf(stderr, "ERROR: Unable to write trace file %s!\n", path);
+		unlink(tmpPath.c_str());
+		return 1;
+	}
+	
+	return 0;
+}
+
+#endif
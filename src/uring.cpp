@@ -0,0 +1,702 @@
+/* DumpStats - dump1090 feed statistical data collector
+ * Copyright (C) 2015 Marcel Kebisek
+ * Contact: marcel.kebisek@gmail.com
+ * 
+ * This file is part of DumpStats.
+ * 
+ * DumpStats is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * DumpStats is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with DumpStats. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "uring.H"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
+
+// Multishot recv came with Linux 6.0 headers
+#if defined(IORING_RECV_MULTISHOT) && defined(__NR_io_uring_setup)
+#define URING_AVAILABLE 1
+#else
+#define URING_AVAILABLE 0
+#endif
+
+// Stages of file chain (lower bits of user data)
+#define URING_STAGE_WRITE 0
+#define URING_STAGE_FSYNC 1
+#define URING_STAGE_CLOSE 2
+#define URING_STAGE_RENAME 3
+#define URING_STAGES 4
+
+// User data of requests returning receive buffers (completion is posted only if they fail)
+#define URING_INTERNAL UINT64_MAX
+
+
+/**
+ * Constructor.
+ */
+ioRing::ioRing()
+{
+	ringFd = -1;
+	sqRing = MAP_FAILED;
+	cqRing = MAP_FAILED;
+	sqRingSize = 0;
+	cqRingSize = 0;
+	sqes = (struct io_uring_sqe *) MAP_FAILED;
+	sqesSize = 0;
+	sqHead = sqTail = sqArray = cqHead = cqTail = NULL;
+	sqMask = cqMask = 0;
+	cqes = NULL;
+	sqLocal = 0;
+}
+
+
+
+/**
+ * Destructor.
+ */
+ioRing::~ioRing()
+{
+	if (sqes != MAP_FAILED)
+	{
+		munmap(sqes, sqesSize);
+	}
+	if ((cqRing != MAP_FAILED) && (cqRing != sqRing))
+	{
+		munmap(cqRing, cqRingSize);
+	}
+	if (sqRing != MAP_FAILED)
+	{
+		munmap(sqRing, sqRingSize);
+	}
+	if (ringFd >= 0)
+	{
+		::close(ringFd);
+	}
+}
+
+
+
+/**
+ * Function returns ring descriptor.
+ * @return descriptor, negative if ring is not open
+ */
+int ioRing::fd() const
+{
+	return ringFd;
+}
+
+
+
+#if URING_AVAILABLE
+
+/**
+ * Function sets up ring and maps its submission and completion queues.
+ * @param entries - number of submission queue entries
+ * @return zero if succeeded, errno otherwise
+ */
+int ioRing::open(unsigned entries)
+{
+	struct io_uring_params p;
+	memset(&p, 0, sizeof(p));
+	ringFd = syscall(__NR_io_uring_setup, entries, &p);
+	if (ringFd < 0)
+	{
+		return errno;
+	}
+	
+	sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (single)
+	{
+		sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+	}
+	
+	sqRing = mmap(NULL, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+	if (sqRing == MAP_FAILED)
+	{
+		return errno;
+	}
+	cqRing = single ? sqRing : mmap(NULL, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+	if (cqRing == MAP_FAILED)
+	{
+		return errno;
+	}
+	sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+	sqes = (struct io_uring_sqe *) mmap(NULL, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+	if (sqes == MAP_FAILED)
+	{
+		return errno;
+	}
+	
+	char *sq = (char *) sqRing;
+	char *cq = (char *) cqRing;
+	sqHead = (unsigned *) (sq + p.sq_off.head);
+	sqTail = (unsigned *) (sq + p.sq_off.tail);
+	sqMask = *(unsigned *) (sq + p.sq_off.ring_mask);
+	sqArray = (unsigned *) (sq + p.sq_off.array);
+	cqHead = (unsigned *) (cq + p.cq_off.head);
+	cqTail = (unsigned *) (cq + p.cq_off.tail);
+	cqMask = *(unsigned *) (cq + p.cq_off.ring_mask);
+	cqes = cq + p.cq_off.cqes;
+	sqLocal = *sqTail;
+	return 0;
+}
+
+
+
+/**
+ * Function hands receive buffers over to kernel, from which multishot receives take their buffers.
+ * @return zero if succeeded, errno otherwise
+ */
+int ioRing::provideBuffers()
+{
+	buffers.resize((size_t) URING_BUFFERS * URING_BUFFER_SIZE);
+	struct io_uring_sqe *sqe = entry();
+	if (sqe == NULL)
+	{
+		return EBUSY;
+	}
+	sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+	sqe->fd = URING_BUFFERS;
+	sqe->addr = (uint64_t) (uintptr_t) buffers.data();
+	sqe->len = URING_BUFFER_SIZE;
+	sqe->off = 0;
+	sqe->buf_group = URING_GROUP;
+	sqe->user_data = URING_INTERNAL;
+	
+	int result = submit(1);
+	if (result < 0)
+	{
+		return -result;
+	}
+	unsigned head = *cqHead;
+	if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE))
+	{
+		return EIO;
+	}
+	int res = ((const struct io_uring_cqe *) cqes + (head & cqMask))->res;
+	__atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+	return (res < 0) ? -res : 0;
+}
+
+
+
+/**
+ * Function returns data of provided buffer picked by kernel for completion.
+ * @param c - completion of receive with positive result
+ * @return received data (c.res bytes)
+ */
+const char *ioRing::buffer(const tUringCompletion &c) const
+{
+	return &buffers[(size_t) (c.flags >> IORING_CQE_BUFFER_SHIFT) * URING_BUFFER_SIZE];
+}
+
+
+
+/**
+ * Function returns provided buffer of completion back to kernel. Request is submitted with next submit()
+ * and posts no completion unless it fails.
+ * @param c - completion of receive with positive result
+ */
+void ioRing::recycle(const tUringCompletion &c)
+{
+	unsigned bid = c.flags >> IORING_CQE_BUFFER_SHIFT;
+	struct io_uring_sqe *sqe = entry();
+	if (sqe == NULL)
+	{
+		fprintf(stderr, "ERROR: Submission queue full, receive buffer %u lost!\n", bid);
+		return;
+	}
+	sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+	sqe->fd = 1;
+	sqe->addr = (uint64_t) (uintptr_t) &buffers[(size_t) bid * URING_BUFFER_SIZE];
+	sqe->len = URING_BUFFER_SIZE;
+	sqe->off = bid;
+	sqe->buf_group = URING_GROUP;
+	sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+	sqe->user_data = URING_INTERNAL;
+}
+
+
+
+/**
+ * Function checks whether multishot request stays armed after completion.
+ * @param c - completion
+ * @return true if more completions will follow
+ */
+bool ioRing::more(const tUringCompletion &c)
+{
+	return (c.flags & IORING_CQE_F_MORE) != 0;
+}
+
+
+
+/**
+ * Function returns free submission queue entry.
+ * @return cleared entry, NULL if queue is full
+ */
+struct io_uring_sqe *ioRing::entry()
+{
+	unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+	if (sqLocal - head > sqMask)
+	{
+		return NULL;
+	}
+	unsigned index = sqLocal & sqMask;
+	struct io_uring_sqe *sqe = &sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	sqArray[index] = index;
+	sqLocal++;
+	return sqe;
+}
+
+
+
+/**
+ * Function queues multishot receive with buffer selection from provided buffers.
+ * @param fd - socket
+ * @param userData - user data of completions
+ * @return false if queue is full
+ */
+bool ioRing::recvMultishot(int fd, uint64_t userData)
+{
+	struct io_uring_sqe *sqe = entry();
+	if (sqe == NULL)
+	{
+		return false;
+	}
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = fd;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = URING_GROUP;
+	sqe->user_data = userData;
+	return true;
+}
+
+
+
+/**
+ * Function queues write at start of file.
+ * @param fd - file
+ * @param data - data (kept by caller until completion)
+ * @param len - length of data
+ * @param userData - user data of completion
+ * @param link - following request waits for successful completion
+ * @return false if queue is full
+ */
+bool ioRing::write(int fd, const void *data, size_t len, uint64_t userData, bool link)
+{
+	struct io_uring_sqe *sqe = entry();
+	if (sqe == NULL)
+	{
+		return false;
+	}
+	sqe->opcode = IORING_OP_WRITE;
+	sqe->fd = fd;
+	sqe->addr = (uint64_t) (uintptr_t) data;
+	sqe->len = len;
+	sqe->off = 0;
+	sqe->flags = link ? IOSQE_IO_LINK : 0;
+	sqe->user_data = userData;
+	return true;
+}
+
+
+
+/**
+ * Function queues fsync of file.
+ * @param fd - file
+ * @param userData - user data of completion
+ * @param link - following request waits for successful completion
+ * @return false if queue is full
+ */
+bool ioRing::fsync(int fd, uint64_t userData, bool link)
+{
+	struct io_uring_sqe *sqe = entry();
+	if (sqe == NULL)
+	{
+		return false;
+	}
+	sqe->opcode = IORING_OP_FSYNC;
+	sqe->fd = fd;
+	sqe->flags = link ? IOSQE_IO_LINK : 0;
+	sqe->user_data = userData;
+	return true;
+}
+
+
+
+/**
+ * Function queues close of file.
+ * @param fd - file
+ * @param userData - user data of completion
+ * @param link - following request waits for successful completion
+ * @return false if queue is full
+ */
+bool ioRing::close(int fd, uint64_t userData, bool link)
+{
+	struct io_uring_sqe *sqe = entry();
+	if (sqe == NULL)
+	{
+		return false;
+	}
+	sqe->opcode = IORING_OP_CLOSE;
+	sqe->fd = fd;
+	sqe->flags = link ? IOSQE_IO_LINK : 0;
+	sqe->user_data = userData;
+	return true;
+}
+
+
+
+/**
+ * Function queues rename of file (relative paths to current directory).
+ * @param from - old path (kept by caller until completion)
+ * @param to - new path (kept by caller until completion)
+ * @param userData - user data of completion
+ * @param link - following request waits for successful completion
+ * @return false if queue is full
+ */
+bool ioRing::rename(const char *from, const char *to, uint64_t userData, bool link)
+{
+	struct io_uring_sqe *sqe = entry();
+	if (sqe == NULL)
+	{
+		return false;
+	}
+	sqe->opcode = IORING_OP_RENAMEAT;
+	sqe->fd = AT_FDCWD;
+	sqe->addr = (uint64_t) (uintptr_t) from;
+	sqe->len = AT_FDCWD;
+	sqe->addr2 = (uint64_t) (uintptr_t) to;
+	sqe->flags = link ? IOSQE_IO_LINK : 0;
+	sqe->user_data = userData;
+	return true;
+}
+
+
+
+/**
+ * Function submits queued requests and waits for completions.
+ * @param wait - minimal number of completions to wait for (zero does not wait)
+ * @return number of submitted requests, negative errno if failed (-EINTR when interrupted by signal)
+ */
+int ioRing::submit(unsigned wait)
+{
+	unsigned count = sqLocal - *sqTail;
+	__atomic_store_n(sqTail, sqLocal, __ATOMIC_RELEASE);
+	int result = syscall(__NR_io_uring_enter, ringFd, count, wait, IORING_ENTER_GETEVENTS, NULL, 0);
+	return (result < 0) ? -errno : result;
+}
+
+
+
+/**
+ * Function takes next completion.
+ * @param c - completion is stored here
+ * @return false if there is no completion
+ */
+bool ioRing::next(tUringCompletion &c)
+{
+	while (true)
+	{
+		unsigned head = *cqHead;
+		if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE))
+		{
+			return false;
+		}
+		const struct io_uring_cqe *cqe = (const struct io_uring_cqe *) cqes + (head & cqMask);
+		c.userData = cqe->user_data;
+		c.res = cqe->res;
+		c.flags = cqe->flags;
+		__atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+		
+		// failed return of buffer (buffer is lost, receive runs out of buffers sooner)
+		if (c.userData == URING_INTERNAL)
+		{
+			fprintf(stderr, "ERROR: Unable to return receive buffer (%s)!\n", strerror(-c.res));
+			continue;
+		}
+		return true;
+	}
+}
+
+#else
+
+// Build without io_uring headers - ring cannot be opened, so collector always takes its fallback
+
+int ioRing::open(unsigned entries)
+{
+	(void) entries;
+	return ENOSYS;
+}
+
+int ioRing::provideBuffers()
+{
+	return ENOSYS;
+}
+
+const char *ioRing::buffer(const tUringCompletion &c) const
+{
+	(void) c;
+	return NULL;
+}
+
+void ioRing::recycle(const tUringCompletion &c)
+{
+	(void) c;
+}
+
+bool ioRing::more(const tUringCompletion &c)
+{
+	(void) c;
+	return false;
+}
+
+struct io_uring_sqe *ioRing::entry()
+{
+	return NULL;
+}
+
+bool ioRing::recvMultishot(int fd, uint64_t userData)
+{
+	(void) fd; (void) userData;
+	return false;
+}
+
+bool ioRing::write(int fd, const void *data, size_t len, uint64_t userData, bool link)
+{
+	(void) fd; (void) data; (void) len; (void) userData; (void) link;
+	return false;
+}
+
+bool ioRing::fsync(int fd, uint64_t userData, bool link)
+{
+	(void) fd; (void) userData; (void) link;
+	return false;
+}
+
+bool ioRing::close(int fd, uint64_t userData, bool link)
+{
+	(void) fd; (void) userData; (void) link;
+	return false;
+}
+
+bool ioRing::rename(const char *from, const char *to, uint64_t userData, bool link)
+{
+	(void) from; (void) to; (void) userData; (void) link;
+	return false;
+}
+
+int ioRing::submit(unsigned wait)
+{
+	(void) wait;
+	return -ENOSYS;
+}
+
+bool ioRing::next(tUringCompletion &c)
+{
+	(void) c;
+	return false;
+}
+
+#endif
+
+
+
+/**
+ * Constructor.
+ */
+asyncWriter::asyncWriter()
+{
+	pending = 0;
+}
+
+
+
+/**
+ * Function sets up ring of writer.
+ * @return zero if succeeded, errno otherwise
+ */
+int asyncWriter::open()
+{
+	return ring.open(URING_ENTRIES);
+}
+
+
+
+/**
+ * Function returns ring descriptor, which is readable while completions are waiting.
+ * @return descriptor
+ */
+int asyncWriter::fd() const
+{
+	return ring.fd();
+}
+
+
+
+/**
+ * Function checks whether previous export is in flight.
+ * @return true if some file is not finished yet
+ */
+bool asyncWriter::busy() const
+{
+	return pending > 0;
+}
+
+
+
+/**
+ * Function creates temporary file of export and takes over its content. Opening is synchronous
+ * (it does not wait for disk), writing is left to submit().
+ * @param path - path of file
+ * @param content - content of file, left empty
+ * @return zero if succeeded
+ */
+int asyncWriter::add(const std::string &path, std::string &content)
+{
+	tUringFile f;
+	f.path = path;
+	f.tmpPath = path + ".tmp";
+	f.fd = ::open(f.tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (f.fd < 0)
+	{
+		fprintf(stderr, "ERROR: Unable to open %s!\n", f.tmpPath.c_str());
+		return 1;
+	}
+	f.pending = 0;
+	f.failed = false;
+	files.push_back(f);
+	files.back().content.swap(content);
+	content.clear();
+	return 0;
+}
+
+
+
+/**
+ * Function submits chains of all queued files by single syscall.
+ * @return zero if succeeded
+ */
+int asyncWriter::submit()
+{
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		tUringFile &f = files[i];
+		if (f.pending > 0)
+		{
+			continue;
+		}
+		uint64_t id = (uint64_t) i * URING_STAGES;
+		if ((! ring.write(f.fd, f.content.data(), f.content.size(), id + URING_STAGE_WRITE, true))
+			|| (! ring.fsync(f.fd, id + URING_STAGE_FSYNC, true))
+			|| (! ring.close(f.fd, id + URING_STAGE_CLOSE, true))
+			|| (! ring.rename(f.tmpPath.c_str(), f.path.c_str(), id + URING_STAGE_RENAME, false)))
+		{
+			fprintf(stderr, "ERROR: Submission queue of file export is full!\n");
+			return 1;
+		}
+		f.pending = URING_STAGES;
+		pending++;
+	}
+	
+	int result = ring.submit(0);
+	if (result < 0)
+	{
+		fprintf(stderr, "ERROR: Unable to submit file export (%s)!\n", strerror(-result));
+		return 1;
+	}
+	return 0;
+}
+
+
+
+/**
+ * Function reaps completions of file chains. Failed request cancels rest of its chain, file
+ * is closed here then and temporary file is left in place of export.
+ * @param wait - wait until all files are finished
+ * @param failed - number of failed files among finished ones
+ * @return number of files finished
+ */
+int asyncWriter::reap(bool wait, int &failed)
+{
+	static const char *stageNames[URING_STAGES] = {"write", "fsync", "close", "rename"};
+	int finished = 0;
+	failed = 0;
+	
+	while (pending > 0)
+	{
+		tUringCompletion c;
+		if (! ring.next(c))
+		{
+			if (! wait)
+			{
+				break;
+			}
+			int result = ring.submit(1);
+			if ((result < 0) && (result != -EINTR))
+			{
+				break;
+			}
+			continue;
+		}
+		
+		tUringFile &f = files[c.userData / URING_STAGES];
+		int stage = c.userData % URING_STAGES;
+		bool error = (c.res < 0) || ((stage == URING_STAGE_WRITE) && ((size_t) c.res != f.content.size()));
+		if (error)
+		{
+			if ((stage == URING_STAGE_CLOSE) && (c.res == -ECANCELED))
+			{
+				::close(f.fd);
+			}
+			if ((! f.failed) && (c.res != -ECANCELED))
+			{
+				fprintf(stderr, "ERROR: Unable to %s %s (%s)!\n", stageNames[stage], f.tmpPath.c_str(),
+					(c.res < 0) ? strerror(-c.res) : "short write");
+			}
+			f.failed = true;
+		}
+		
+		if (--f.pending == 0)
+		{
+			finished++;
+			if (f.failed)
+			{
+				failed++;
+			}
+			pending--;
+		}
+	}
+	
+	if (pending == 0)
+	{
+		files.clear();
+	}
+	return finished;
+}